@@ -0,0 +1,59 @@
+# Microbenchmarks of terrain generation, meshing, chunk lookups, raycasts,
+# collision, entities and fluids.
+# Builds only the parts of the game that don't need OpenGL or a window.
+QT += core
+QT -= gui
+
+TARGET = MiniMinecraftBench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG += c++1z
+CONFIG += release
+CONFIG += warn_on
+
+INCLUDEPATH += include src
+
+SOURCES += bench/main.cpp \
+    bench/benchworld.cpp \
+    bench/collision.cpp \
+    bench/meshers.cpp \
+    bench/microbench.cpp \
+    src/memorystats.cpp \
+    src/tracer.cpp \
+    src/scene/chunkdata.cpp \
+    src/scene/chunkmesher.cpp \
+    src/scene/decorations.cpp \
+    src/scene/entitysystem.cpp \
+    src/scene/fluidsim.cpp \
+    src/scene/sectionvisibility.cpp \
+    src/scene/spatialhash.cpp \
+    src/scene/raycast.cpp \
+    src/scene/terraingen.cpp \
+    src/scene/voxelcollision.cpp
+
+HEADERS += bench/benchworld.h \
+    bench/collision.h \
+    bench/meshers.h \
+    bench/microbench.h \
+    src/memorystats.h \
+    src/smartpointerhelp.h \
+    src/tracer.h \
+    src/scene/chunkdata.h \
+    src/scene/chunkhelpers.h \
+    src/scene/chunkmesher.h \
+    src/scene/decorations.h \
+    src/scene/entitysystem.h \
+    src/scene/fluidsim.h \
+    src/scene/gridmarch.h \
+    src/scene/raycast.h \
+    src/scene/sectionvisibility.h \
+    src/scene/spatialhash.h \
+    src/scene/terraingen.h \
+    src/scene/voxelcollision.h
+
+*-clang*|*-g++* {
+    CONFIG -= warn_on
+    QMAKE_CXXFLAGS += -Wall -Wextra -pedantic -Winit-self
+    QMAKE_CXXFLAGS += -Wno-strict-aliasing
+}
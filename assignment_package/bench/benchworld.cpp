@@ -0,0 +1,65 @@
+#include "benchworld.h"
+#include "scene/terraingen.h"
+
+BenchWorld::BenchWorld()
+    : m_chunks()
+{}
+
+void BenchWorld::generateZone(int x, int z) {
+    for (int cx = x; cx < x + 64; cx += 16) {
+        for (int cz = z; cz < z + 64; cz += 16) {
+            uPtr<ChunkData> chunk = mkU<ChunkData>(cx, cz);
+            ChunkData *c = chunk.get();
+            m_chunks[toKey(cx, cz)] = std::move(chunk);
+            c->linkNeighbor(getChunkAt(cx, cz + 16), ZPOS);
+            c->linkNeighbor(getChunkAt(cx, cz - 16), ZNEG);
+            c->linkNeighbor(getChunkAt(cx + 16, cz), XPOS);
+            c->linkNeighbor(getChunkAt(cx - 16, cz), XNEG);
+            for (int bx = 0; bx < 16; bx++) {
+                for (int bz = 0; bz < 16; bz++) {
+                    fillBlock(c, bx, bz);
+                }
+            }
+        }
+    }
+}
+
+bool BenchWorld::hasChunkAt(int x, int z) const {
+    int xFloor = static_cast<int>(glm::floor(x / 16.f));
+    int zFloor = static_cast<int>(glm::floor(z / 16.f));
+    return m_chunks.find(toKey(16 * xFloor, 16 * zFloor)) != m_chunks.end();
+}
+
+ChunkData *BenchWorld::getChunkAt(int x, int z) const {
+    int xFloor = static_cast<int>(glm::floor(x / 16.f));
+    int zFloor = static_cast<int>(glm::floor(z / 16.f));
+    auto it = m_chunks.find(toKey(16 * xFloor, 16 * zFloor));
+    return it == m_chunks.end() ? nullptr : it->second.get();
+}
+
+BlockType BenchWorld::getBlockAt(int x, int y, int z) const {
+    // Two lookups, hasChunkAt and then the chunk itself, as Terrain does
+    if (!hasChunkAt(x, z) || y < 0 || y >= 256) {
+        return EMPTY;
+    }
+    const ChunkData *c = getChunkAt(x, z);
+    glm::ivec2 chunkOrigin = c->getCoords();
+    return c->getBlockAt(static_cast<unsigned int>(x - chunkOrigin.x),
+                         static_cast<unsigned int>(y),
+                         static_cast<unsigned int>(z - chunkOrigin.y));
+}
+
+void BenchWorld::setBlockAt(int x, int y, int z, BlockType t) {
+    if (!hasChunkAt(x, z) || y < 0 || y >= 256) {
+        return;
+    }
+    ChunkData *c = getChunkAt(x, z);
+    glm::ivec2 chunkOrigin = c->getCoords();
+    c->setBlockAt(static_cast<unsigned int>(x - chunkOrigin.x),
+                  static_cast<unsigned int>(y),
+                  static_cast<unsigned int>(z - chunkOrigin.y), t);
+}
+
+size_t BenchWorld::chunkCount() const {
+    return m_chunks.size();
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "smartpointerhelp.h"
+#include "scene/chunkdata.h"
+#include <unordered_map>
+
+// A Terrain without the GPU side: ChunkData stored and looked up the same
+// way Terrain stores its Chunks, filled on the calling thread
+class BenchWorld {
+private:
+    std::unordered_map<int64_t, uPtr<ChunkData>> m_chunks;
+
+public:
+    BenchWorld();
+
+    // Creates the 4 x 4 chunks of the zone with its corner at (x, z),
+    // linked to any neighbours that already exist, and fills them
+    void generateZone(int x, int z);
+
+    bool hasChunkAt(int x, int z) const;
+    // The chunk containing world column (x, z), or nullptr
+    ChunkData *getChunkAt(int x, int z) const;
+    // Like Terrain::getBlockAt, but EMPTY outside of the generated area
+    BlockType getBlockAt(int x, int y, int z) const;
+    // Does nothing outside of the generated area
+    void setBlockAt(int x, int y, int z, BlockType t);
+    size_t chunkCount() const;
+};
@@ -0,0 +1,68 @@
+#include "collision.h"
+#include "scene/gridmarch.h"
+#include "scene/terraingen.h"
+
+// As in Player
+#define WALK_STEP_HEIGHT 0.5f
+#define WALK_HEIGHT 2.f
+
+glm::vec3 cornerMarchMove(const BenchWorld &world, glm::vec3 pos, glm::vec3 movement) {
+    for (float x = -0.5f; x <= 0.5f; x++) {
+        for (float z = -0.5f; z <= 0.5f; z++) {
+            for (float y = 0.f; y <= WALK_HEIGHT; y++) {
+                glm::vec3 rayOrigin = pos + glm::vec3(x, y, z);
+                for (int i = 0; i <= 2; i++) {
+                    float dist;
+                    glm::vec3 blockHit;
+                    glm::vec3 rayDirection = glm::vec3();
+                    BlockType blockType;
+                    rayDirection[i] = glm::sign(movement[i]);
+                    if (gridMarch(rayOrigin, rayDirection, world, &dist, &blockHit, &blockType) &&
+                        blocksMovement(blockType)) {
+                        if (dist < 0.02f) {
+                            movement[i] = 0;
+                        } else {
+                            movement[i] = glm::min(glm::abs(movement[i]), glm::abs(dist)) - 0.02f;
+                            movement[i] *= glm::sign(rayDirection)[i];
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return movement;
+}
+
+SweepResult sweptMove(const BenchWorld &world, VoxelNeighborhood *blocks, glm::vec3 pos, glm::vec3 movement) {
+    AABB box {pos - glm::vec3(0.5f, 0.f, 0.5f), pos + glm::vec3(0.5f, WALK_HEIGHT, 0.5f)};
+    glm::vec3 reach = glm::abs(movement) + glm::vec3(0.f, WALK_STEP_HEIGHT, 0.f);
+    blocks->gather(world, glm::ivec3(glm::floor(box.min - reach)) - 1, glm::ivec3(glm::ceil(box.max + reach)) + 1);
+    return sweepAABB(*blocks, box, movement, WALK_STEP_HEIGHT);
+}
+
+std::vector<CollisionQuery> walkPath(const BenchWorld &world, int ticks) {
+    const float dT = 1.f / 60.f;
+    float biome;
+    glm::vec3 pos(32.f, getTerrainHeight(32, 32, &biome) + 2.f, 32.f);
+    glm::vec3 velocity(0.f);
+    VoxelNeighborhood blocks;
+    std::vector<CollisionQuery> path;
+    for (int t = 0; t < ticks; t++) {
+        // Ten-block circles around the middle of the zone
+        float heading = 0.6f * t * dT;
+        velocity.x = 6.f * glm::cos(heading);
+        velocity.z = 6.f * glm::sin(heading);
+        velocity.y = (velocity.y - 100.f * dT) * 0.9f;
+        glm::vec3 movement = velocity * dT;
+        path.push_back({pos, movement});
+        SweepResult result = sweptMove(world, &blocks, pos, movement);
+        if (result.blocked.y) {
+            velocity.y = 0.f;
+            if (result.blocked.x || result.blocked.z) {
+                velocity.y = 12.f;
+            }
+        }
+        pos += result.movement;
+    }
+    return path;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "benchworld.h"
+#include "scene/voxelcollision.h"
+#include <vector>
+
+// The two ways the player's movement has been clipped against the world,
+// with the player's box (a block wide and two high, standing on pos) and
+// the player's handling of water and flight left out
+
+// What Player::computePhysics did before sweepAABB: a grid march along each
+// axis of the move from each of twelve points on the box's sides
+glm::vec3 cornerMarchMove(const BenchWorld &world, glm::vec3 pos, glm::vec3 movement);
+
+// What it does now. blocks is kept between calls, as the player keeps it.
+SweepResult sweptMove(const BenchWorld &world, VoxelNeighborhood *blocks, glm::vec3 pos, glm::vec3 movement);
+
+// A position and the move the player tried to make from it
+struct CollisionQuery {
+    glm::vec3 pos, movement;
+};
+
+// The moves of a player walking circles through the zone at (0, 0) for
+// ticks steps of 1/60 s, under gravity, jumping whenever a wall stops them.
+// Recorded once and replayed through both of the above.
+std::vector<CollisionQuery> walkPath(const BenchWorld &world, int ticks);
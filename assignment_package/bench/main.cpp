@@ -0,0 +1,382 @@
+#include "benchworld.h"
+#include "collision.h"
+#include "meshers.h"
+#include "microbench.h"
+#include "scene/chunkmesher.h"
+#include "scene/entitysystem.h"
+#include "scene/fluidsim.h"
+#include "scene/gridmarch.h"
+#include "scene/raycast.h"
+#include "scene/terraingen.h"
+
+#include <iostream>
+#include <random>
+#include <QCoreApplication>
+#include <QStringList>
+
+// Microbenchmarks of the CPU side of the terrain: noise, zone generation,
+// meshing, chunk lookups, raycasts, player collision, entities and fluids. Run with --repetitions=<n>,
+// --filter=<part of a case name> and --out=<file> (bench_results.json).
+
+// Lookups and rays per iteration of the chunk map and raycast cases
+#define LOOKUPS_PER_ITERATION 4096
+#define RAYS_PER_ITERATION 1024
+// Length of each benchmark ray, about the player's reach times ten
+#define RAY_LENGTH 30.f
+// Ticks of walking replayed through each collision resolver per iteration
+#define COLLISION_PATH_TICKS 1200
+// Entities in the crowd the entity cases tick, and ticks compared between
+// the serial and parallel updates
+#define ENTITY_STRESS_COUNT 10000
+#define ENTITY_COMPARE_TICKS 120
+// Zones along each side of the square the crowd is spread over
+#define ENTITY_CROWD_ZONES 3
+
+// Height of the floor of the basin the dam break case floods, up in the
+// air above the zone at (0, 0)
+#define DAM_FLOOR_Y 200
+// Most ticks a dam break may take to settle
+#define DAM_MAX_TICKS 10000
+
+// A stone basin with a reservoir of water sources walled off in one
+// corner. Clears whatever was left from the last time first.
+static void buildDam(BenchWorld *world) {
+    for (int x = 4; x <= 60; x++) {
+        for (int z = 4; z <= 60; z++) {
+            bool rim = x == 4 || x == 60 || z == 4 || z == 60;
+            bool reservoir = x < 15 && z < 15;
+            bool wall = (x == 15 && z <= 15) || (z == 15 && x <= 15);
+            world->setBlockAt(x, DAM_FLOOR_Y, z, STONE);
+            for (int y = DAM_FLOOR_Y + 1; y <= DAM_FLOOR_Y + 5; y++) {
+                BlockType t = EMPTY;
+                if (rim || wall) {
+                    t = STONE;
+                } else if (reservoir && y <= DAM_FLOOR_Y + 4) {
+                    t = WATER;
+                }
+                world->setBlockAt(x, y, z, t);
+            }
+        }
+    }
+}
+
+// Knocks a hole four blocks wide in the reservoir's wall and runs the
+// water until it stops. Returns the ticks it took.
+static int breakDam(BenchWorld *world, FluidSim *fluids, int *out_peakCells, size_t *out_blocksSet) {
+    for (int z = 8; z <= 11; z++) {
+        for (int y = DAM_FLOOR_Y + 1; y <= DAM_FLOOR_Y + 4; y++) {
+            world->setBlockAt(15, y, z, EMPTY);
+            fluids->blockChanged(glm::ivec3(15, y, z));
+        }
+    }
+    std::vector<glm::ivec3> changed;
+    int ticks = 0;
+    *out_peakCells = 0;
+    while (fluids->activeCount() > 0 && ticks < DAM_MAX_TICKS) {
+        *out_peakCells = glm::max(*out_peakCells, fluids->step(world, &changed));
+        ticks++;
+    }
+    *out_blocksSet = changed.size();
+    return ticks;
+}
+
+// Mostly mobs, with items dropped and arrows shot among them, spread over
+// the zones from (0, 0) on, away from their edges so every chunk they
+// reach exists
+static void spawnCrowd(EntitySystem *entities, int count) {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> spot(4.f, 64.f * ENTITY_CROWD_ZONES - 4.f), unit(-1.f, 1.f);
+    for (int i = 0; i < count; i++) {
+        float biome;
+        glm::vec3 pos(spot(rng), 0.f, spot(rng));
+        pos.y = getTerrainHeight(static_cast<int>(pos.x), static_cast<int>(pos.z), &biome) + 1.f;
+        if (i % 10 < 8) {
+            entities->spawn(ENTITY_MOB, pos, glm::vec3(0.f));
+        } else if (i % 10 == 8) {
+            entities->spawn(ENTITY_ITEM, pos + glm::vec3(0.f, 2.f, 0.f), glm::vec3(unit(rng), 4.f, unit(rng)));
+        } else {
+            entities->spawn(ENTITY_PROJECTILE, pos + glm::vec3(0.f, 1.5f, 0.f),
+                            glm::vec3(20.f * unit(rng), 5.f, 20.f * unit(rng)));
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    int repetitions = MICROBENCH_DEFAULT_REPETITIONS;
+    std::string filter;
+    std::string outPath = "bench_results.json";
+    for (const QString &arg : app.arguments()) {
+        if (arg.startsWith("--repetitions=")) {
+            repetitions = arg.section('=', 1).toInt();
+        } else if (arg.startsWith("--filter=")) {
+            filter = arg.section('=', 1).toStdString();
+        } else if (arg.startsWith("--out=")) {
+            outPath = arg.section('=', 1).toStdString();
+        }
+    }
+    Microbench bench(repetitions, filter);
+
+    // Noise over a spread of inputs, so no one cell of the lattice is
+    // measured over and over
+    bench.run("noise/perlin2d", 1, [](uint64_t n) {
+        float sum = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            sum += perlinNoise(glm::vec2(i % 997, i / 997) * 0.173f);
+        }
+        Microbench::sink(static_cast<uint64_t>(sum));
+    });
+    bench.run("noise/worley", 1, [](uint64_t n) {
+        float sum = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            sum += worleyNoise(glm::vec2(i % 997, i / 997) * 0.173f);
+        }
+        Microbench::sink(static_cast<uint64_t>(sum));
+    });
+    bench.run("noise/perlin3d", 1, [](uint64_t n) {
+        float sum = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            sum += perlinNoise3D(glm::vec3(i % 97, (i / 97) % 97, i / 9409) * 0.173f);
+        }
+        Microbench::sink(static_cast<uint64_t>(sum));
+    });
+    bench.run("noise/terrain_height", 1, [](uint64_t n) {
+        int sum = 0;
+        float biome;
+        for (uint64_t i = 0; i < n; i++) {
+            sum += getTerrainHeight(static_cast<int>(i % 997), static_cast<int>(i / 997), &biome);
+        }
+        Microbench::sink(static_cast<uint64_t>(sum));
+    });
+
+    // One zone of 4 x 4 chunks, 64 x 64 columns
+    bench.run("generate/zone", 64 * 64, [](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+            BenchWorld world;
+            world.generateZone(0, 0);
+            Microbench::sink(world.chunkCount());
+        }
+    });
+
+    // Every mesher gets the same chunk in the middle of a zone, so all four
+    // of its neighbours exist
+    BenchWorld world;
+    world.generateZone(0, 0);
+    const ChunkData *chunk = world.getChunkAt(16, 16);
+
+    bench.run("mesh/naive", 1, [chunk](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+            ChunkMeshData data;
+            ChunkMesher::build(chunk, &data);
+            Microbench::sink(data.idxDataOpaque.size() + data.idxDataTransparent.size());
+        }
+    });
+    std::vector<MeshQuad> quads;
+    bench.run("mesh/greedy", 1, [chunk, &quads](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+            quads.clear();
+            greedyMesh(*chunk, &quads);
+            Microbench::sink(quads.size());
+        }
+    });
+    bench.run("mesh/bitmask", 1, [chunk, &quads](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+            quads.clear();
+            bitmaskMesh(*chunk, &quads);
+            Microbench::sink(quads.size());
+        }
+    });
+
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<int> horizontal(0, 63), vertical(0, 255);
+    std::vector<glm::ivec3> lookups;
+    for (int i = 0; i < LOOKUPS_PER_ITERATION; i++) {
+        lookups.push_back(glm::ivec3(horizontal(rng), vertical(rng), horizontal(rng)));
+    }
+    bench.run("chunkmap/lookup", LOOKUPS_PER_ITERATION, [&world, &lookups](uint64_t n) {
+        uint64_t sum = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            for (const glm::ivec3 &p : lookups) {
+                sum += world.getBlockAt(p.x, p.y, p.z);
+            }
+        }
+        Microbench::sink(sum);
+    });
+
+    // Rays from above the ground looking down and around, the way the
+    // player looks at the block in front of them
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+    std::vector<std::pair<glm::vec3, glm::vec3>> rays;
+    for (int i = 0; i < RAYS_PER_ITERATION; i++) {
+        float biome;
+        glm::vec3 origin(16.f + 32.f * (unit(rng) + 1.f) / 2.f, 0.f, 16.f + 32.f * (unit(rng) + 1.f) / 2.f);
+        origin.y = getTerrainHeight(static_cast<int>(origin.x), static_cast<int>(origin.z), &biome) + 1.6f;
+        glm::vec3 dir = glm::normalize(glm::vec3(unit(rng), -0.5f + 0.4f * unit(rng), unit(rng)));
+        rays.push_back({origin, dir * RAY_LENGTH});
+    }
+    bench.run("raycast/gridmarch", RAYS_PER_ITERATION, [&world, &rays](uint64_t n) {
+        uint64_t hits = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            for (const auto &ray : rays) {
+                float dist;
+                glm::vec3 hit;
+                BlockType type;
+                hits += gridMarch(ray.first, ray.second, world, &dist, &hit, &type);
+            }
+        }
+        Microbench::sink(hits);
+    });
+    bench.run("raycast/dda", RAYS_PER_ITERATION, [&world, &rays](uint64_t n) {
+        uint64_t hits = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            for (const auto &ray : rays) {
+                RayHit hit;
+                hits += raycast(world, ray.first, ray.second, RAY_LENGTH, &hit);
+            }
+        }
+        Microbench::sink(hits);
+    });
+    std::vector<Ray> batch;
+    for (const auto &ray : rays) {
+        batch.push_back({ray.first, ray.second, RAY_LENGTH});
+    }
+    std::vector<RayHit> batchHits;
+    bench.run("raycast/dda_batch", RAYS_PER_ITERATION, [&world, &batch, &batchHits](uint64_t n) {
+        uint64_t hits = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            hits += raycastBatch(world, batch, &batchHits);
+        }
+        Microbench::sink(hits);
+    });
+
+    std::vector<CollisionQuery> path = walkPath(world, COLLISION_PATH_TICKS);
+    bench.run("collision/cornermarch", COLLISION_PATH_TICKS, [&world, &path](uint64_t n) {
+        float sum = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            for (const CollisionQuery &q : path) {
+                sum += cornerMarchMove(world, q.pos, q.movement).y;
+            }
+        }
+        Microbench::sink(static_cast<uint64_t>(glm::abs(sum)));
+    });
+    VoxelNeighborhood blocks;
+    bench.run("collision/sweptaabb", COLLISION_PATH_TICKS, [&world, &path, &blocks](uint64_t n) {
+        float sum = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            for (const CollisionQuery &q : path) {
+                sum += sweptMove(world, &blocks, q.pos, q.movement).movement.y;
+            }
+        }
+        Microbench::sink(static_cast<uint64_t>(glm::abs(sum)));
+    });
+
+    // One tick of the whole crowd at the simulation rate, on this thread
+    // and then spread over the thread pool
+    BenchWorld crowdWorld;
+    for (int x = 0; x < ENTITY_CROWD_ZONES; x++) {
+        for (int z = 0; z < ENTITY_CROWD_ZONES; z++) {
+            crowdWorld.generateZone(64 * x, 64 * z);
+        }
+    }
+    EntitySystem serialCrowd, parallelCrowd;
+    spawnCrowd(&serialCrowd, ENTITY_STRESS_COUNT);
+    serialCrowd.setParallel(false);
+    bench.run("entities/tick_serial", ENTITY_STRESS_COUNT, [&crowdWorld, &serialCrowd](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+            serialCrowd.tick(1.f / 60.f, crowdWorld);
+        }
+        Microbench::sink(serialCrowd.count());
+    });
+    spawnCrowd(&parallelCrowd, ENTITY_STRESS_COUNT);
+    bench.run("entities/tick_parallel", ENTITY_STRESS_COUNT, [&crowdWorld, &parallelCrowd](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+            parallelCrowd.tick(1.f / 60.f, crowdWorld);
+        }
+        Microbench::sink(parallelCrowd.count());
+    });
+    std::vector<EntityId> near;
+    bench.run("entities/near", 1, [&parallelCrowd, &near](uint64_t n) {
+        uint64_t found = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            parallelCrowd.entitiesNear(glm::vec3(4.f + i % 184, 80.f, 4.f + (i / 184) % 184), 4.f, &near);
+            found += near.size();
+        }
+        Microbench::sink(found);
+    });
+
+    // A reservoir emptying into a basin, start to finish, and then a tick
+    // of the world's lakes with nothing disturbing them
+    BenchWorld damWorld;
+    damWorld.generateZone(0, 0);
+    bench.run("fluids/dam_break", 1, [&damWorld](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+            buildDam(&damWorld);
+            FluidSim fluids;
+            int peakCells;
+            size_t blocksSet;
+            Microbench::sink(breakDam(&damWorld, &fluids, &peakCells, &blocksSet));
+        }
+    });
+    FluidSim stillFluids;
+    std::vector<glm::ivec3> stillChanges;
+    bench.run("fluids/still_tick", 1, [&damWorld, &stillFluids, &stillChanges](uint64_t n) {
+        int cells = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            cells += stillFluids.step(&damWorld, &stillChanges);
+        }
+        Microbench::sink(cells);
+    });
+
+    // How much each mesher's output would cost to draw, next to its speed
+    ChunkMeshData naive;
+    ChunkMesher::build(chunk, &naive);
+    quads.clear();
+    greedyMesh(*chunk, &quads);
+    size_t greedyQuads = quads.size();
+    quads.clear();
+    bitmaskMesh(*chunk, &quads);
+    // The two raycasters should find the same blocks
+    int agree = 0;
+    raycastBatch(world, batch, &batchHits);
+    for (size_t i = 0; i < rays.size(); i++) {
+        float dist;
+        glm::vec3 cell;
+        BlockType type;
+        // gridMarch also looks at the cell its last step overshoots into
+        bool hit = gridMarch(rays[i].first, rays[i].second, world, &dist, &cell, &type) && dist < RAY_LENGTH;
+        agree += hit ? batchHits[i].type == type && batchHits[i].cell == glm::ivec3(cell) : batchHits[i].type == EMPTY;
+    }
+    // The parallel update should move every entity exactly as the serial one does
+    EntitySystem serialCheck, parallelCheck;
+    spawnCrowd(&serialCheck, ENTITY_STRESS_COUNT);
+    spawnCrowd(&parallelCheck, ENTITY_STRESS_COUNT);
+    serialCheck.setParallel(false);
+    for (int i = 0; i < ENTITY_COMPARE_TICKS; i++) {
+        serialCheck.tick(1.f / 60.f, crowdWorld);
+        parallelCheck.tick(1.f / 60.f, crowdWorld);
+    }
+    bool entitiesMatch = serialCheck.positions() == parallelCheck.positions();
+    std::cout << "serial and parallel entity ticks " << (entitiesMatch ? "match" : "differ") << " after "
+              << ENTITY_COMPARE_TICKS << " ticks" << std::endl;
+    buildDam(&damWorld);
+    FluidSim damFluids;
+    int damPeakCells;
+    size_t damBlocksSet;
+    int damTicks = breakDam(&damWorld, &damFluids, &damPeakCells, &damBlocksSet);
+    std::cout << "dam break settled after " << damTicks << " ticks, " << damBlocksSet << " blocks set, at most "
+              << damPeakCells << " blocks looked at in a tick" << std::endl;
+    std::cout << "raycasters agree on " << agree << " of " << rays.size() << " rays" << std::endl;
+    std::cout << "quads per chunk: naive " << naive.idxDataOpaque.size() / 6
+              << " opaque + " << naive.idxDataTransparent.size() / 6 << " transparent, greedy "
+              << greedyQuads << ", bitmask " << quads.size() << std::endl;
+
+    if (!bench.writeJson(outPath)) {
+        std::cout << "bench: unable to write " << outPath << std::endl;
+        return 1;
+    }
+    // Results are still written, but a tracker reading the exit code
+    // should see the parallel update has gone wrong
+    return entitiesMatch ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+#include "meshers.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Axis and sign of each Direction, in enum order
+static const std::array<std::pair<int, int>, 6> directionAxes {{
+    {0, 1}, {0, -1}, {1, 1}, {1, -1}, {2, 1}, {2, -1}
+}};
+
+static inline BlockType blockIn(const ChunkData &chunk, int x, int y, int z) {
+    return chunk.blocks()[x + 16 * y + 16 * 256 * z];
+}
+
+// The block at chunk-space p, reaching into the neighbouring chunks.
+// Missing chunks and anything above or below the world count as EMPTY,
+// as they do for ChunkMesher.
+static BlockType blockAround(const ChunkData &chunk, glm::ivec3 p) {
+    if (p.y < 0 || p.y >= 256) {
+        return EMPTY;
+    }
+    const ChunkData *c = &chunk;
+    if (p.x < 0) {
+        c = chunk.neighbor(XNEG);
+        p.x += 16;
+    } else if (p.x >= 16) {
+        c = chunk.neighbor(XPOS);
+        p.x -= 16;
+    } else if (p.z < 0) {
+        c = chunk.neighbor(ZNEG);
+        p.z += 16;
+    } else if (p.z >= 16) {
+        c = chunk.neighbor(ZPOS);
+        p.z -= 16;
+    }
+    return c == nullptr ? EMPTY : blockIn(*c, p.x, p.y, p.z);
+}
+
+void greedyMesh(const ChunkData &chunk, std::vector<MeshQuad> *quads) {
+    const glm::ivec3 dims(16, 256, 16);
+    std::vector<BlockType> mask;
+    for (int dir = 0; dir < 6; dir++) {
+        int d = directionAxes[dir].first;
+        int sign = directionAxes[dir].second;
+        // The other two axes, in x, y, z order
+        int u = d == 0 ? 1 : 0;
+        int v = d == 2 ? 1 : 2;
+        mask.assign(dims[u] * dims[v], EMPTY);
+
+        for (int k = 0; k < dims[d]; k++) {
+            // The type of every visible face in this slice, or EMPTY
+            for (int j = 0; j < dims[v]; j++) {
+                for (int i = 0; i < dims[u]; i++) {
+                    glm::ivec3 p;
+                    p[d] = k;
+                    p[u] = i;
+                    p[v] = j;
+                    BlockType curr = blockIn(chunk, p.x, p.y, p.z);
+                    glm::ivec3 n = p;
+                    n[d] += sign;
+                    mask[i + dims[u] * j] = occludesView(curr) && !occludesView(blockAround(chunk, n)) ? curr : EMPTY;
+                }
+            }
+
+            // Grow each face along u as far as the type holds, then along v
+            // for as many whole rows of that width as match
+            for (int j = 0; j < dims[v]; j++) {
+                for (int i = 0; i < dims[u];) {
+                    BlockType t = mask[i + dims[u] * j];
+                    if (t == EMPTY) {
+                        i++;
+                        continue;
+                    }
+                    int w = 1;
+                    while (i + w < dims[u] && mask[i + w + dims[u] * j] == t) {
+                        w++;
+                    }
+                    int h = 1;
+                    for (; j + h < dims[v]; h++) {
+                        bool rowMatches = true;
+                        for (int a = 0; a < w && rowMatches; a++) {
+                            rowMatches = mask[i + a + dims[u] * (j + h)] == t;
+                        }
+                        if (!rowMatches) {
+                            break;
+                        }
+                    }
+                    for (int b = 0; b < h; b++) {
+                        std::fill_n(mask.begin() + i + dims[u] * (j + b), w, EMPTY);
+                    }
+                    glm::ivec3 p;
+                    p[d] = k;
+                    p[u] = i;
+                    p[v] = j;
+                    quads->push_back({p, glm::ivec2(w, h), static_cast<Direction>(dir), t});
+                    i += w;
+                }
+            }
+        }
+    }
+}
+
+// Bit y is set where the column's block hides what is behind it
+typedef std::array<uint64_t, 4> ColumnMask;
+
+static ColumnMask columnMask(const ChunkData *chunk, int x, int z) {
+    ColumnMask mask{};
+    if (chunk == nullptr) {
+        return mask;
+    }
+    for (int y = 0; y < 256; y++) {
+        if (occludesView(blockIn(*chunk, x, y, z))) {
+            mask[y >> 6] |= uint64_t(1) << (y & 63);
+        }
+    }
+    return mask;
+}
+
+static inline int lowestSetBit(uint64_t bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+void bitmaskMesh(const ChunkData &chunk, std::vector<MeshQuad> *quads) {
+    // The chunk's columns plus a ring of the neighbours' border columns
+    // around them; the corners of the ring are never read
+    std::array<ColumnMask, 18 * 18> columns{};
+    auto column = [&columns](int x, int z) -> ColumnMask& { return columns[(x + 1) + 18 * (z + 1)]; };
+    for (int x = 0; x < 16; x++) {
+        for (int z = 0; z < 16; z++) {
+            column(x, z) = columnMask(&chunk, x, z);
+        }
+    }
+    for (int i = 0; i < 16; i++) {
+        column(-1, i) = columnMask(chunk.neighbor(XNEG), 15, i);
+        column(16, i) = columnMask(chunk.neighbor(XPOS), 0, i);
+        column(i, -1) = columnMask(chunk.neighbor(ZNEG), i, 15);
+        column(i, 16) = columnMask(chunk.neighbor(ZPOS), i, 0);
+    }
+
+    for (int x = 0; x < 16; x++) {
+        for (int z = 0; z < 16; z++) {
+            const ColumnMask &m = column(x, z);
+            auto addQuads = [&](uint64_t faces, int word, Direction dir) {
+                while (faces != 0) {
+                    int y = 64 * word + lowestSetBit(faces);
+                    quads->push_back({glm::ivec3(x, y, z), glm::ivec2(1, 1), dir, blockIn(chunk, x, y, z)});
+                    faces &= faces - 1;
+                }
+            };
+            for (int w = 0; w < 4; w++) {
+                if (m[w] == 0) {
+                    continue;
+                }
+                // The same column shifted by one block, carrying across words
+                uint64_t above = (m[w] >> 1) | (w < 3 ? m[w + 1] << 63 : 0);
+                uint64_t below = (m[w] << 1) | (w > 0 ? m[w - 1] >> 63 : 0);
+                addQuads(m[w] & ~column(x + 1, z)[w], w, XPOS);
+                addQuads(m[w] & ~column(x - 1, z)[w], w, XNEG);
+                addQuads(m[w] & ~above, w, YPOS);
+                addQuads(m[w] & ~below, w, YNEG);
+                addQuads(m[w] & ~column(x, z + 1)[w], w, ZPOS);
+                addQuads(m[w] & ~column(x, z - 1)[w], w, ZNEG);
+            }
+        }
+    }
+}
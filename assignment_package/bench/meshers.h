@@ -0,0 +1,24 @@
+#pragma once
+#include "scene/chunkdata.h"
+#include <vector>
+
+// Candidate meshers to compare against ChunkMesher. They only emit the
+// faces of full, view-blocking blocks (see occludesView) as bare quads,
+// without vertex data, so what they measure is face finding and merging.
+
+// An axis-aligned face, size.x blocks along the first of the other two
+// axes (in x, y, z order) and size.y along the second
+struct MeshQuad {
+    glm::ivec3 pos;
+    glm::ivec2 size;
+    Direction dir;
+    BlockType type;
+};
+
+// Merges adjacent faces of the same block type facing the same way into
+// rectangles, one 2D slice of the chunk at a time
+void greedyMesh(const ChunkData &chunk, std::vector<MeshQuad> *quads);
+
+// One quad per visible face, found by comparing whole columns of blocks
+// as 256-bit masks instead of looking at neighbours one block at a time
+void bitmaskMesh(const ChunkData &chunk, std::vector<MeshQuad> *quads);
@@ -0,0 +1,102 @@
+#include "microbench.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+static volatile uint64_t sinkValue = 0;
+
+void Microbench::sink(uint64_t value) {
+    sinkValue = sinkValue + value;
+}
+
+QJsonObject MicrobenchResult::toJson() const {
+    QJsonObject result;
+    result["name"] = QString::fromStdString(name);
+    result["iterations"] = static_cast<qint64>(iterations);
+    result["repetitions"] = static_cast<int>(batchNs.size());
+    result["ns_min"] = min;
+    result["ns_median"] = median;
+    result["ns_mean"] = mean;
+    result["ns_stddev"] = stddev;
+    result["items_per_second"] = median > 0 ? itemsPerIteration * 1e9 / median : 0.0;
+    QJsonArray batches;
+    for (double ns : batchNs) {
+        batches.append(ns);
+    }
+    result["ns_batches"] = batches;
+    return result;
+}
+
+Microbench::Microbench(int repetitions, const std::string &filter)
+    : m_repetitions(std::max(repetitions, 1)), m_filter(filter), m_results()
+{}
+
+double Microbench::timeBatch(const std::function<void(uint64_t)> &body, uint64_t iterations) {
+    auto start = std::chrono::steady_clock::now();
+    body(iterations);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+void Microbench::run(const std::string &name, uint64_t itemsPerIteration,
+                     const std::function<void(uint64_t)> &body) {
+    if (name.find(m_filter) == std::string::npos) {
+        return;
+    }
+
+    // The first batch also warms up caches and the allocator
+    uint64_t iterations = 1;
+    while (timeBatch(body, iterations) < MICROBENCH_MIN_BATCH_SECONDS) {
+        iterations *= 2;
+    }
+
+    MicrobenchResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.itemsPerIteration = itemsPerIteration;
+    for (int i = 0; i < m_repetitions; i++) {
+        result.batchNs.push_back(timeBatch(body, iterations) * 1e9 / iterations);
+    }
+
+    std::vector<double> sorted = result.batchNs;
+    std::sort(sorted.begin(), sorted.end());
+    size_t n = sorted.size();
+    result.min = sorted.front();
+    result.median = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    double sum = 0;
+    for (double ns : sorted) {
+        sum += ns;
+    }
+    result.mean = sum / n;
+    double squares = 0;
+    for (double ns : sorted) {
+        squares += (ns - result.mean) * (ns - result.mean);
+    }
+    result.stddev = n > 1 ? std::sqrt(squares / (n - 1)) : 0;
+
+    std::cout << name << ": " << result.median << " ns (min " << result.min
+              << ", stddev " << result.stddev << ", " << iterations << " iterations x "
+              << m_repetitions << ")" << std::endl;
+    m_results.push_back(result);
+}
+
+bool Microbench::writeJson(const std::string &path) const {
+    QJsonArray cases;
+    for (const MicrobenchResult &result : m_results) {
+        cases.append(result.toJson());
+    }
+    QJsonObject root;
+    root["repetitions"] = m_repetitions;
+    root["benchmarks"] = cases;
+
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson());
+    return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <QJsonObject>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Timed batches per case when --repetitions isn't given
+#define MICROBENCH_DEFAULT_REPETITIONS 10
+// Iterations are doubled until one batch takes at least this long, so the
+// clock's resolution is small next to what is being measured
+#define MICROBENCH_MIN_BATCH_SECONDS 0.05
+
+// Results of one case. Every time is per iteration, in nanoseconds.
+struct MicrobenchResult {
+    std::string name;
+    uint64_t iterations;     // Per batch
+    uint64_t itemsPerIteration;
+    std::vector<double> batchNs;
+    double min, median, mean, stddev;
+
+    QJsonObject toJson() const;
+};
+
+// Runs small pieces of code over and over and reports how long one run
+// takes. A case is a function that does its work `iterations` times;
+// whatever it computes should go through sink() so it isn't optimized out.
+class Microbench {
+private:
+    int m_repetitions;
+    std::string m_filter;
+    std::vector<MicrobenchResult> m_results;
+
+    // Seconds one call of body(iterations) takes
+    static double timeBatch(const std::function<void(uint64_t)> &body, uint64_t iterations);
+
+public:
+    // Only cases whose names contain filter are run
+    Microbench(int repetitions, const std::string &filter);
+
+    // itemsPerIteration is how many things (blocks, lookups, rays) one
+    // iteration handles, for the items per second in the report
+    void run(const std::string &name, uint64_t itemsPerIteration,
+             const std::function<void(uint64_t)> &body);
+
+    // Writes every result to path as JSON. Returns false if it can't.
+    bool writeJson(const std::string &path) const;
+
+    static void sink(uint64_t value);
+};
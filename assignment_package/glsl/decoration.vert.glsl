@@ -0,0 +1,50 @@
+#version 150
+// ^ Change this to version 130 if you have compatibility issues
+
+// Draws torches, levers and plants with instanced rendering. The mesh is one
+// decoration shape around a block's corner, and each instance is one block
+// of a chunk that has that shape. Shares lambert.frag.glsl with the terrain.
+
+layout(std140) uniform PerFrame {   // Shared by every program; see frameuniforms.h
+    mat4 u_ViewProj;
+    vec4 u_CameraPos;
+    vec4 u_FogColor;
+    vec4 u_FogParams;               // x: distance fog starts, y: distance it is opaque
+    int u_Time;
+    vec2 u_ViewportScale;           // Fraction of the offscreen color texture the scene covers
+};
+
+uniform vec3 u_ChunkOrigin;         // Corner of the chunk whose instances are being drawn
+
+uniform vec4 u_DecorationTypes[32]; // Per BlockType: atlas cell in xy, how far the mesh moves
+                                    // along x when switched on in z; see decorationTypeTable()
+
+in vec4 vs_Pos;             // Position around the block's corner
+in vec4 vs_Nor;
+in vec3 vs_UV;              // Offset into the block's atlas cell
+
+in vec3 vs_OffsetInstanced; // The block's corner, in chunk space
+in vec2 vs_InstanceData;    // x: BlockType, y: 1 if switched on
+
+out vec4 fs_Pos;
+out vec4 fs_Nor;
+out vec4 fs_LightVec;
+out vec4 fs_Col;
+out vec3 fs_UV;
+
+const vec4 lightDir = normalize(vec4(0.5, 1, 0.75, 0));  // Must match lambert.vert.glsl
+
+void main()
+{
+    vec4 type = u_DecorationTypes[int(vs_InstanceData.x + 0.5)];
+    vec3 offset = vs_OffsetInstanced + vec3(type.z * vs_InstanceData.y, 0, 0);
+    vec4 worldPos = vs_Pos + vec4(u_ChunkOrigin + offset, 0);
+
+    fs_Pos = worldPos;
+    fs_Nor = vs_Nor;
+    fs_Col = vec4(1);
+    fs_UV = vec3(type.xy / 16.0 + vs_UV.xy, 0);    // Never animated liquid
+    fs_LightVec = lightDir;
+
+    gl_Position = u_ViewProj * worldPos;
+}
@@ -4,7 +4,15 @@
 // Refer to the lambert shader files for useful comments
 
 uniform mat4 u_Model;
-uniform mat4 u_ViewProj;
+
+layout(std140) uniform PerFrame {   // Shared by every program; see frameuniforms.h
+    mat4 u_ViewProj;
+    vec4 u_CameraPos;
+    vec4 u_FogColor;
+    vec4 u_FogParams;               // x: distance fog starts, y: distance it is opaque
+    int u_Time;
+    vec2 u_ViewportScale;           // Fraction of the offscreen color texture the scene covers
+};
 
 in vec4 vs_Pos;
 in vec4 vs_Col;
@@ -7,9 +7,14 @@
 //This simultaneous transformation allows your program to run much faster, especially when rendering
 //geometry with millions of vertices.
 
-uniform mat4 u_ViewProj;    // The matrix that defines the camera's transformation.
-                            // We've written a static matrix for you to use for HW2,
-                            // but in HW3 you'll have to generate one yourself
+layout(std140) uniform PerFrame {   // Shared by every program; see frameuniforms.h
+    mat4 u_ViewProj;
+    vec4 u_CameraPos;
+    vec4 u_FogColor;
+    vec4 u_FogParams;               // x: distance fog starts, y: distance it is opaque
+    int u_Time;
+    vec2 u_ViewportScale;           // Fraction of the offscreen color texture the scene covers
+};
 
 in vec4 vs_Pos;             // The array of vertex positions passed to the shader
 in vec4 vs_Nor;             // The array of vertex normals passed to the shader
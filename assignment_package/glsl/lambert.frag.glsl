@@ -14,7 +14,16 @@
 uniform vec4 u_Color; // The color with which to render this instance of geometry.
 
 uniform sampler2D u_Texture; // MS2: The texture to be read from by this shader
-uniform int u_Time;  // MS2: Time to animate
+uniform sampler2DArray u_Noise; // Animated liquid noise, one layer per frame; see noisetexture.h
+
+layout(std140) uniform PerFrame {   // Shared by every program; see frameuniforms.h
+    mat4 u_ViewProj;
+    vec4 u_CameraPos;
+    vec4 u_FogColor;
+    vec4 u_FogParams;               // x: distance fog starts, y: distance it is opaque
+    int u_Time;
+    vec2 u_ViewportScale;           // Fraction of the offscreen color texture the scene covers
+};
 
 // These are the interpolated values out of the rasterizer, so you can't know
 // their specific values without knowing the vertices that contributed to them
@@ -37,30 +46,17 @@ abs(Val - 10.f) <= epsilon
 
   */
 
-float worleyNoise(vec2 uv, float time) {
-    float maxDist = 0.0;
-    vec2 maxDistVec = vec2(0.0);
-
-    for (int xo = -1; xo <= 1; ++xo) {
-        for (int yo = -1; yo <= 1; ++yo) {
-            vec2 offset = vec2(float(xo), float(yo));
-            vec2 pos = floor(uv) + offset;
-            vec2 randomVec = vec2(
-                fract(sin(dot(pos, vec2(127.1, 311.7))) * 43758.5453 + time),
-                fract(sin(dot(pos, vec2(269.5, 183.3))) * 43758.5453 + time)
-            );
-
-            vec2 delta = randomVec - fract(uv);
-            float dist = length(delta);
-
-            if (dist > maxDist) {
-                maxDist = dist;
-                maxDistVec = delta;
-            }
-        }
-    }
-
-    return maxDist;
+const float noiseCells = 8.0;   // Worley cells across the noise texture, NOISE_TEXTURE_CELLS
+
+// Blends the two noise layers either side of the current time, so that
+// the animation stays smooth between layers
+float sampleNoise(vec2 uv) {
+    float layers = float(textureSize(u_Noise, 0).z);
+    float t = fract(u_Time * 0.01) * layers;
+    float layer = floor(t);
+    return mix(texture(u_Noise, vec3(uv, layer)).r,
+               texture(u_Noise, vec3(uv, mod(layer + 1.0, layers))).r,
+               t - layer);
 }
 
 void main()
@@ -71,8 +67,9 @@ void main()
     vec4 diffuseColor;
 
     if (fs_UV.z == 1) {
-        // Generate worley noise texture
-        float worley = worleyNoise(fs_UV.xy * 10 , u_Time*0.01);
+        // Look up worley noise, ten cells across the texture atlas
+        // (stored divided by sqrt(2) to fit the texture's range)
+        float worley = sampleNoise(fs_UV.xy * 10 / noiseCells) * sqrt(2.0);
 
         // Apply offset
         float maxOffset = 0.0625f * 2;
@@ -133,4 +130,8 @@ void main()
 
         // Compute final shaded color
        out_Col = vec4(diffuseColor.rgb * lightIntensity, diffuseColor.a);
+
+        // Fade into the sky towards the edge of the loaded terrain
+        float fog = smoothstep(u_FogParams.x, u_FogParams.y, length(fs_Pos.xyz - u_CameraPos.xyz));
+        out_Col.rgb = mix(out_Col.rgb, u_FogColor.rgb, fog);
 }
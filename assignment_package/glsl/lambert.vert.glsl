@@ -8,20 +8,23 @@
 //This simultaneous transformation allows your program to run much faster, especially when rendering
 //geometry with millions of vertices.
 
-uniform mat4 u_Model;       // The matrix that defines the transformation of the
-                            // object we're rendering. In this assignment,
-                            // this will be the result of traversing your scene graph.
-
-uniform mat4 u_ModelInvTr;  // The inverse transpose of the model matrix.
-                            // This allows us to transform the object's normals properly
-                            // if the object has been non-uniformly scaled.
-
-uniform mat4 u_ViewProj;    // The matrix that defines the camera's transformation.
-                            // We've written a static matrix for you to use for HW2,
-                            // but in HW3 you'll have to generate one yourself
+layout(std140) uniform PerFrame {   // Shared by every program; see frameuniforms.h
+    mat4 u_ViewProj;
+    vec4 u_CameraPos;
+    vec4 u_FogColor;
+    vec4 u_FogParams;               // x: distance fog starts, y: distance it is opaque
+    int u_Time;
+    vec2 u_ViewportScale;           // Fraction of the offscreen color texture the scene covers
+};
+
+uniform vec3 u_ChunkOrigin; // Where the mesh's vertex positions are measured from.
+                            // Terrain meshes store positions relative to their chunk
+                            // so that only this changes from draw to draw.
+
+uniform sampler2DArray u_Noise; // Animated liquid noise, one layer per frame; see noisetexture.h.
+                                // r: noise, g and b: its x and y slopes.
 
 uniform vec4 u_Color;       // When drawing the cube instance, we'll set our uniform color to represent different block types.
-uniform int u_Time;
 in vec4 vs_Pos;             // The array of vertex positions passed to the shader
 
 in vec4 vs_Nor;             // The array of vertex normals passed to the shader
@@ -39,31 +42,36 @@ const vec4 lightDir = normalize(vec4(0.5, 1, 0.75, 0));  // The direction of our
                                         // the geometry in the fragment shader.
 out vec3 fs_UV;             // The UV of each vertex. This is implicitly passed to the fragment shader.
 
+const float noiseTileBlocks = 16.0;     // Blocks covered by one repeat of the noise texture
+
+// Blends the two noise layers either side of the current time, so that
+// the animation stays smooth between layers
+vec4 sampleNoise(vec2 uv) {
+    float layers = float(textureSize(u_Noise, 0).z);
+    float t = fract(u_Time * 0.01) * layers;
+    float layer = floor(t);
+    return mix(textureLod(u_Noise, vec3(uv, layer), 0.0),
+               textureLod(u_Noise, vec3(uv, mod(layer + 1.0, layers)), 0.0),
+               t - layer);
+}
+
 void main()
 {
-    fs_Pos = vs_Pos;
+    vec4 worldPos = vs_Pos + vec4(u_ChunkOrigin, 0);
+    fs_Pos = worldPos;
     fs_Col = vs_Col;                         // Pass the vertex colors to the fragment shader for interpolation
     fs_UV = vs_UV;
 
-    mat3 invTranspose = mat3(u_ModelInvTr);
-    fs_Nor = vec4(invTranspose * vec3(vs_Nor), 0);          // Pass the vertex normals to the fragment shader for interpolation.
-                                                            // Transform the geometry's normals by the inverse transpose of the
-                                                            // model matrix. This is necessary to ensure the normals remain
-                                                            // perpendicular to the surface after the surface is transformed by
-                                                            // the model matrix.
+    fs_Nor = vs_Nor;                        // Terrain is never rotated or scaled, so normals pass through as they are
 
     if (fs_UV.z == 1) {
-        fs_Pos.y += sin(fs_Pos.x * 10.0 + (u_Time) * 0.1) * 0.1;
-        fs_Pos.y += sin(fs_Pos.z * 10.0 + (u_Time) * 0.1) * 0.1;
-
-        fs_Nor.y += cos(fs_Pos.x * 10.0 + (u_Time) * 0.1) * 0.1;
-        fs_Nor.y += cos(fs_Pos.z * 10.0 + (u_Time) * 0.1) * 0.1;
+        vec4 noise = sampleNoise(fs_Pos.xz / noiseTileBlocks);
+        fs_Pos.y += (noise.r - 0.5) * 0.4;
+        fs_Nor.xz -= (noise.gb - 0.5) * 0.4;
     }
 
-    vec4 modelposition = u_Model * vs_Pos;   // Temporarily store the transformed vertex positions for use below
-
     fs_LightVec = (lightDir);  // Compute the direction in which the light source lies
 
-    gl_Position = u_ViewProj * modelposition;// gl_Position is a built-in variable of OpenGL which is
+    gl_Position = u_ViewProj * worldPos;     // gl_Position is a built-in variable of OpenGL which is
                                              // used to render the final positions of the geometry's vertices
 }
@@ -0,0 +1,208 @@
+#include "benchmark.h"
+#include "mygl.h"
+#include "framebuffer.h"
+#include "memorystats.h"
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QThreadPool>
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+BenchmarkOptions::BenchmarkOptions()
+    : enabled(false), seconds(BENCH_DEFAULT_SECONDS), seed(0), outPath("bench.json")
+{}
+
+BenchmarkOptions BenchmarkOptions::fromArguments(const QStringList &arguments) {
+    BenchmarkOptions options;
+    for (const QString &arg : arguments) {
+        if (arg == "--bench" || arg.startsWith("--bench=")) {
+            options.enabled = true;
+            QString seconds = arg.section('=', 1);
+            if (!seconds.isEmpty()) {
+                options.seconds = std::max(seconds.toFloat(), BENCH_TIME_STEP);
+            }
+        } else if (arg.startsWith("--bench-seed=")) {
+            options.seed = arg.section('=', 1).toUInt();
+        } else if (arg.startsWith("--bench-out=")) {
+            options.outPath = arg.section('=', 1).toStdString();
+        }
+    }
+    return options;
+}
+
+// Uniform in [0, 1). Done by hand because the standard distributions
+// may give different numbers on different standard libraries.
+static float unitRandom(std::mt19937 &rng) {
+    return static_cast<float>(rng() >> 8) / 16777216.f;
+}
+
+BenchmarkPath::BenchmarkPath(uint32_t seed, float seconds)
+    : m_points()
+{
+    std::mt19937 rng(seed);
+    // Seed 0 starts at the spawn point; any other seed somewhere far off,
+    // in the same spot within its zone
+    glm::vec3 point(48.f, BENCH_MIN_HEIGHT, 48.f);
+    if (seed != 0) {
+        point.x += 64.f * (static_cast<int>(rng() % 2048) - 1024);
+        point.z += 64.f * (static_cast<int>(rng() % 2048) - 1024);
+    }
+    float heading = 2.f * glm::pi<float>() * unitRandom(rng);
+
+    // One extra point before the start and two past the end, which the
+    // first and last segments need as neighbours
+    int count = static_cast<int>(glm::ceil(seconds / BENCH_SEGMENT_SECONDS)) + 3;
+    for (int i = 0; i < count; i++) {
+        point.y = glm::mix(BENCH_MIN_HEIGHT, BENCH_MAX_HEIGHT, unitRandom(rng));
+        m_points.push_back(point);
+        point += BENCH_SEGMENT_LENGTH * glm::vec3(glm::cos(heading), 0.f, glm::sin(heading));
+        heading += 0.5f * glm::pi<float>() * (unitRandom(rng) - 0.5f);
+    }
+}
+
+glm::vec3 BenchmarkPath::position(float time) const {
+    int segment = std::min(static_cast<int>(time / BENCH_SEGMENT_SECONDS), static_cast<int>(m_points.size()) - 4);
+    float u = time / BENCH_SEGMENT_SECONDS - segment;
+    const glm::vec3 &p0 = m_points[segment], &p1 = m_points[segment + 1];
+    const glm::vec3 &p2 = m_points[segment + 2], &p3 = m_points[segment + 3];
+    return 0.5f * (2.f * p1 + (p2 - p0) * u +
+                   (2.f * p0 - 5.f * p1 + 4.f * p2 - p3) * u * u +
+                   (3.f * p1 - p0 - 3.f * p2 + p3) * u * u * u);
+}
+
+glm::vec3 BenchmarkPath::forward(float time) const {
+    int segment = std::min(static_cast<int>(time / BENCH_SEGMENT_SECONDS), static_cast<int>(m_points.size()) - 4);
+    float u = time / BENCH_SEGMENT_SECONDS - segment;
+    const glm::vec3 &p0 = m_points[segment], &p1 = m_points[segment + 1];
+    const glm::vec3 &p2 = m_points[segment + 2], &p3 = m_points[segment + 3];
+    glm::vec3 tangent = 0.5f * ((p2 - p0) +
+                                2.f * (2.f * p0 - 5.f * p1 + 4.f * p2 - p3) * u +
+                                3.f * (3.f * p1 - p0 - 3.f * p2 + p3) * u * u);
+    // Level it out first so climbs and dives never point straight up or down
+    tangent.y = 0.f;
+    return glm::normalize(glm::normalize(tangent) + glm::vec3(0.f, -0.3f, 0.f));
+}
+
+Benchmark::Benchmark(const BenchmarkOptions &options)
+    : m_options(options)
+{}
+
+uint64_t Benchmark::peakResidentBytes() {
+#if defined(__linux__) || defined(__APPLE__)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return usage.ru_maxrss;
+#else
+    // Linux reports kilobytes
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+float Benchmark::percentile(const std::vector<float> &sorted, float p) {
+    if (sorted.empty()) {
+        return 0.f;
+    }
+    size_t rank = static_cast<size_t>(glm::ceil(p / 100.f * sorted.size()));
+    return sorted[glm::clamp(rank, size_t(1), sorted.size()) - 1];
+}
+
+int Benchmark::run() {
+    QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+    QOffscreenSurface surface;
+    surface.setFormat(format);
+    surface.create();
+    QOpenGLContext context;
+    context.setFormat(format);
+    if (!context.create() || !context.makeCurrent(&surface)) {
+        std::cout << "bench: unable to create an offscreen OpenGL context" << std::endl;
+        return 1;
+    }
+
+    std::vector<float> frameMs;
+    QJsonObject result;
+    {
+        // Never shown, so it draws with our context rather than one of its own
+        MyGL gl;
+        gl.prepareBenchmark();
+        gl.resize(BENCH_WIDTH, BENCH_HEIGHT);
+        gl.initializeGL();
+        FrameBuffer target(&gl, BENCH_WIDTH, BENCH_HEIGHT, gl.devicePixelRatio());
+        target.create();
+        gl.setTargetFramebufferObject(target.frameBufferObject());
+        gl.resizeGL(BENCH_WIDTH, BENCH_HEIGHT);
+
+        BenchmarkPath path(m_options.seed, m_options.seconds);
+        int frames = std::max(1, static_cast<int>(m_options.seconds / BENCH_TIME_STEP));
+        frameMs.reserve(frames);
+        QElapsedTimer wallTimer;
+        wallTimer.start();
+        for (int i = 0; i < frames; i++) {
+            float time = i * BENCH_TIME_STEP;
+            QElapsedTimer frameTimer;
+            frameTimer.start();
+            gl.benchmarkFrame(path.position(time), path.forward(time));
+            // Count the GPU's share of the frame too
+            gl.glFinish();
+            frameMs.push_back(frameTimer.nsecsElapsed() / 1e6f);
+        }
+
+        const TerrainCounters &counters = gl.terrainCounters();
+        result["seconds"] = m_options.seconds;
+        result["seed"] = static_cast<qint64>(m_options.seed);
+        result["frames"] = frames;
+        result["wall_seconds"] = wallTimer.elapsed() / 1000.0;
+        result["renderer"] = reinterpret_cast<const char*>(gl.glGetString(GL_RENDERER));
+        result["chunks_generated"] = static_cast<qint64>(counters.chunksGenerated);
+        result["meshes_built"] = static_cast<qint64>(counters.meshesBuilt);
+        result["upload_bytes"] = static_cast<qint64>(counters.uploadBytes);
+        result["fluid_cells_updated"] = static_cast<qint64>(counters.fluidCellsUpdated);
+        // Taken while the world is still loaded
+        result["memory"] = MemoryStats::toJson();
+
+        // Workers still running would outlive the chunks they write to
+        QThreadPool::globalInstance()->waitForDone();
+        target.destroy();
+    }
+    context.doneCurrent();
+
+    std::vector<float> sorted = frameMs;
+    std::sort(sorted.begin(), sorted.end());
+    double totalMs = 0.0;
+    for (float ms : frameMs) {
+        totalMs += ms;
+    }
+    QJsonObject frameTimes;
+    frameTimes["p50"] = percentile(sorted, 50.f);
+    frameTimes["p95"] = percentile(sorted, 95.f);
+    frameTimes["p99"] = percentile(sorted, 99.f);
+    frameTimes["mean"] = totalMs / frameMs.size();
+    frameTimes["max"] = sorted.back();
+    result["frame_ms"] = frameTimes;
+    result["peak_rss_bytes"] = static_cast<qint64>(peakResidentBytes());
+
+    QFile file(QString::fromStdString(m_options.outPath));
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        std::cout << "bench: unable to write " << m_options.outPath << std::endl;
+        return 1;
+    }
+    file.write(QJsonDocument(result).toJson());
+    file.close();
+    std::cout << "bench: " << frameMs.size() << " frames, p50 " << percentile(sorted, 50.f) << " ms, p99 "
+              << percentile(sorted, 99.f) << " ms, written to " << m_options.outPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "glm_includes.h"
+#include <QStringList>
+#include <string>
+#include <vector>
+
+// Seconds of flight when --bench is given without a number
+#define BENCH_DEFAULT_SECONDS 30.f
+// Simulated time between frames. The flight advances by this much every
+// frame however long the frame took, so every run draws the same frames.
+#define BENCH_TIME_STEP (1.f / 60.f)
+// Size of the offscreen image frames are drawn into
+#define BENCH_WIDTH 1280
+#define BENCH_HEIGHT 720
+// Blocks between the spline's control points, and seconds spent flying
+// from one to the next
+#define BENCH_SEGMENT_LENGTH 96.f
+#define BENCH_SEGMENT_SECONDS 6.f
+// Height range of the control points
+#define BENCH_MIN_HEIGHT 150.f
+#define BENCH_MAX_HEIGHT 185.f
+
+// What --bench[=seconds], --bench-seed=<n> and --bench-out=<file> asked for
+struct BenchmarkOptions {
+    bool enabled;
+    float seconds;
+    uint32_t seed;
+    std::string outPath;
+
+    BenchmarkOptions();
+    static BenchmarkOptions fromArguments(const QStringList &arguments);
+};
+
+// A Catmull-Rom spline through a wandering line of control points. The
+// terrain itself has no seed, so the seed picks where in the world the
+// flight starts and which way it turns.
+class BenchmarkPath {
+private:
+    std::vector<glm::vec3> m_points;
+
+public:
+    // Lays out enough control points for seconds of flight
+    BenchmarkPath(uint32_t seed, float seconds);
+
+    glm::vec3 position(float time) const;
+    // Direction of travel, tipped a little towards the ground
+    glm::vec3 forward(float time) const;
+};
+
+// Renders the flight headlessly into a frame buffer of an offscreen GL
+// context, so it runs without a window or a GPU (e.g. on Mesa's llvmpipe
+// with QT_QPA_PLATFORM=offscreen), then writes frame time percentiles,
+// the terrain's work counters and the peak memory use to a JSON file.
+class Benchmark {
+private:
+    BenchmarkOptions m_options;
+
+    // Resident set high-water mark of the process in bytes, or 0 where unknown
+    static uint64_t peakResidentBytes();
+    // Nearest-rank percentile of sorted
+    static float percentile(const std::vector<float> &sorted, float p);
+
+public:
+    Benchmark(const BenchmarkOptions &options);
+
+    // Returns the process exit code
+    int run();
+};
@@ -5,7 +5,7 @@ Drawable::Drawable(OpenGLContext* context)
     : m_count(-1), m_countOpq(-1), m_countTra(-1),
       m_bufIdx(),
       m_bufIdxOpq(), m_bufIdxTra(),
-      m_bufPos(), m_bufNor(), m_bufCol(),
+      m_bufPos(), m_bufNor(), m_bufCol(), m_bufUV(),
       m_bufInterleaved(),
       m_bufInterleavedOpq(), m_bufInterleavedTra(),
       m_idxGenerated(false),
@@ -14,6 +14,7 @@ Drawable::Drawable(OpenGLContext* context)
       m_uvGenerated(false),
       m_interleavedGenerated(false),
       m_interleavedGeneratedOpq(false), m_interleavedGeneratedTra(false),
+      m_vaoOpq(), m_vaoTra(), m_vaoGeneratedOpq(false), m_vaoGeneratedTra(false),
       mp_context(context)
 {}
 
@@ -21,15 +22,43 @@ Drawable::~Drawable()
 {}
 
 
+// Deletes a buffer only if it was actually generated, so that
+// destroying a Drawable twice (or before creating it) is harmless
+static void deleteBufferIfGenerated(OpenGLContext *context, GLuint &buf, bool &generated) {
+    if (generated) {
+        context->deleteBufferTracked(buf);
+        buf = 0;
+        generated = false;
+    }
+}
+
 void Drawable::destroyVBOdata()
 {
-    mp_context->glDeleteBuffers(1, &m_bufIdx);
-    mp_context->glDeleteBuffers(1, &m_bufPos);
-    mp_context->glDeleteBuffers(1, &m_bufNor);
-    mp_context->glDeleteBuffers(1, &m_bufCol);
-    mp_context->glDeleteBuffers(1, &m_bufUV); // MS2: UV Changed
-    m_idxGenerated = m_posGenerated = m_norGenerated = m_colGenerated = false;
+    deleteBufferIfGenerated(mp_context, m_bufIdx, m_idxGenerated);
+    deleteBufferIfGenerated(mp_context, m_bufIdxOpq, m_idxGeneratedOpq);
+    deleteBufferIfGenerated(mp_context, m_bufIdxTra, m_idxGeneratedTra);
+    deleteBufferIfGenerated(mp_context, m_bufPos, m_posGenerated);
+    deleteBufferIfGenerated(mp_context, m_bufNor, m_norGenerated);
+    deleteBufferIfGenerated(mp_context, m_bufCol, m_colGenerated);
+    deleteBufferIfGenerated(mp_context, m_bufUV, m_uvGenerated); // MS2: UV Changed
+    deleteBufferIfGenerated(mp_context, m_bufInterleaved, m_interleavedGenerated);
+    deleteBufferIfGenerated(mp_context, m_bufInterleavedOpq, m_interleavedGeneratedOpq);
+    deleteBufferIfGenerated(mp_context, m_bufInterleavedTra, m_interleavedGeneratedTra);
+    if (m_vaoGeneratedOpq || m_vaoGeneratedTra) {
+        // GL would bind 0 in place of a deleted VAO that is still bound
+        mp_context->bindDefaultVertexArray();
+    }
+    if (m_vaoGeneratedOpq) {
+        mp_context->glDeleteVertexArrays(1, &m_vaoOpq);
+        m_vaoGeneratedOpq = false;
+    }
+    if (m_vaoGeneratedTra) {
+        mp_context->glDeleteVertexArrays(1, &m_vaoTra);
+        m_vaoGeneratedTra = false;
+    }
     m_count = -1;
+    m_countOpq = 0;
+    m_countTra = 0;
 }
 
 GLenum Drawable::drawMode()
@@ -58,62 +87,82 @@ int Drawable::traCount() {
 
 void Drawable::generateIdx()
 {
-    m_idxGenerated = true;
     // Create a VBO on our GPU and store its handle in bufIdx
-    mp_context->glGenBuffers(1, &m_bufIdx);
+    if (!m_idxGenerated) {
+        mp_context->glGenBuffers(1, &m_bufIdx);
+    }
+    m_idxGenerated = true;
 }
 
 void Drawable::generateIdxOpq() {
+    if (!m_idxGeneratedOpq) {
+        mp_context->glGenBuffers(1, &m_bufIdxOpq);
+    }
     m_idxGeneratedOpq = true;
-    mp_context->glGenBuffers(1, &m_bufIdxOpq);
 }
 
 void Drawable::generateIdxTra() {
+    if (!m_idxGeneratedTra) {
+        mp_context->glGenBuffers(1, &m_bufIdxTra);
+    }
     m_idxGeneratedTra = true;
-    mp_context->glGenBuffers(1, &m_bufIdxTra);
 }
 
 void Drawable::generatePos()
 {
-    m_posGenerated = true;
     // Create a VBO on our GPU and store its handle in bufPos
-    mp_context->glGenBuffers(1, &m_bufPos);
+    if (!m_posGenerated) {
+        mp_context->glGenBuffers(1, &m_bufPos);
+    }
+    m_posGenerated = true;
 }
 
 void Drawable::generateNor()
 {
-    m_norGenerated = true;
     // Create a VBO on our GPU and store its handle in bufNor
-    mp_context->glGenBuffers(1, &m_bufNor);
+    if (!m_norGenerated) {
+        mp_context->glGenBuffers(1, &m_bufNor);
+    }
+    m_norGenerated = true;
 }
 
 void Drawable::generateCol()
 {
-    m_colGenerated = true;
     // Create a VBO on our GPU and store its handle in bufCol
-    mp_context->glGenBuffers(1, &m_bufCol);
+    if (!m_colGenerated) {
+        mp_context->glGenBuffers(1, &m_bufCol);
+    }
+    m_colGenerated = true;
 }
 
 void Drawable::generateUV()
 {
-    m_uvGenerated = true;
     // Create a VBO on our GPU and store its handle in bufCol
-    mp_context->glGenBuffers(1, &m_bufUV);
+    if (!m_uvGenerated) {
+        mp_context->glGenBuffers(1, &m_bufUV);
+    }
+    m_uvGenerated = true;
 }
 
 void Drawable::generateInterleaved() {
+    if (!m_interleavedGenerated) {
+        mp_context->glGenBuffers(1, &m_bufInterleaved);
+    }
     m_interleavedGenerated = true;
-    mp_context->glGenBuffers(1, &m_bufInterleaved);
 }
 
 void Drawable::generateInterleavedOpq() {
+    if (!m_interleavedGeneratedOpq) {
+        mp_context->glGenBuffers(1, &m_bufInterleavedOpq);
+    }
     m_interleavedGeneratedOpq = true;
-    mp_context->glGenBuffers(1, &m_bufInterleavedOpq);
 }
 
 void Drawable::generateInterleavedTra() {
+    if (!m_interleavedGeneratedTra) {
+        mp_context->glGenBuffers(1, &m_bufInterleavedTra);
+    }
     m_interleavedGeneratedTra = true;
-    mp_context->glGenBuffers(1, &m_bufInterleavedTra);
 }
 
 bool Drawable::bindIdx()
@@ -193,6 +242,46 @@ bool Drawable::bindInterleavedTra() {
     return m_interleavedGeneratedTra;
 }
 
+void Drawable::setUpInterleavedVAO(GLuint &vao, bool &generated, GLuint bufInterleaved, GLuint bufIdx) {
+    if (!generated) {
+        mp_context->glGenVertexArrays(1, &vao);
+        generated = true;
+    }
+    mp_context->bindVertexArrayCached(vao);
+    mp_context->glBindBuffer(GL_ARRAY_BUFFER, bufInterleaved);
+    mp_context->glEnableVertexAttribArray(ATTR_LOC_POS);
+    mp_context->glVertexAttribPointer(ATTR_LOC_POS, 4, GL_FLOAT, false, 11 * sizeof(float), (void*) 0);
+    mp_context->glEnableVertexAttribArray(ATTR_LOC_NOR);
+    mp_context->glVertexAttribPointer(ATTR_LOC_NOR, 4, GL_FLOAT, false, 11 * sizeof(float), (void*) sizeof(glm::vec4));
+    mp_context->glEnableVertexAttribArray(ATTR_LOC_UV);
+    mp_context->glVertexAttribPointer(ATTR_LOC_UV, 3, GL_FLOAT, false, 11 * sizeof(float), (void*) (2 * sizeof(glm::vec4)));
+    mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufIdx);
+    mp_context->bindDefaultVertexArray();
+}
+
+void Drawable::generateInterleavedVAOs() {
+    if (m_interleavedGeneratedOpq && m_idxGeneratedOpq) {
+        setUpInterleavedVAO(m_vaoOpq, m_vaoGeneratedOpq, m_bufInterleavedOpq, m_bufIdxOpq);
+    }
+    if (m_interleavedGeneratedTra && m_idxGeneratedTra) {
+        setUpInterleavedVAO(m_vaoTra, m_vaoGeneratedTra, m_bufInterleavedTra, m_bufIdxTra);
+    }
+}
+
+bool Drawable::bindVAOOpq() {
+    if (m_vaoGeneratedOpq) {
+        mp_context->bindVertexArrayCached(m_vaoOpq);
+    }
+    return m_vaoGeneratedOpq;
+}
+
+bool Drawable::bindVAOTra() {
+    if (m_vaoGeneratedTra) {
+        mp_context->bindVertexArrayCached(m_vaoTra);
+    }
+    return m_vaoGeneratedTra;
+}
+
 InstancedDrawable::InstancedDrawable(OpenGLContext *context)
     : Drawable(context), m_numInstances(0), m_bufPosOffset(-1), m_offsetGenerated(false)
 {}
@@ -204,8 +293,10 @@ int InstancedDrawable::instanceCount() const {
 }
 
 void InstancedDrawable::generateOffsetBuf() {
+    if (!m_offsetGenerated) {
+        mp_context->glGenBuffers(1, &m_bufPosOffset);
+    }
     m_offsetGenerated = true;
-    mp_context->glGenBuffers(1, &m_bufPosOffset);
 }
 
 bool InstancedDrawable::bindOffsetBuf() {
@@ -218,13 +309,13 @@ bool InstancedDrawable::bindOffsetBuf() {
 
 void InstancedDrawable::clearOffsetBuf() {
     if(m_offsetGenerated) {
-        mp_context->glDeleteBuffers(1, &m_bufPosOffset);
+        mp_context->deleteBufferTracked(m_bufPosOffset);
         m_offsetGenerated = false;
     }
 }
 void InstancedDrawable::clearColorBuf() {
     if(m_colGenerated) {
-        mp_context->glDeleteBuffers(1, &m_bufCol);
+        mp_context->deleteBufferTracked(m_bufCol);
         m_colGenerated = false;
     }
 }
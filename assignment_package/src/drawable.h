@@ -2,6 +2,12 @@
 #include <openglcontext.h>
 #include <glm_includes.h>
 
+// Attribute locations that every ShaderProgram binds its vertex inputs to,
+// so that a VAO set up once works with any program
+#define ATTR_LOC_POS 0
+#define ATTR_LOC_NOR 1
+#define ATTR_LOC_UV 2
+
 //This defines a class which can be rendered by our shader program.
 //Make any geometry a subclass of ShaderProgram::Drawable in order to render it with the ShaderProgram class.
 class Drawable
@@ -39,6 +45,14 @@ protected:
     bool m_interleavedGeneratedOpq;
     bool m_interleavedGeneratedTra;
 
+    // VAOs recording the interleaved opaque and transparent layouts
+    GLuint m_vaoOpq;
+    GLuint m_vaoTra;
+    bool m_vaoGeneratedOpq;
+    bool m_vaoGeneratedTra;
+
+    void setUpInterleavedVAO(GLuint &vao, bool &generated, GLuint bufInterleaved, GLuint bufIdx);
+
 
     OpenGLContext* mp_context; // Since Qt's OpenGL support is done through classes like QOpenGLFunctions_3_2_Core,
                           // we need to pass our OpenGL context to the Drawable in order to call GL functions
@@ -50,7 +64,7 @@ public:
     virtual ~Drawable();
 
     virtual void createVBOdata() = 0; // To be implemented by subclasses. Populates the VBOs of the Drawable.
-    void destroyVBOdata(); // Frees the VBOs of the Drawable.
+    virtual void destroyVBOdata(); // Frees the VBOs of the Drawable.
 
     // Getter functions for various GL data
     virtual GLenum drawMode();
@@ -61,6 +75,10 @@ public:
 
     // Call these functions when you want to call glGenBuffers on the buffers stored in the Drawable
     // These will properly set the values of idxBound etc. which need to be checked in ShaderProgram::draw()
+    // If the buffer already exists they do nothing, so re-uploading data reuses the same buffer.
+    // The generateIdx functions also switch to the default VAO, since the element
+    // buffer binding that usually follows them would otherwise rewire whichever
+    // mesh VAO was bound last.
     void generateIdx();
     void generateIdxOpq();
     void generateIdxTra();
@@ -86,6 +104,13 @@ public:
     bool bindInterleaved();
     bool bindInterleavedOpq();
     bool bindInterleavedTra();
+
+    // Records the interleaved opaque and transparent buffers, with their
+    // attribute layout and index buffers, in VAOs. Call after uploading them.
+    void generateInterleavedVAOs();
+    // Bind the VAO if there is one, so that drawing needs no other setup
+    bool bindVAOOpq();
+    bool bindVAOTra();
 };
 
 // A subclass of Drawable that enables the base code to render duplicates of
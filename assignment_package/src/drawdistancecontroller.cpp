@@ -0,0 +1,51 @@
+#include "drawdistancecontroller.h"
+
+// Weight of the newest frame in the moving average
+#define FRAME_AVERAGE_WEIGHT 0.05f
+
+DrawDistanceController::DrawDistanceController(unsigned int minRadius, unsigned int maxRadius)
+    : m_enabled(false), m_targetFrameMs(DRAW_DISTANCE_TARGET_FRAME_MS),
+      m_averageFrameMs(DRAW_DISTANCE_TARGET_FRAME_MS), m_framesSinceChange(0),
+      m_minRadius(minRadius), m_maxRadius(maxRadius)
+{}
+
+void DrawDistanceController::setEnabled(bool enabled) {
+    m_enabled = enabled;
+    m_framesSinceChange = 0;
+}
+
+bool DrawDistanceController::enabled() const {
+    return m_enabled;
+}
+
+void DrawDistanceController::setTargetFrameMs(float ms) {
+    m_targetFrameMs = ms;
+}
+
+float DrawDistanceController::averageFrameMs() const {
+    return m_averageFrameMs;
+}
+
+unsigned int DrawDistanceController::update(float frameMs, int pendingMeshes, unsigned int currentRadius) {
+    m_averageFrameMs += FRAME_AVERAGE_WEIGHT * (frameMs - m_averageFrameMs);
+    m_framesSinceChange++;
+
+    if (!m_enabled || m_framesSinceChange < DRAW_DISTANCE_COOLDOWN_FRAMES) {
+        return currentRadius;
+    }
+
+    unsigned int radius = currentRadius;
+    // The gap between these two thresholds keeps us from flip-flopping
+    // between two radii that straddle the target
+    if (m_averageFrameMs > 1.2f * m_targetFrameMs && radius > m_minRadius) {
+        radius--;
+    } else if (m_averageFrameMs < 1.05f * m_targetFrameMs && radius < m_maxRadius &&
+               pendingMeshes <= DRAW_DISTANCE_MAX_PENDING_MESHES) {
+        radius++;
+    }
+
+    if (radius != currentRadius) {
+        m_framesSinceChange = 0;
+    }
+    return radius;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+// Default frame time the adaptive draw distance tries to hold, in milliseconds
+#define DRAW_DISTANCE_TARGET_FRAME_MS (1000.f / 60.f)
+// Frames to wait after a change before judging the new distance
+#define DRAW_DISTANCE_COOLDOWN_FRAMES 90
+// Don't grow while more than this many chunk meshes are still in flight;
+// the frame time won't reflect the current distance until they land
+#define DRAW_DISTANCE_MAX_PENDING_MESHES 16
+
+// Picks a draw radius (in terrain zones) that keeps the frame time near
+// a target. Frame times are smoothed with an exponential moving average;
+// the radius shrinks when frames are clearly too slow and grows when they
+// are comfortably fast and the mesh queue has drained. After any change
+// the controller waits a cooldown period so it doesn't oscillate.
+class DrawDistanceController {
+private:
+    bool m_enabled;
+    float m_targetFrameMs;
+    float m_averageFrameMs;
+    int m_framesSinceChange;
+    unsigned int m_minRadius, m_maxRadius;
+
+public:
+    DrawDistanceController(unsigned int minRadius, unsigned int maxRadius);
+
+    void setEnabled(bool enabled);
+    bool enabled() const;
+    void setTargetFrameMs(float ms);
+    float averageFrameMs() const;
+
+    // Feeds one frame's measurements and returns the radius to use from
+    // now on, which is currentRadius unless the controller decided to move
+    unsigned int update(float frameMs, int pendingMeshes, unsigned int currentRadius);
+};
@@ -5,7 +5,8 @@ FrameBuffer::FrameBuffer(OpenGLContext *context,
                          unsigned int width, unsigned int height, unsigned int devicePixelRatio)
     : mp_context(context), m_frameBuffer(-1),
       m_outputTexture(-1), m_depthRenderBuffer(-1),
-      m_width(width), m_height(height), m_devicePixelRatio(devicePixelRatio), m_created(false)
+      m_width(width), m_height(height), m_devicePixelRatio(devicePixelRatio), m_created(false),
+      m_allocatedWidth(0), m_allocatedHeight(0), m_scale(1.f), m_trackedBytes(MEM_GPU_TEXTURES)
 {}
 
 void FrameBuffer::resize(unsigned int width, unsigned int height, unsigned int devicePixelRatio) {
@@ -14,7 +15,17 @@ void FrameBuffer::resize(unsigned int width, unsigned int height, unsigned int d
     m_devicePixelRatio = devicePixelRatio;
 }
 
+bool FrameBuffer::needsReallocation() const {
+    unsigned int width = m_width * m_devicePixelRatio;
+    unsigned int height = m_height * m_devicePixelRatio;
+    return !m_created ||
+           width > m_allocatedWidth || height > m_allocatedHeight ||
+           2 * width < m_allocatedWidth || 2 * height < m_allocatedHeight;
+}
+
 void FrameBuffer::create() {
+    m_allocatedWidth = m_width * m_devicePixelRatio;
+    m_allocatedHeight = m_height * m_devicePixelRatio;
     // Initialize the frame buffers and render textures
     mp_context->glGenFramebuffers(1, &m_frameBuffer);
     mp_context->glGenTextures(1, &m_outputTexture);
@@ -24,19 +35,21 @@ void FrameBuffer::create() {
     // Bind our texture so that all functions that deal with textures will interact with this one
     mp_context->glBindTexture(GL_TEXTURE_2D, m_outputTexture);
     // Give an empty image to OpenGL ( the last "0" )
-    mp_context->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, m_width * m_devicePixelRatio, m_height * m_devicePixelRatio, 0, GL_RGB, GL_UNSIGNED_BYTE, (void*)0);
+    mp_context->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, m_allocatedWidth, m_allocatedHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, (void*)0);
 
     // Set the render settings for the texture we've just created.
-    // Essentially zero filtering on the "texture" so it appears exactly as rendered
-    mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    // Linear filtering, since the texture is stretched over the screen
+    // whenever the scene is rendered below full resolution
+    mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     // Clamp the colors at the edge of our texture
     mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
     // Initialize our depth buffer
     mp_context->glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderBuffer);
-    mp_context->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, m_width, m_height);
+    // Same size as the color texture, so that all of it has depth when rendered at full scale
+    mp_context->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, m_allocatedWidth, m_allocatedHeight);
     mp_context->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderBuffer);
 
     // Set m_renderedTexture as the color output of our frame buffer
@@ -47,6 +60,12 @@ void FrameBuffer::create() {
     GLenum drawBuffers[1] = {GL_COLOR_ATTACHMENT0};
     mp_context->glDrawBuffers(1, drawBuffers); // "1" is the size of drawBuffers
 
+    // The texture was bound to whichever unit happened to be active
+    mp_context->invalidateGLStateCache();
+
+    // RGB texels are usually padded to four bytes, and depth takes four
+    m_trackedBytes.set(int64_t(m_allocatedWidth) * m_allocatedHeight * 8);
+
     m_created = true;
     if(mp_context->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
     {
@@ -63,18 +82,45 @@ void FrameBuffer::destroy() {
         mp_context->glDeleteTextures(1, &m_outputTexture);
         mp_context->glDeleteRenderbuffers(1, &m_depthRenderBuffer);
     }
+    m_trackedBytes.set(0);
+}
+
+// Pixel size of the part of the buffer that gets drawn into
+static glm::ivec2 viewportSize(unsigned int width, unsigned int height, unsigned int devicePixelRatio, float scale) {
+    return glm::max(glm::ivec2(1), glm::ivec2(glm::vec2(width, height) * float(devicePixelRatio) * scale));
 }
 
 void FrameBuffer::bindFrameBuffer() {
     mp_context->glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer);
+    glm::ivec2 size = viewportSize(m_width, m_height, m_devicePixelRatio, m_scale);
+    mp_context->glViewport(0, 0, size.x, size.y);
+}
+
+void FrameBuffer::setScale(float scale) {
+    m_scale = glm::clamp(scale, 0.f, 1.f);
+}
+
+float FrameBuffer::scale() const {
+    return m_scale;
+}
+
+glm::vec2 FrameBuffer::viewportScale() const {
+    if (m_allocatedWidth == 0 || m_allocatedHeight == 0) {
+        return glm::vec2(1.f);
+    }
+    return glm::vec2(viewportSize(m_width, m_height, m_devicePixelRatio, m_scale)) /
+           glm::vec2(m_allocatedWidth, m_allocatedHeight);
 }
 
 void FrameBuffer::bindToTextureSlot(unsigned int slot) {
     m_textureSlot = slot;
-    mp_context->glActiveTexture(GL_TEXTURE0 + slot);
-    mp_context->glBindTexture(GL_TEXTURE_2D, m_outputTexture);
+    mp_context->bindTexture2DCached(slot, m_outputTexture);
 }
 
 unsigned int FrameBuffer::getTextureSlot() const {
     return m_textureSlot;
 }
+
+GLuint FrameBuffer::frameBufferObject() const {
+    return m_frameBuffer;
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "openglcontext.h"
 #include "glm_includes.h"
+#include "memorystats.h"
 
 // A class representing a frame buffer in the OpenGL pipeline.
 // Stores three GPU handles: one to a frame buffer object, one to
@@ -21,20 +22,39 @@ private:
 
     unsigned int m_width, m_height, m_devicePixelRatio;
     bool m_created;
+    // Pixel size of the attachments as last created, which may be larger
+    // than the current size after a resize
+    unsigned int m_allocatedWidth, m_allocatedHeight;
+    // Fraction of the width and height that gets rendered into. The buffer
+    // is always allocated at full size, so changing this costs nothing.
+    float m_scale;
+    TrackedBytes m_trackedBytes; // Color texture and depth buffer
 
     unsigned int m_textureSlot;
 
 public:
     FrameBuffer(OpenGLContext *context, unsigned int width, unsigned int height, unsigned int devicePixelRatio);
     // Make sure to call resize from MyGL::resizeGL to keep your frame buffer up to date with
-    // your screen dimensions
+    // your screen dimensions. Only records the size; see needsReallocation().
     void resize(unsigned int width, unsigned int height, unsigned int devicePixelRatio);
+    // True if the attachments don't exist yet, are too small for the current
+    // size, or are more than twice as large as it along either axis.
+    // Otherwise the buffer is reused and only part of it drawn into.
+    bool needsReallocation() const;
     // Initialize all GPU-side data required
     void create();
     // Deallocate all GPU-side data
     void destroy();
+    // Also sets the viewport to the scaled part of the buffer
     void bindFrameBuffer();
+    void setScale(float scale);
+    float scale() const;
+    // Fraction of the color texture's width and height the last viewport
+    // covers, for reading the rendered area back as a texture
+    glm::vec2 viewportScale() const;
     // Associate our output texture with the indicated texture slot
     void bindToTextureSlot(unsigned int slot);
     unsigned int getTextureSlot() const;
+    // The GL name of the frame buffer object
+    GLuint frameBufferObject() const;
 };
@@ -0,0 +1,69 @@
+#include "framegraph.h"
+#include <QPainter>
+#include <algorithm>
+
+// Legend entries per row, and the height of a row
+#define LEGEND_COLUMNS 4
+#define LEGEND_ROW_HEIGHT 14
+// Height of the legend above the bars, with as many rows as the stages need
+#define LEGEND_ROWS ((STAGE_COUNT + LEGEND_COLUMNS - 1) / LEGEND_COLUMNS)
+#define LEGEND_HEIGHT (LEGEND_ROWS * LEGEND_ROW_HEIGHT + 2)
+
+static const std::array<QColor, STAGE_COUNT> stageColors {{
+    QColor(200, 200, 200), // input
+    QColor(80, 160, 255),  // physics
+    QColor(60, 200, 90),   // terrain
+    QColor(240, 200, 40),  // upload
+    QColor(230, 60, 60),   // redstone
+    QColor(40, 90, 200),   // fluids
+    QColor(240, 130, 170), // entities
+    QColor(170, 110, 60),  // opaque
+    QColor(60, 210, 210),  // transparent
+    QColor(200, 90, 220)   // post
+}};
+
+FrameGraph::FrameGraph(QWidget *parent)
+    : QWidget(parent), mp_profiler(nullptr)
+{}
+
+void FrameGraph::setProfiler(const FrameProfiler *profiler) {
+    mp_profiler = profiler;
+}
+
+void FrameGraph::paintEvent(QPaintEvent*) {
+    QPainter painter(this);
+    painter.fillRect(0, 0, width(), height(), QColor(20, 20, 20));
+    if (mp_profiler == nullptr) {
+        return;
+    }
+
+    // Rows of LEGEND_COLUMNS "stage average" entries, in the stage's own color
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        FrameStage stage = static_cast<FrameStage>(s);
+        painter.setPen(stageColors[s]);
+        painter.drawText(4 + (s % LEGEND_COLUMNS) * (width() / LEGEND_COLUMNS), 12 + (s / LEGEND_COLUMNS) * LEGEND_ROW_HEIGHT,
+                         QString(frameStageName(stage)) + " " + QString::number(mp_profiler->averageMs(stage), 'f', 2));
+    }
+
+    int graphHeight = height() - LEGEND_HEIGHT;
+    float pxPerMs = graphHeight / FRAME_GRAPH_MAX_MS;
+    float barWidth = static_cast<float>(width()) / PROFILER_HISTORY_FRAMES;
+    size_t n = mp_profiler->historySize();
+    for (size_t i = 0; i < n; i++) {
+        const FrameTimings &f = mp_profiler->historyAt(i);
+        // Right-aligned, so the newest frame is always at the edge
+        int x0 = static_cast<int>((PROFILER_HISTORY_FRAMES - n + i) * barWidth);
+        int x1 = static_cast<int>((PROFILER_HISTORY_FRAMES - n + i + 1) * barWidth);
+        float bottom = height();
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            float top = std::max(bottom - f.stageMs[s] * pxPerMs, static_cast<float>(LEGEND_HEIGHT));
+            painter.fillRect(x0, static_cast<int>(top), std::max(x1 - x0, 1),
+                             static_cast<int>(bottom) - static_cast<int>(top), stageColors[s]);
+            bottom = top;
+        }
+    }
+
+    int budgetY = height() - static_cast<int>(1000.f / 60.f * pxPerMs);
+    painter.setPen(QColor(255, 255, 255));
+    painter.drawLine(0, budgetY, width(), budgetY);
+}
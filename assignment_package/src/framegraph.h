@@ -0,0 +1,23 @@
+#pragma once
+#include "frameprofiler.h"
+#include <QWidget>
+
+// Frame time at the top of the graph, in milliseconds
+#define FRAME_GRAPH_MAX_MS 50.f
+
+// A rolling graph of the profiler's history: one bar per frame, newest on
+// the right, stacked from the stage times, with a line at 60 frames per
+// second and a legend of each stage's average
+class FrameGraph : public QWidget {
+    Q_OBJECT
+private:
+    const FrameProfiler *mp_profiler;
+
+protected:
+    void paintEvent(QPaintEvent *e) override;
+
+public:
+    explicit FrameGraph(QWidget *parent = nullptr);
+
+    void setProfiler(const FrameProfiler *profiler);
+};
@@ -0,0 +1,123 @@
+#include "frameprofiler.h"
+#include "tracer.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+const char *frameStageName(FrameStage stage) {
+    switch (stage) {
+    case STAGE_INPUT: return "input";
+    case STAGE_PHYSICS: return "physics";
+    case STAGE_TERRAIN: return "terrain";
+    case STAGE_UPLOAD: return "upload";
+    case STAGE_REDSTONE: return "redstone";
+    case STAGE_FLUIDS: return "fluids";
+    case STAGE_ENTITIES: return "entities";
+    case STAGE_DRAW_OPAQUE: return "opaque";
+    case STAGE_DRAW_TRANSPARENT: return "transparent";
+    case STAGE_POST_PROCESS: return "post";
+    default: return "?";
+    }
+}
+
+FrameTimings::FrameTimings()
+    : frame(0), stageMs{}
+{}
+
+float FrameTimings::totalMs() const {
+    float total = 0.f;
+    for (float ms : stageMs) {
+        total += ms;
+    }
+    return total;
+}
+
+FrameProfiler::FrameProfiler()
+    : m_history{}, m_frameCount(0), m_current(), m_worst{}
+{}
+
+void FrameProfiler::addTime(FrameStage stage, float ms) {
+    m_current.stageMs[stage] += ms;
+}
+
+void FrameProfiler::endFrame() {
+    m_current.frame = m_frameCount;
+    m_history[m_frameCount % PROFILER_HISTORY_FRAMES] = m_current;
+    m_frameCount++;
+
+    float total = m_current.totalMs();
+    if (m_worst.size() < PROFILER_WORST_FRAMES || total > m_worst.back().totalMs()) {
+        auto slower = [](const FrameTimings &a, const FrameTimings &b) { return a.totalMs() > b.totalMs(); };
+        m_worst.insert(std::upper_bound(m_worst.begin(), m_worst.end(), m_current, slower), m_current);
+        if (m_worst.size() > PROFILER_WORST_FRAMES) {
+            m_worst.pop_back();
+        }
+    }
+    m_current = FrameTimings();
+}
+
+size_t FrameProfiler::historySize() const {
+    return static_cast<size_t>(std::min<uint64_t>(m_frameCount, PROFILER_HISTORY_FRAMES));
+}
+
+const FrameTimings &FrameProfiler::historyAt(size_t i) const {
+    uint64_t oldest = m_frameCount - historySize();
+    return m_history[(oldest + i) % PROFILER_HISTORY_FRAMES];
+}
+
+float FrameProfiler::averageMs(FrameStage stage) const {
+    size_t n = historySize();
+    if (n == 0) {
+        return 0.f;
+    }
+    float total = 0.f;
+    for (size_t i = 0; i < n; i++) {
+        total += historyAt(i).stageMs[stage];
+    }
+    return total / n;
+}
+
+void FrameProfiler::dumpWorstFrames() {
+    std::cout << "slowest " << m_worst.size() << " frames (ms):" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (const FrameTimings &f : m_worst) {
+        std::cout << "  frame " << f.frame << ": " << f.totalMs();
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            std::cout << ", " << frameStageName(static_cast<FrameStage>(s)) << " " << f.stageMs[s];
+        }
+        std::cout << std::endl;
+    }
+    std::cout << std::defaultfloat;
+    clearWorstFrames();
+}
+
+void FrameProfiler::clearWorstFrames() {
+    m_worst.clear();
+}
+
+ScopedStageTimer::ScopedStageTimer(FrameProfiler *profiler, FrameStage stage)
+    : mp_profiler(profiler), m_stage(stage), m_start(), m_traced(Tracer::enabled()), m_traceStartNs(0)
+{
+    if (mp_profiler) {
+        m_start = std::chrono::steady_clock::now();
+    }
+    if (m_traced) {
+        m_traceStartNs = Tracer::now();
+    }
+}
+
+ScopedStageTimer::~ScopedStageTimer() {
+    finish();
+}
+
+void ScopedStageTimer::finish() {
+    if (mp_profiler) {
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - m_start;
+        mp_profiler->addTime(m_stage, elapsed.count());
+        mp_profiler = nullptr;
+    }
+    if (m_traced) {
+        Tracer::record({frameStageName(m_stage), m_traceStartNs, Tracer::now(), 0, 0, glm::ivec2(), false});
+        m_traced = false;
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Frames of stage timings kept for the graph
+#define PROFILER_HISTORY_FRAMES 240
+// How many of the slowest frames are kept for dumpWorstFrames()
+#define PROFILER_WORST_FRAMES 8
+
+// The timed parts of a frame. Input is the key and mouse handlers, physics
+// the player's tick, entities the EntitySystem's, upload taking in
+// finished meshes and noise textures.
+// Draw and post-process times are the CPU's side only: how long issuing
+// the GL calls took, not how long the GPU took to run them.
+enum FrameStage : unsigned char {
+    STAGE_INPUT, STAGE_PHYSICS, STAGE_TERRAIN, STAGE_UPLOAD, STAGE_REDSTONE, STAGE_FLUIDS, STAGE_ENTITIES,
+    STAGE_DRAW_OPAQUE, STAGE_DRAW_TRANSPARENT, STAGE_POST_PROCESS,
+    STAGE_COUNT
+};
+
+const char *frameStageName(FrameStage stage);
+
+struct FrameTimings {
+    uint64_t frame; // Frames ended before this one
+    std::array<float, STAGE_COUNT> stageMs;
+
+    FrameTimings();
+    float totalMs() const;
+};
+
+// Collects how long each stage took, frame by frame. Stages can be timed
+// any number of times between two endFrame() calls; the times add up.
+// Only for the main thread.
+class FrameProfiler {
+private:
+    std::array<FrameTimings, PROFILER_HISTORY_FRAMES> m_history;
+    uint64_t m_frameCount;
+    FrameTimings m_current;
+    // The slowest frames since the last dump, slowest first
+    std::vector<FrameTimings> m_worst;
+
+public:
+    FrameProfiler();
+
+    void addTime(FrameStage stage, float ms);
+    // Files the times since the last call away as one frame
+    void endFrame();
+
+    // Frames in the history, at most PROFILER_HISTORY_FRAMES
+    size_t historySize() const;
+    // 0 is the oldest frame still in the history
+    const FrameTimings &historyAt(size_t i) const;
+    float averageMs(FrameStage stage) const;
+
+    // Prints the stage breakdown of the slowest frames, then starts over
+    void dumpWorstFrames();
+    void clearWorstFrames();
+};
+
+// Adds the time from its construction to finish() or its destruction,
+// whichever is first, to a stage, and records it for the Tracer if that
+// is on. The profiler may be null.
+class ScopedStageTimer {
+private:
+    FrameProfiler *mp_profiler;
+    FrameStage m_stage;
+    std::chrono::steady_clock::time_point m_start;
+    bool m_traced;
+    uint64_t m_traceStartNs;
+
+public:
+    ScopedStageTimer(FrameProfiler *profiler, FrameStage stage);
+    ~ScopedStageTimer();
+
+    void finish();
+};
@@ -0,0 +1,27 @@
+#include "frameuniforms.h"
+
+FrameUniforms::FrameUniforms(OpenGLContext *context)
+    : mp_context(context), m_buffer(), m_created(false)
+{}
+
+static_assert(sizeof(PerFrameUniformData) == 128, "PerFrameUniformData must match the std140 PerFrame block");
+
+void FrameUniforms::create() {
+    mp_context->glGenBuffers(1, &m_buffer);
+    mp_context->glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    mp_context->bufferDataTracked(GL_UNIFORM_BUFFER, m_buffer, sizeof(PerFrameUniformData), nullptr, GL_DYNAMIC_DRAW);
+    m_created = true;
+}
+
+void FrameUniforms::destroy() {
+    if (m_created) {
+        mp_context->deleteBufferTracked(m_buffer);
+        m_created = false;
+    }
+}
+
+void FrameUniforms::update(const PerFrameUniformData &data) {
+    mp_context->glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    mp_context->glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(PerFrameUniformData), &data);
+    mp_context->glBindBufferBase(GL_UNIFORM_BUFFER, UBO_BINDING_PER_FRAME, m_buffer);
+}
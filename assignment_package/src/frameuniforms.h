@@ -0,0 +1,36 @@
+#pragma once
+#include "openglcontext.h"
+#include "glm_includes.h"
+
+// Uniform buffer binding point of the PerFrame block
+#define UBO_BINDING_PER_FRAME 0
+
+// Mirrors the std140 layout of the PerFrame uniform block declared in
+// the shaders; keep the two in sync
+struct PerFrameUniformData {
+    glm::mat4 viewProj;
+    glm::vec4 cameraPos;  // w unused
+    glm::vec4 fogColor;   // a unused
+    glm::vec4 fogParams;  // x: distance fog starts, y: distance it is opaque
+    GLint time;
+    GLint padding;
+    glm::vec2 viewportScale;  // Fraction of the offscreen color texture the scene covers
+};
+
+// The uniform buffer holding everything that is the same for every draw in
+// a frame. Every ShaderProgram links its PerFrame block to
+// UBO_BINDING_PER_FRAME, so one upload per frame reaches all of them.
+class FrameUniforms {
+private:
+    OpenGLContext *mp_context;
+    GLuint m_buffer;
+    bool m_created;
+
+public:
+    FrameUniforms(OpenGLContext *context);
+
+    void create();
+    void destroy();
+    // Uploads data and binds the buffer to UBO_BINDING_PER_FRAME
+    void update(const PerFrameUniformData &data);
+};
@@ -0,0 +1,166 @@
+#include "inputrecording.h"
+#include <fstream>
+
+RecordedEvent RecordedEvent::rotation(Kind kind, float degrees) {
+    RecordedEvent e {};
+    e.kind = kind;
+    e.degrees = degrees;
+    return e;
+}
+
+RecordedEvent RecordedEvent::toggleFlight() {
+    RecordedEvent e {};
+    e.kind = TOGGLE_FLIGHT;
+    return e;
+}
+
+RecordedEvent RecordedEvent::drawRadius(unsigned int radius) {
+    RecordedEvent e {};
+    e.kind = SET_DRAW_RADIUS;
+    e.radius = radius;
+    return e;
+}
+
+RecordedEvent RecordedEvent::blockEdit(const BlockEdit &edit) {
+    RecordedEvent e {};
+    e.kind = BLOCK_EDIT;
+    e.edit = edit;
+    return e;
+}
+
+InputRecording::InputRecording()
+    : m_ticks(), m_pendingEvents()
+{}
+
+void InputRecording::addEvent(const RecordedEvent &e) {
+    m_pendingEvents.push_back(e);
+}
+
+void InputRecording::endTick(float dT, const InputBundle &inputs) {
+    m_ticks.push_back({dT, inputs, std::move(m_pendingEvents)});
+    m_pendingEvents.clear();
+}
+
+size_t InputRecording::tickCount() const {
+    return m_ticks.size();
+}
+
+const RecordedTick &InputRecording::tick(size_t i) const {
+    return m_ticks[i];
+}
+
+template <typename T>
+static void put(std::ofstream &out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static T get(std::ifstream &in) {
+    T value {};
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return value;
+}
+
+// The keys of an InputBundle, one bit each. The mouse position isn't
+// used by Player, so only the deltas are kept.
+static uint8_t packKeys(const InputBundle &inputs) {
+    return inputs.wPressed | inputs.aPressed << 1 | inputs.sPressed << 2 | inputs.dPressed << 3 |
+           inputs.ePressed << 4 | inputs.qPressed << 5 | inputs.spacePressed << 6 | inputs.fPressed << 7;
+}
+
+static void unpackKeys(uint8_t keys, InputBundle *inputs) {
+    inputs->wPressed = keys & 1;
+    inputs->aPressed = keys & 2;
+    inputs->sPressed = keys & 4;
+    inputs->dPressed = keys & 8;
+    inputs->ePressed = keys & 16;
+    inputs->qPressed = keys & 32;
+    inputs->spacePressed = keys & 64;
+    inputs->fPressed = keys & 128;
+}
+
+bool InputRecording::write(const std::string &path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    put<uint32_t>(out, INPUT_RECORDING_MAGIC);
+    put<uint32_t>(out, INPUT_RECORDING_VERSION);
+    put<uint64_t>(out, m_ticks.size());
+    for (const RecordedTick &t : m_ticks) {
+        put<float>(out, t.dT);
+        put<uint8_t>(out, packKeys(t.inputs));
+        put<float>(out, t.inputs.mouseDeltaX);
+        put<float>(out, t.inputs.mouseDeltaY);
+        put<uint16_t>(out, t.events.size());
+        for (const RecordedEvent &e : t.events) {
+            put<uint8_t>(out, e.kind);
+            switch (e.kind) {
+            case RecordedEvent::ROTATE_UP_GLOBAL:
+            case RecordedEvent::ROTATE_RIGHT_LOCAL:
+                put<float>(out, e.degrees);
+                break;
+            case RecordedEvent::TOGGLE_FLIGHT:
+                break;
+            case RecordedEvent::SET_DRAW_RADIUS:
+                put<uint32_t>(out, e.radius);
+                break;
+            case RecordedEvent::BLOCK_EDIT:
+                put<uint8_t>(out, e.edit.kind);
+                put<int32_t>(out, e.edit.pos.x);
+                put<int32_t>(out, e.edit.pos.y);
+                put<int32_t>(out, e.edit.pos.z);
+                put<uint8_t>(out, e.edit.placed);
+                put<uint8_t>(out, e.edit.removed);
+                break;
+            }
+        }
+    }
+    return static_cast<bool>(out);
+}
+
+bool InputRecording::read(const std::string &path) {
+    m_ticks.clear();
+    m_pendingEvents.clear();
+    std::ifstream in(path, std::ios::binary);
+    uint32_t magic = get<uint32_t>(in);
+    uint32_t version = get<uint32_t>(in);
+    uint64_t count = get<uint64_t>(in);
+    if (!in || magic != INPUT_RECORDING_MAGIC || version != INPUT_RECORDING_VERSION) {
+        return false;
+    }
+    for (uint64_t i = 0; i < count && in; i++) {
+        RecordedTick t {};
+        t.dT = get<float>(in);
+        unpackKeys(get<uint8_t>(in), &t.inputs);
+        t.inputs.mouseDeltaX = get<float>(in);
+        t.inputs.mouseDeltaY = get<float>(in);
+        uint16_t events = get<uint16_t>(in);
+        for (uint16_t j = 0; j < events && in; j++) {
+            RecordedEvent e {};
+            e.kind = static_cast<RecordedEvent::Kind>(get<uint8_t>(in));
+            switch (e.kind) {
+            case RecordedEvent::ROTATE_UP_GLOBAL:
+            case RecordedEvent::ROTATE_RIGHT_LOCAL:
+                e.degrees = get<float>(in);
+                break;
+            case RecordedEvent::TOGGLE_FLIGHT:
+                break;
+            case RecordedEvent::SET_DRAW_RADIUS:
+                e.radius = get<uint32_t>(in);
+                break;
+            case RecordedEvent::BLOCK_EDIT:
+                e.edit.kind = static_cast<BlockEdit::Kind>(get<uint8_t>(in));
+                e.edit.pos.x = get<int32_t>(in);
+                e.edit.pos.y = get<int32_t>(in);
+                e.edit.pos.z = get<int32_t>(in);
+                e.edit.placed = static_cast<BlockType>(get<uint8_t>(in));
+                e.edit.removed = static_cast<BlockType>(get<uint8_t>(in));
+                break;
+            default:
+                return false;
+            }
+            t.events.push_back(e);
+        }
+        m_ticks.push_back(std::move(t));
+    }
+    // A short read means the file was cut off
+    return static_cast<bool>(in);
+}
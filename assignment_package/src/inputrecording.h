@@ -0,0 +1,58 @@
+#pragma once
+#include "scene/player.h"
+#include <string>
+#include <vector>
+
+// Recordings start with this and the version, followed by the tick count
+#define INPUT_RECORDING_MAGIC 0x5052524du // "MRRP"
+#define INPUT_RECORDING_VERSION 1u
+
+// Something done to the player or the world between two ticks, outside of
+// what the InputBundle carries into Player::tick()
+struct RecordedEvent {
+    enum Kind : unsigned char {
+        ROTATE_UP_GLOBAL, ROTATE_RIGHT_LOCAL, TOGGLE_FLIGHT, SET_DRAW_RADIUS, BLOCK_EDIT
+    };
+    Kind kind;
+    float degrees; // Rotations only
+    unsigned int radius; // SET_DRAW_RADIUS only
+    BlockEdit edit; // BLOCK_EDIT only
+
+    static RecordedEvent rotation(Kind kind, float degrees);
+    static RecordedEvent toggleFlight();
+    static RecordedEvent drawRadius(unsigned int radius);
+    static RecordedEvent blockEdit(const BlockEdit &edit);
+};
+
+// One MyGL::tick(): the events since the previous tick, which happen
+// first, then the player's step with these inputs
+struct RecordedTick {
+    float dT;
+    InputBundle inputs;
+    std::vector<RecordedEvent> events;
+};
+
+// Everything a session fed into the simulation, tick by tick, from the
+// moment MyGL was created. Block edits are kept as where they landed rather
+// than where the player aimed, so the world changes the same way even if
+// the player ends up somewhere slightly different on replay.
+// Written in the machine's own byte order.
+class InputRecording {
+private:
+    std::vector<RecordedTick> m_ticks;
+    std::vector<RecordedEvent> m_pendingEvents; // Go into the next tick
+
+public:
+    InputRecording();
+
+    void addEvent(const RecordedEvent &e);
+    // Closes the current tick, taking the events added since the last one
+    void endTick(float dT, const InputBundle &inputs);
+
+    size_t tickCount() const;
+    const RecordedTick &tick(size_t i) const;
+
+    bool write(const std::string &path) const;
+    // Replaces whatever this held. Fails on a file of another version.
+    bool read(const std::string &path);
+};
@@ -0,0 +1,80 @@
+#include "inputreplay.h"
+#include "inputrecording.h"
+#include "mygl.h"
+
+#include <algorithm>
+#include <iostream>
+#include <QElapsedTimer>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QThreadPool>
+
+InputReplay::InputReplay(const std::string &path)
+    : m_path(path)
+{}
+
+std::string InputReplay::pathFromArguments(const QStringList &arguments) {
+    for (const QString &arg : arguments) {
+        if (arg.startsWith("--replay=")) {
+            return arg.section('=', 1).toStdString();
+        }
+    }
+    return "";
+}
+
+int InputReplay::run() {
+    InputRecording recording;
+    if (!recording.read(m_path)) {
+        std::cout << "replay: unable to read " << m_path << std::endl;
+        return 1;
+    }
+
+    QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+    QOffscreenSurface surface;
+    surface.setFormat(format);
+    surface.create();
+    QOpenGLContext context;
+    context.setFormat(format);
+    if (!context.create() || !context.makeCurrent(&surface)) {
+        std::cout << "replay: unable to create an offscreen OpenGL context" << std::endl;
+        return 1;
+    }
+
+    std::vector<float> tickMs;
+    tickMs.reserve(recording.tickCount());
+    {
+        // Never shown, so it uses our context rather than one of its own
+        MyGL gl;
+        gl.prepareBenchmark();
+        gl.initializeGL();
+
+        QElapsedTimer wallTimer;
+        wallTimer.start();
+        for (size_t i = 0; i < recording.tickCount(); i++) {
+            QElapsedTimer tickTimer;
+            tickTimer.start();
+            gl.replayTick(recording.tick(i));
+            tickMs.push_back(tickTimer.nsecsElapsed() / 1e6f);
+        }
+
+        // Printed in full so that runs which went differently stand out
+        const glm::vec3 &end = gl.playerPosition();
+        const TerrainCounters &counters = gl.terrainCounters();
+        std::cout.precision(9);
+        std::cout << "replay: " << recording.tickCount() << " ticks in " << wallTimer.elapsed() << " ms, ended at ("
+                  << end.x << ", " << end.y << ", " << end.z << "), " << counters.chunksGenerated << " chunks generated, "
+                  << counters.meshesBuilt << " meshes built, " << counters.fluidCellsUpdated << " fluid blocks updated"
+                  << std::endl;
+        QThreadPool::globalInstance()->waitForDone();
+    }
+    context.doneCurrent();
+
+    if (!tickMs.empty()) {
+        std::sort(tickMs.begin(), tickMs.end());
+        std::cout.precision(4);
+        std::cout << "replay: tick p50 " << tickMs[tickMs.size() / 2] << " ms, p99 "
+                  << tickMs[std::min(tickMs.size() - 1, tickMs.size() * 99 / 100)] << " ms, max "
+                  << tickMs.back() << " ms" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <QStringList>
+#include <string>
+
+// Re-runs a recording made with --record, as given by --replay=<file>.
+// Like Benchmark it uses an offscreen GL context and no window, but it
+// draws nothing: each recorded tick is stepped with its recorded dT as
+// fast as the simulation allows and the terrain workers are waited on
+// after every tick, so CPU profiles of two runs (e.g. with --trace) can be
+// compared tick for tick.
+class InputReplay {
+private:
+    std::string m_path;
+
+public:
+    InputReplay(const std::string &path);
+
+    // The recording --replay names, or empty if it wasn't given
+    static std::string pathFromArguments(const QStringList &arguments);
+
+    // Returns the process exit code
+    int run();
+};
@@ -1,4 +1,6 @@
 #include <mainwindow.h>
+#include "benchmark.h"
+#include "inputreplay.h"
 
 #include <QApplication>
 #include <QSurfaceFormat>
@@ -37,6 +39,17 @@ int main(int argc, char *argv[])
     QSurfaceFormat::setDefaultFormat(format);
     debugFormatVersion();
 
+    // --bench flies a fixed path offscreen and exits, with no window at all
+    BenchmarkOptions bench = BenchmarkOptions::fromArguments(a.arguments());
+    if (bench.enabled) {
+        return Benchmark(bench).run();
+    }
+    // --replay=<file> re-runs a session recorded with --record, also windowless
+    std::string replay = InputReplay::pathFromArguments(a.arguments());
+    if (!replay.empty()) {
+        return InputReplay(replay).run();
+    }
+
     MainWindow w;
     w.show();
 
@@ -18,6 +18,10 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->mygl, SIGNAL(sig_sendPlayerLook(QString)), &playerInfoWindow, SLOT(slot_setLookText(QString)));
     connect(ui->mygl, SIGNAL(sig_sendPlayerChunk(QString)), &playerInfoWindow, SLOT(slot_setChunkText(QString)));
     connect(ui->mygl, SIGNAL(sig_sendPlayerTerrainZone(QString)), &playerInfoWindow, SLOT(slot_setZoneText(QString)));
+    connect(ui->mygl, SIGNAL(sig_sendRenderStats(QString)), &playerInfoWindow, SLOT(slot_setRenderStatsText(QString)));
+    playerInfoWindow.setFrameProfiler(ui->mygl->frameProfiler());
+    connect(ui->mygl, SIGNAL(sig_showFrameGraph(bool)), &playerInfoWindow, SLOT(slot_showFrameGraph(bool)));
+    connect(ui->mygl, SIGNAL(sig_frameProfiled()), &playerInfoWindow, SLOT(slot_updateFrameGraph()));
 
     //inventory
     connect(ui->mygl, SIGNAL(sig_openCloseInventory(bool)), this, SLOT(slot_openCloseInventory(bool)));
@@ -0,0 +1,108 @@
+#include "memorystats.h"
+#include <array>
+#include <atomic>
+#include <iostream>
+
+static std::array<std::atomic<int64_t>, MEM_CATEGORY_COUNT> liveBytes {};
+static std::array<std::atomic<int64_t>, MEM_CATEGORY_COUNT> peakBytes {};
+
+const char *MemoryStats::categoryName(MemoryCategory category) {
+    switch (category) {
+    case MEM_CHUNK_BLOCKS: return "chunk_blocks";
+    case MEM_MESH_CPU: return "mesh_cpu";
+    case MEM_GPU_BUFFERS: return "gpu_buffers";
+    case MEM_GPU_TEXTURES: return "gpu_textures";
+    case MEM_REDSTONE: return "redstone";
+    case MEM_QT_RESOURCES: return "qt_resources";
+    case MEM_ENTITIES: return "entities";
+    default: return "?";
+    }
+}
+
+void MemoryStats::add(MemoryCategory category, int64_t bytes) {
+    int64_t live = liveBytes[category].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    int64_t peak = peakBytes[category].load(std::memory_order_relaxed);
+    while (live > peak && !peakBytes[category].compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+}
+
+int64_t MemoryStats::live(MemoryCategory category) {
+    return liveBytes[category].load(std::memory_order_relaxed);
+}
+
+int64_t MemoryStats::peak(MemoryCategory category) {
+    return peakBytes[category].load(std::memory_order_relaxed);
+}
+
+void MemoryStats::dump() {
+    int64_t totalLive = 0;
+    std::cout << "memory (live / peak KiB):" << std::endl;
+    for (int c = 0; c < MEM_CATEGORY_COUNT; c++) {
+        MemoryCategory category = static_cast<MemoryCategory>(c);
+        std::cout << "  " << categoryName(category) << ": " << live(category) / 1024
+                  << " / " << peak(category) / 1024 << std::endl;
+        totalLive += live(category);
+    }
+    std::cout << "  total live: " << totalLive / 1024 << std::endl;
+}
+
+QJsonObject MemoryStats::toJson() {
+    QJsonObject result;
+    for (int c = 0; c < MEM_CATEGORY_COUNT; c++) {
+        MemoryCategory category = static_cast<MemoryCategory>(c);
+        QJsonObject counts;
+        counts["live_bytes"] = static_cast<qint64>(live(category));
+        counts["peak_bytes"] = static_cast<qint64>(peak(category));
+        result[categoryName(category)] = counts;
+    }
+    return result;
+}
+
+TrackedBytes::TrackedBytes(MemoryCategory category, int64_t bytes)
+    : m_category(category), m_bytes(0)
+{
+    set(bytes);
+}
+
+TrackedBytes::TrackedBytes(const TrackedBytes &other)
+    : TrackedBytes(other.m_category, other.m_bytes)
+{}
+
+TrackedBytes::TrackedBytes(TrackedBytes &&other)
+    : m_category(other.m_category), m_bytes(other.m_bytes)
+{
+    other.m_bytes = 0;
+}
+
+TrackedBytes &TrackedBytes::operator=(const TrackedBytes &other) {
+    if (this != &other) {
+        set(0);
+        m_category = other.m_category;
+        set(other.m_bytes);
+    }
+    return *this;
+}
+
+TrackedBytes &TrackedBytes::operator=(TrackedBytes &&other) {
+    if (this != &other) {
+        set(0);
+        m_category = other.m_category;
+        m_bytes = other.m_bytes;
+        other.m_bytes = 0;
+    }
+    return *this;
+}
+
+TrackedBytes::~TrackedBytes() {
+    set(0);
+}
+
+void TrackedBytes::set(int64_t bytes) {
+    if (bytes != m_bytes) {
+        MemoryStats::add(m_category, bytes - m_bytes);
+        m_bytes = bytes;
+    }
+}
+
+int64_t TrackedBytes::bytes() const {
+    return m_bytes;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <QJsonObject>
+#include <cstdint>
+
+// What tracked memory is spent on. GPU figures are estimates from the
+// sizes we hand to GL; drivers may pad or keep shadow copies.
+enum MemoryCategory : unsigned char {
+    MEM_CHUNK_BLOCKS,  // ChunkData block arrays
+    MEM_MESH_CPU,      // Mesh vectors built by workers or kept by chunks
+    MEM_GPU_BUFFERS,   // glBufferData sizes
+    MEM_GPU_TEXTURES,  // Texture and render target storage
+    MEM_REDSTONE,      // Redstone items
+    MEM_QT_RESOURCES,  // Images decoded by Qt
+    MEM_ENTITIES,      // EntitySystem component arrays
+    MEM_CATEGORY_COUNT
+};
+
+// Live and peak bytes per category, for the whole process. Safe to
+// update from any thread.
+class MemoryStats {
+public:
+    static const char *categoryName(MemoryCategory category);
+
+    // bytes is negative when memory is released
+    static void add(MemoryCategory category, int64_t bytes);
+    static int64_t live(MemoryCategory category);
+    static int64_t peak(MemoryCategory category);
+
+    // Prints every category's live and peak bytes
+    static void dump();
+    // {"<category>": {"live_bytes": ..., "peak_bytes": ...}, ...}
+    static QJsonObject toJson();
+};
+
+// Counts the bytes held by the object it is a member of for as long as
+// that object lives. Copies count again, since they hold their own copy;
+// moves hand the count over.
+class TrackedBytes {
+private:
+    MemoryCategory m_category;
+    int64_t m_bytes;
+
+public:
+    explicit TrackedBytes(MemoryCategory category, int64_t bytes = 0);
+    TrackedBytes(const TrackedBytes &other);
+    TrackedBytes(TrackedBytes &&other);
+    TrackedBytes &operator=(const TrackedBytes &other);
+    TrackedBytes &operator=(TrackedBytes &&other);
+    ~TrackedBytes();
+
+    void set(int64_t bytes);
+    int64_t bytes() const;
+};
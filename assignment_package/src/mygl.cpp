@@ -1,36 +1,141 @@
 #include "mygl.h"
 #include <glm_includes.h>
+#include "tracer.h"
 
+#include <algorithm>
 #include <iostream>
+#include <tuple>
 #include <QApplication>
 #include <QKeyEvent>
+#include <QStandardPaths>
+#include <QThreadPool>
 
 
 MyGL::MyGL(QWidget *parent)
     : OpenGLContext(parent),
       m_worldAxes(this),
       m_progLambert(this), m_progFlat(this), m_progInstanced(this), m_progLava(this), m_progWater(this), m_progNothing(this),
-      m_terrain(this),m_player(glm::vec3(48.f, 129.f, 48.f), m_terrain),
-      m_inventory(false), m_previousTime(QDateTime::currentMSecsSinceEpoch()),
-      m_frameBuffer(this, this->width(), this->height(), this->devicePixelRatio()), m_quad(this), m_texture(this), m_time(0), m_grass(10), m_dirt(10), m_stone(10), m_water(10),
+      m_frameUniforms(this), m_terrain(this),m_player(glm::vec3(48.f, 129.f, 48.f), m_terrain), m_entities(),
+      m_inventory(false), m_simStep(1.f / SIM_TICK_HZ), m_simAccumulator(0.f), m_simAlpha(1.f), m_simClock(),
+      m_frameTimer(), m_lastFrameMs(DRAW_DISTANCE_TARGET_FRAME_MS), m_startupTimer(), m_programsFromCache(0),
+      m_drawDistance(1, TERRAIN_MAX_DRAW_RADIUS), m_resolutionScale(),
+      m_profiler(), m_showFrameGraph(false), m_tracePath("trace.json"),
+      m_recording(), m_recordingInputs(false), m_recordingPath("inputs.rec"),
+      m_renderGraph(this), mp_postEffect(&m_progNothing), m_quad(this), m_viewProj(), m_eye(), m_texture(this), m_resourceCache(), m_noiseTexture(this), m_time(0), m_grass(10), m_dirt(10), m_stone(10), m_water(10),
       m_snow(10), m_lava(10), m_inventorySelectedBlock(EMPTY)
 {
+    m_startupTimer.start();
     // Connect the timer to a function so that when the timer ticks the function is executed
     connect(&m_timer, SIGNAL(timeout()), this, SLOT(tick()));
-    // Tell the timer to redraw 60 times per second
-    m_timer.start(16);
+    int renderHz = RENDER_HZ;
     setFocusPolicy(Qt::ClickFocus);
 
     setMouseTracking(true); // MyGL will track the mouse's movements even if a mouse button is not pressed
     setCursor(Qt::BlankCursor); // Make the cursor invisible
+    m_terrain.setProfiler(&m_profiler);
+    Tracer::setThreadName("main");
+
+    // --resource-cache bakes slow-to-build startup data to disk and reuses
+    // it on later runs. It goes in the platform's cache folder unless
+    // given as --resource-cache=<directory>.
+    for (const QString &arg : QApplication::arguments()) {
+        if (arg == "--resource-cache" || arg.startsWith("--resource-cache=")) {
+            QString dir = arg.section('=', 1);
+            if (dir.isEmpty()) {
+                dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+            }
+            if (!m_resourceCache.setDirectory(dir.toStdString())) {
+                std::cout << "resource cache unavailable at " << dir.toStdString() << std::endl;
+            }
+        }
+        // --trace[=<file>] records from startup and writes the trace at exit
+        if (arg == "--trace" || arg.startsWith("--trace=")) {
+            QString path = arg.section('=', 1);
+            if (!path.isEmpty()) {
+                m_tracePath = path.toStdString();
+            }
+            Tracer::setEnabled(true);
+        }
+        // --record[=<file>] keeps every tick's inputs for --replay
+        if (arg == "--record" || arg.startsWith("--record=")) {
+            QString path = arg.section('=', 1);
+            if (!path.isEmpty()) {
+                m_recordingPath = path.toStdString();
+            }
+            m_recordingInputs = true;
+        }
+        if (arg.startsWith("--sim-hz=")) {
+            m_simStep = 1.f / std::max(1, arg.section('=', 1).toInt());
+        } else if (arg.startsWith("--render-hz=")) {
+            renderHz = std::max(1, arg.section('=', 1).toInt());
+        } else if (arg.startsWith("--mesh-cache-mb=")) {
+            // GPU memory chunk meshes may hold before the least recently
+            // used ones out of range are destroyed
+            m_terrain.setMeshCacheBudget(size_t(std::max(1, arg.section('=', 1).toInt())) * 1024u * 1024u);
+        }
+    }
+    // Tell the timer to redraw renderHz times per second
+    m_timer.start(1000 / renderHz);
 }
 
 MyGL::~MyGL() {
+    if (Tracer::enabled()) {
+        Tracer::setEnabled(false);
+        writeTrace();
+    }
+    if (m_recordingInputs) {
+        if (m_recording.write(m_recordingPath)) {
+            std::cout << "wrote " << m_recording.tickCount() << " ticks to " << m_recordingPath << std::endl;
+        } else {
+            std::cout << "unable to write " << m_recordingPath << std::endl;
+        }
+    }
     makeCurrent();
     glDeleteVertexArrays(1, &vao);
     m_quad.destroyVBOdata();
+    m_noiseTexture.destroy();
+    m_renderGraph.destroy();
+    m_frameUniforms.destroy();
+}
+
+
+void MyGL::writeTrace() const {
+    if (Tracer::writeJson(m_tracePath)) {
+        std::cout << "wrote " << m_tracePath << std::endl;
+    } else {
+        std::cout << "unable to write " << m_tracePath << std::endl;
+    }
 }
 
+void MyGL::playEvent(const RecordedEvent &e) {
+    if (m_recordingInputs) {
+        m_recording.addEvent(e);
+    }
+    switch (e.kind) {
+    case RecordedEvent::ROTATE_UP_GLOBAL:
+        m_player.rotateOnUpGlobal(e.degrees);
+        break;
+    case RecordedEvent::ROTATE_RIGHT_LOCAL:
+        m_player.rotateOnRightLocal(e.degrees);
+        break;
+    case RecordedEvent::TOGGLE_FLIGHT:
+        m_player.flightMode = !m_player.flightMode;
+        break;
+    case RecordedEvent::SET_DRAW_RADIUS:
+        m_terrain.setDrawRadius(e.radius);
+        m_terrain.setCreateRadius(m_terrain.drawRadius() + 1);
+        break;
+    case RecordedEvent::BLOCK_EDIT:
+        m_player.applyEdit(e.edit, m_terrain, m_grass, m_dirt, m_stone, m_water, m_snow, m_lava);
+        break;
+    }
+}
+
+void MyGL::recordBlockEdit(bool edited, const BlockEdit &edit) {
+    if (edited && m_recordingInputs) {
+        m_recording.addEvent(RecordedEvent::blockEdit(edit));
+    }
+}
 
 void MyGL::moveMouseToCenter() {
     QCursor::setPos(this->mapToGlobal(QPoint(width() / 2, height() / 2)));
@@ -51,26 +156,60 @@ void MyGL::initializeGL()
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
     // Set the color with which the screen is filled at the start of each render call.
-    glClearColor(0.37f, 0.74f, 1.0f, 1);
-    m_frameBuffer.create();
+    glClearColor(SKY_COLOR.r, SKY_COLOR.g, SKY_COLOR.b, 1);
+
+    // The scene is drawn into an offscreen attachment only when the overlay
+    // pass needs it as a texture; otherwise it goes straight to the window
+    m_renderGraph.addPass({"scene", "", "scene", true, [this](FrameBuffer*) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        renderTerrain();
+    }});
+    m_renderGraph.addPass({"overlay", "scene", RENDER_GRAPH_BACKBUFFER, true, [this](FrameBuffer *scene) {
+        ScopedStageTimer timer(&m_profiler, STAGE_POST_PROCESS);
+        scene->bindToTextureSlot(1);
+        // The window's depth buffer isn't cleared when the overlay runs, so
+        // the quad mustn't be tested against it
+        glDisable(GL_DEPTH_TEST);
+        mp_postEffect->draw(m_quad, 1);
+        glEnable(GL_DEPTH_TEST);
+    }});
 
     printGLErrorLog();
 
     // Create a Vertex Attribute Object
     glGenVertexArrays(1, &vao);
+    // We have to have a VAO bound in OpenGL 3.2 Core. Terrain meshes have
+    // their own; everything else shares this one.
+    setDefaultVertexArray(vao);
+
+    m_frameUniforms.create();
+    m_noiseTexture.create(&m_resourceCache);
 
     //Create the instance of the world axes
     m_worldAxes.createVBOdata();
-
-    // Create and set up the diffuse shader
-    m_progLambert.create(":/glsl/lambert.vert.glsl", ":/glsl/lambert.frag.glsl");
-    // Create and set up the flat lighting shader
-    m_progFlat.create(":/glsl/flat.vert.glsl", ":/glsl/flat.frag.glsl");
-    m_progInstanced.create(":/glsl/lambert.vert.glsl", ":/glsl/lambert.frag.glsl");
-
-    m_progLava.create(":/glsl/overlay.vert.glsl", ":/glsl/lava.frag.glsl");
-    m_progWater.create(":/glsl/overlay.vert.glsl", ":/glsl/water.frag.glsl");
-    m_progNothing.create(":/glsl/overlay.vert.glsl", ":/glsl/nothing.frag.glsl");
+    m_terrain.createDecorationMeshes();
+
+    // Every program is started before any is finished, so that drivers
+    // which compile on several threads can build them side by side
+    const std::array<std::tuple<ShaderProgram*, const char*, const char*>, 6> programs {{
+        // The diffuse shader
+        {&m_progLambert, ":/glsl/lambert.vert.glsl", ":/glsl/lambert.frag.glsl"},
+        // The flat lighting shader
+        {&m_progFlat, ":/glsl/flat.vert.glsl", ":/glsl/flat.frag.glsl"},
+        // Torches, levers and plants, one instance per block
+        {&m_progInstanced, ":/glsl/decoration.vert.glsl", ":/glsl/lambert.frag.glsl"},
+        {&m_progLava, ":/glsl/overlay.vert.glsl", ":/glsl/lava.frag.glsl"},
+        {&m_progWater, ":/glsl/overlay.vert.glsl", ":/glsl/water.frag.glsl"},
+        {&m_progNothing, ":/glsl/overlay.vert.glsl", ":/glsl/nothing.frag.glsl"}
+    }};
+    for (const auto &program : programs) {
+        std::get<0>(program)->startCreate(std::get<1>(program), std::get<2>(program), &m_resourceCache);
+    }
+    m_programsFromCache = 0;
+    for (const auto &program : programs) {
+        std::get<0>(program)->finishCreate();
+        m_programsFromCache += std::get<0>(program)->loadedFromBinary();
+    }
 
     // Set a color with which to draw geometry.
     // This will ultimately not be used when you change
@@ -81,10 +220,6 @@ void MyGL::initializeGL()
     // Adding in post processing overlays for
 
 
-    // We have to have a VAO bound in OpenGL 3.2 Core. But if we're not
-    // using multiple VAOs, we can just bind one once.
-    glBindVertexArray(vao);
-
 //    m_terrain.CreateTestScene();
 
     //Texture and Texture paths
@@ -99,51 +234,79 @@ void MyGL::initializeGL()
 void MyGL::resizeGL(int w, int h) {
     //This code sets the concatenated view and perspective projection matrices used for
     //our scene's camera view.
+    // paintGL() uploads the matrix itself, along with the rest of the PerFrame block
     m_player.setCameraWidthHeight(static_cast<unsigned int>(w), static_cast<unsigned int>(h));
-    glm::mat4 viewproj = m_player.mcr_camera.getViewProj();
-
-    // Upload the view-projection matrix to our shaders (i.e. onto the graphics card)
-
-    m_progLambert.setViewProjMatrix(viewproj);
-    m_progFlat.setViewProjMatrix(viewproj);
 
     // Resizing frame buffer WITh FIX FOR DUMMY APPLE RENDER
-    int width, height;
-
+    // The render graph reallocates its attachments on the next frame, and
+    // only if they no longer fit
     #ifdef __APPLE__
-        m_frameBuffer.resize(w, h, this->devicePixelRatio()*0.5);
+        m_renderGraph.resize(w, h, this->devicePixelRatio()*0.5);
     #endif
     #ifndef __APPLE__
-        m_frameBuffer.resize(w, h, this->devicePixelRatio());
+        m_renderGraph.resize(w, h, this->devicePixelRatio());
     #endif
 
-
-    m_frameBuffer.destroy();
-    m_frameBuffer.create();
-
     printGLErrorLog();
 }
 
 
-// MyGL's constructor links tick() to a timer that fires 60 times per second.
+// MyGL's constructor links tick() to a timer that fires RENDER_HZ times per second.
 // We're treating MyGL as our game engine class, so we're going to perform
-// all per-frame actions here, such as performing physics updates on all
-// entities in the scene.
+// all per-frame actions here. Physics and redstone run in fixed steps of
+// their own, as many as the time since the last tick() calls for.
 void MyGL::tick() {
-    update(); // Calls paintGL() as part of a larger QOpenGLWidget pipeline
     sendPlayerDataToGUI(); // Updates the info in the secondary window displaying player data
-    qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
-    float deltaTime = static_cast<float>(currentTime - m_previousTime) / 1000.0f; // convert to seconds
-    m_previousTime = currentTime;
-
-    glm::vec3 playerPosPrev = m_player.mcr_position;
-    m_player.tick(deltaTime, m_inputs);
-    // expand terrain every 10 ticks
-    m_terrain.expandTerrain(m_player.mcr_position, playerPosPrev);
+
+    unsigned int radius = m_drawDistance.update(m_lastFrameMs, m_terrain.pendingMeshCount(), m_terrain.drawRadius());
+    if (radius != m_terrain.drawRadius()) {
+        playEvent(RecordedEvent::drawRadius(radius));
+        std::cout << "draw distance " << radius << " (" << m_drawDistance.averageFrameMs() << " ms/frame)" << std::endl;
+    }
+
+    float elapsed = m_simClock.isValid() ? m_simClock.nsecsElapsed() / 1e9f : 0.f;
+    m_simClock.restart();
+    m_simAccumulator = glm::min(m_simAccumulator + elapsed, SIM_MAX_STEPS_PER_TICK * m_simStep);
+    while (m_simAccumulator >= m_simStep) {
+        simulate(m_simStep);
+        m_simAccumulator -= m_simStep;
+    }
+    m_simAlpha = m_simAccumulator / m_simStep;
+
+    ScopedStageTimer terrainTimer(&m_profiler, STAGE_TERRAIN);
+    m_terrain.expandTerrain(m_player.mcr_position);
+    terrainTimer.finish();
+    // Mesh uploads happen outside paintGL, where the bindings are unknown
+    invalidateGLStateCache();
+    ScopedStageTimer uploadTimer(&m_profiler, STAGE_UPLOAD);
     m_terrain.checkThreadResults();
+    m_noiseTexture.checkThreadResults();
+    uploadTimer.finish();
     update();
 }
 
+void MyGL::simulate(float dT) {
+    // Everything since the last step belongs to this one
+    if (m_recordingInputs) {
+        m_recording.endTick(dT, m_inputs);
+    }
+    ScopedStageTimer physicsTimer(&m_profiler, STAGE_PHYSICS);
+    m_player.tick(dT, m_inputs);
+    // A mouse movement turns the player once, in the step after it
+    m_inputs.mouseDeltaX = 0.f;
+    m_inputs.mouseDeltaY = 0.f;
+    physicsTimer.finish();
+    ScopedStageTimer redstoneTimer(&m_profiler, STAGE_REDSTONE);
+    m_terrain.updateRedstone();
+    redstoneTimer.finish();
+    ScopedStageTimer fluidsTimer(&m_profiler, STAGE_FLUIDS);
+    m_terrain.updateFluids();
+    fluidsTimer.finish();
+    ScopedStageTimer entitiesTimer(&m_profiler, STAGE_ENTITIES);
+    m_entities.tick(dT, m_terrain);
+    entitiesTimer.finish();
+}
+
 void MyGL::sendPlayerDataToGUI() const {
     emit sig_sendPlayerPos(m_player.posAsQString());
     emit sig_sendPlayerVel(m_player.velAsQString());
@@ -154,6 +317,10 @@ void MyGL::sendPlayerDataToGUI() const {
     glm::ivec2 zone(64 * glm::ivec2(glm::floor(pPos / 64.f)));
     emit sig_sendPlayerChunk(QString::fromStdString("( " + std::to_string(chunk.x) + ", " + std::to_string(chunk.y) + " )"));
     emit sig_sendPlayerTerrainZone(QString::fromStdString("( " + std::to_string(zone.x) + ", " + std::to_string(zone.y) + " )"));
+    emit sig_sendRenderStats(m_terrain.renderStatsAsQString() +
+                             QString::fromStdString(", GL calls skipped: " + std::to_string(skippedGLCallsLastFrame()) +
+                                                    ", resolution: " + std::to_string(static_cast<int>(100 * m_resolutionScale.scale())) + "%" +
+                                                    ", passes skipped: " + std::to_string(m_renderGraph.passesSkipped())));
     emit sig_sendInvGrass(m_grass);
     emit sig_sendInvDirt(m_dirt);
     emit sig_sendInvStone(m_stone);
@@ -163,65 +330,146 @@ void MyGL::sendPlayerDataToGUI() const {
 }
 
 // This function is called whenever update() is called.
-// MyGL's constructor links update() to a timer that fires 60 times per second,
-// so paintGL() called at a rate of 60 frames per second.
+// tick() calls update() once each time the timer fires, so paintGL() is
+// called at up to RENDER_HZ frames per second.
 void MyGL::paintGL() {
+    TraceScope trace("frame");
+    if (m_frameTimer.isValid()) {
+        m_lastFrameMs = m_frameTimer.nsecsElapsed() / 1e6f;
+    } else {
+        std::cout << "first frame after " << m_startupTimer.elapsed() << " ms (" << m_programsFromCache
+                  << " shader programs from cache)" << std::endl;
+    }
+    m_frameTimer.restart();
+    // Qt's widget compositing may have rebound anything since the last frame
+    invalidateGLStateCache();
     m_time++;
-    m_progLambert.setTime(m_time);
-    // Clear the screen so that we only see newly drawn images
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    m_progFlat.setViewProjMatrix(m_player.mcr_camera.getViewProj());
-    m_progLambert.setViewProjMatrix(m_player.mcr_camera.getViewProj());
-    m_progInstanced.setViewProjMatrix(m_player.mcr_camera.getViewProj());
+    // No clear here: the scene pass clears whatever it draws into, and the
+    // overlay pass covers the whole window
+
+    // Post-processing is only needed underwater or in lava, and the scene
+    // only has to be scaled up when it was rendered below full resolution.
+    // If neither applies the overlay pass is skipped altogether.
+    // The player as of the last simulation step can be up to a step behind
+    // the wall clock, so draw from part of the way into the next one
+    Camera camera = m_player.interpolatedCamera(m_simAlpha);
+    const glm::vec3 &eye = camera.mcr_position;
+    BlockType eyeBlock = m_terrain.hasChunkAt(eye.x, eye.z) ? m_terrain.getBlockAt(eye.x, eye.y, eye.z) : EMPTY;
+    if (eyeBlock == WATER) {
+        mp_postEffect = &m_progWater;
+    } else if (eyeBlock == LAVA) {
+        mp_postEffect = &m_progLava;
+    } else {
+        mp_postEffect = &m_progNothing;
+    }
+    float scale = m_resolutionScale.update(m_lastFrameMs);
+    m_renderGraph.setScale(scale);
+    m_renderGraph.setPassEnabled("overlay", mp_postEffect != &m_progNothing || scale < 1.f);
+    m_renderGraph.compile();
+    FrameBuffer *sceneTarget = m_renderGraph.attachment("scene");
+
+    // Everything that stays the same across the frame's draws goes up in
+    // one buffer upload that every shader program reads from
+    m_viewProj = camera.getViewProj();
+    m_eye = eye;
+    float fogEnd = m_terrain.visibleDistance();
+    PerFrameUniformData frame;
+    frame.viewProj = m_viewProj;
+    frame.cameraPos = glm::vec4(eye, 1.f);
+    frame.fogColor = glm::vec4(SKY_COLOR, 1.f);
+    frame.fogParams = glm::vec4(FOG_START_FRACTION * fogEnd, fogEnd, 0.f, 0.f);
+    frame.time = m_time;
+    frame.viewportScale = sceneTarget ? sceneTarget->viewportScale() : glm::vec2(1.f);
+    m_frameUniforms.update(frame);
 
     //MS2: Animate
        //MS2: texturing
      m_texture.bind(0);
+     m_noiseTexture.bind(NOISE_TEXTURE_SLOT);
      m_progLambert.setTextureSlot(0);
+     m_progInstanced.setTextureSlot(0);
      m_progWater.setTextureSlot(1);
      m_progLava.setTextureSlot(1);
      m_progNothing.setTextureSlot(1);
 
-     m_frameBuffer.bindFrameBuffer();
-     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-
-    renderTerrain();
-
-
-    // FRAME BUFFER: //
-   glBindFramebuffer(GL_FRAMEBUFFER, this->defaultFramebufferObject());
-   m_frameBuffer.bindToTextureSlot(1);
-
-     if (m_terrain.hasChunkAt(m_player.mcr_camera.mcr_position.x, m_player.mcr_camera.mcr_position.z) && m_terrain.getBlockAt(m_player.mcr_camera.mcr_position.x, m_player.mcr_camera.mcr_position.y , m_player.mcr_camera.mcr_position.z) == WATER) {
-             m_progWater.draw(m_quad, 1);
-     } else if (m_terrain.hasChunkAt(m_player.mcr_camera.mcr_position.x, m_player.mcr_camera.mcr_position.z) && m_terrain.getBlockAt(m_player.mcr_camera.mcr_position.x, m_player.mcr_camera.mcr_position.y , m_player.mcr_camera.mcr_position.z) == LAVA) {
-             m_progLava.draw(m_quad, 1);
-     }
-     else {
-          m_progNothing.draw(m_quad, 1);
-
-     }
-
+    m_renderGraph.execute();
 
     glDisable(GL_DEPTH_TEST);
     m_progFlat.setModelMatrix(glm::mat4());
-    m_progFlat.setViewProjMatrix(m_player.mcr_camera.getViewProj());
 
     glEnable(GL_DEPTH_TEST);
+    endGLCallCount();
+
+    m_profiler.endFrame();
+    if (m_showFrameGraph) {
+        emit sig_frameProfiled();
+    }
 }
 
 // TODO: Change this so it renders the nine zones of generated
 // terrain that surround the player (refer to Terrain::m_generatedTerrain
 // for more info)
 void MyGL::renderTerrain() {
-    m_terrain.updateRedstone();
-    m_terrain.draw(m_player.mcr_position, &m_progLambert);
+    m_terrain.draw(m_player.mcr_position, m_eye, m_viewProj, &m_progLambert, &m_progInstanced);
+}
+
+
+void MyGL::prepareBenchmark() {
+    m_timer.stop();
+    m_drawDistance.setEnabled(false);
+    m_resolutionScale.setEnabled(false);
+}
+
+void MyGL::benchmarkFrame(const glm::vec3 &pos, const glm::vec3 &forward) {
+    m_player.setPose(pos, forward);
+    ScopedStageTimer terrainTimer(&m_profiler, STAGE_TERRAIN);
+    m_terrain.expandTerrain(m_player.mcr_position);
+    terrainTimer.finish();
+    invalidateGLStateCache();
+    ScopedStageTimer uploadTimer(&m_profiler, STAGE_UPLOAD);
+    m_terrain.checkThreadResults();
+    m_noiseTexture.checkThreadResults();
+    uploadTimer.finish();
+    paintGL();
+}
+
+void MyGL::replayTick(const RecordedTick &tick) {
+    TraceScope trace("tick");
+    for (const RecordedEvent &e : tick.events) {
+        playEvent(e);
+    }
+    m_inputs = tick.inputs;
+    simulate(tick.dT);
+    ScopedStageTimer terrainTimer(&m_profiler, STAGE_TERRAIN);
+    m_terrain.expandTerrain(m_player.mcr_position);
+    terrainTimer.finish();
+    // Generated chunks only get their meshing workers once their results
+    // are taken, so keep going until nothing is left in flight
+    ScopedStageTimer uploadTimer(&m_profiler, STAGE_UPLOAD);
+    do {
+        QThreadPool::globalInstance()->waitForDone();
+        m_terrain.checkThreadResults();
+        m_noiseTexture.checkThreadResults();
+    } while (m_terrain.pendingMeshCount() > 0);
+    uploadTimer.finish();
+    m_profiler.endFrame();
+}
+
+const glm::vec3 &MyGL::playerPosition() const {
+    return m_player.mcr_position;
+}
+
+const TerrainCounters &MyGL::terrainCounters() const {
+    return m_terrain.counters();
+}
+
+const FrameProfiler *MyGL::frameProfiler() const {
+    return &m_profiler;
 }
 
 
 void MyGL::keyPressEvent(QKeyEvent *e) {
+    ScopedStageTimer timer(&m_profiler, STAGE_INPUT);
     float amount = 2.0f;
     if(e->modifiers() & Qt::ShiftModifier){
         amount = 10.0f;
@@ -234,13 +482,13 @@ void MyGL::keyPressEvent(QKeyEvent *e) {
     if (e->key() == Qt::Key_Escape) {
         QApplication::quit();
     } else if (e->key() == Qt::Key_Right) {
-        m_player.rotateOnUpGlobal(-amount);
+        playEvent(RecordedEvent::rotation(RecordedEvent::ROTATE_UP_GLOBAL, -amount));
     } else if (e->key() == Qt::Key_Left) {
-        m_player.rotateOnUpGlobal(amount);
+        playEvent(RecordedEvent::rotation(RecordedEvent::ROTATE_UP_GLOBAL, amount));
     } else if (e->key() == Qt::Key_Up) {
-        m_player.rotateOnRightLocal(-amount);
+        playEvent(RecordedEvent::rotation(RecordedEvent::ROTATE_RIGHT_LOCAL, -amount));
     } else if (e->key() == Qt::Key_Down) {
-        m_player.rotateOnRightLocal(amount);
+        playEvent(RecordedEvent::rotation(RecordedEvent::ROTATE_RIGHT_LOCAL, amount));
     } else if (e->key() == Qt::Key_Space){
        m_inputs.spacePressed = true;
     } else if (e->key() == Qt::Key_W) {
@@ -256,7 +504,7 @@ void MyGL::keyPressEvent(QKeyEvent *e) {
     } else if (e->key() == Qt::Key_E) {
        m_inputs.ePressed = true;
     } else if (e->key() == Qt::Key_F) {
-       m_player.flightMode = !m_player.flightMode;
+       playEvent(RecordedEvent::toggleFlight());
     } else if (e->key() == Qt::Key_I) {
         m_inventory = !m_inventory;
         if (m_inventory) {
@@ -265,24 +513,110 @@ void MyGL::keyPressEvent(QKeyEvent *e) {
             std::cout << "hide inventory" << std::endl;
         }
         emit sig_openCloseInventory(m_inventory);
+    } else if (e->key() == Qt::Key_V) {
+        m_terrain.setSectionCulling(!m_terrain.sectionCulling());
+        if (m_terrain.sectionCulling()) {
+            std::cout << "section culling on" << std::endl;
+        } else {
+            std::cout << "section culling off" << std::endl;
+        }
+    } else if (e->key() == Qt::Key_O) {
+        m_terrain.setOcclusionCulling(!m_terrain.occlusionCulling());
+        if (m_terrain.occlusionCulling()) {
+            std::cout << "occlusion culling on" << std::endl;
+        } else {
+            std::cout << "occlusion culling off" << std::endl;
+        }
+    } else if (e->key() == Qt::Key_BracketLeft || e->key() == Qt::Key_BracketRight) {
+        // Adjusting by hand takes over from adaptive mode
+        m_drawDistance.setEnabled(false);
+        unsigned int radius = m_terrain.drawRadius();
+        if (e->key() == Qt::Key_BracketLeft && radius > 1) {
+            radius--;
+        } else if (e->key() == Qt::Key_BracketRight) {
+            radius++;
+        }
+        playEvent(RecordedEvent::drawRadius(radius));
+        std::cout << "draw distance " << m_terrain.drawRadius() << std::endl;
+    } else if (e->key() == Qt::Key_R) {
+        m_drawDistance.setEnabled(!m_drawDistance.enabled());
+        if (m_drawDistance.enabled()) {
+            std::cout << "adaptive draw distance on" << std::endl;
+        } else {
+            std::cout << "adaptive draw distance off" << std::endl;
+        }
+    } else if (e->key() == Qt::Key_C) {
+        if (m_terrain.zoneShape() == ZoneShape::SQUARE) {
+            m_terrain.setZoneShape(ZoneShape::CIRCLE);
+            std::cout << "circular draw distance" << std::endl;
+        } else {
+            m_terrain.setZoneShape(ZoneShape::SQUARE);
+            std::cout << "square draw distance" << std::endl;
+        }
+    } else if (e->key() == Qt::Key_L) {
+        m_terrain.setLODEnabled(!m_terrain.lodEnabled());
+        if (m_terrain.lodEnabled()) {
+            std::cout << "level of detail on" << std::endl;
+        } else {
+            std::cout << "level of detail off" << std::endl;
+        }
+    } else if (e->key() == Qt::Key_H) {
+        m_terrain.setFarTerrainEnabled(!m_terrain.farTerrainEnabled());
+        if (m_terrain.farTerrainEnabled()) {
+            std::cout << "far terrain on" << std::endl;
+        } else {
+            std::cout << "far terrain off" << std::endl;
+        }
+    } else if (e->key() == Qt::Key_F2) {
+        if (m_terrain.dumpOcclusionBuffer("occlusion_depth.pgm")) {
+            std::cout << "wrote occlusion_depth.pgm" << std::endl;
+        }
+    } else if (e->key() == Qt::Key_F3) {
+        m_resolutionScale.setEnabled(!m_resolutionScale.enabled());
+        if (m_resolutionScale.enabled()) {
+            std::cout << "dynamic resolution on" << std::endl;
+        } else {
+            std::cout << "dynamic resolution off" << std::endl;
+        }
+    } else if (e->key() == Qt::Key_F4) {
+        // The slowest frames are those seen while the graph was up
+        m_showFrameGraph = !m_showFrameGraph;
+        if (m_showFrameGraph) {
+            m_profiler.clearWorstFrames();
+        } else {
+            m_profiler.dumpWorstFrames();
+        }
+        emit sig_showFrameGraph(m_showFrameGraph);
+    } else if (e->key() == Qt::Key_F5) {
+        // Workers keep running, so stop recording before writing out
+        Tracer::setEnabled(!Tracer::enabled());
+        if (Tracer::enabled()) {
+            std::cout << "tracing" << std::endl;
+        } else {
+            writeTrace();
+        }
+    } else if (e->key() == Qt::Key_F6) {
+        MemoryStats::dump();
     }
 
+    BlockEdit edit;
     if (e->key() == Qt::Key_1) {
-        m_player.editBlock(m_inputs, m_terrain, true, REDSTONE_TORCH_ON, m_grass, m_dirt, m_stone, m_water, m_snow, m_lava);
+        recordBlockEdit(m_player.editBlock(m_inputs, m_terrain, true, REDSTONE_TORCH_ON, m_grass, m_dirt, m_stone, m_water, m_snow, m_lava, &edit), edit);
     } else if (e->key() == Qt::Key_2) {
-        m_player.editBlock(m_inputs, m_terrain, true, REDSTONE_LEVER_OFF, m_grass, m_dirt, m_stone, m_water, m_snow, m_lava);
+        recordBlockEdit(m_player.editBlock(m_inputs, m_terrain, true, REDSTONE_LEVER_OFF, m_grass, m_dirt, m_stone, m_water, m_snow, m_lava, &edit), edit);
     } else if (e->key() == Qt::Key_3) {
-        m_player.editBlock(m_inputs, m_terrain, true, REDSTONE_LAMP_OFF, m_grass, m_dirt, m_stone, m_water, m_snow, m_lava);
+        recordBlockEdit(m_player.editBlock(m_inputs, m_terrain, true, REDSTONE_LAMP_OFF, m_grass, m_dirt, m_stone, m_water, m_snow, m_lava, &edit), edit);
     } else if (e->key() == Qt::Key_4) {
-        m_player.editBlock(m_inputs, m_terrain, true, REDSTONE_WIRE_OFF, m_grass, m_dirt, m_stone, m_water, m_snow, m_lava);
+        recordBlockEdit(m_player.editBlock(m_inputs, m_terrain, true, REDSTONE_WIRE_OFF, m_grass, m_dirt, m_stone, m_water, m_snow, m_lava, &edit), edit);
     } else if (e->key() == Qt::Key_5) {
-        m_player.editBlock(m_inputs, m_terrain, true, CACTUS, m_grass, m_dirt, m_stone, m_water, m_snow, m_lava);
+        recordBlockEdit(m_player.editBlock(m_inputs, m_terrain, true, CACTUS, m_grass, m_dirt, m_stone, m_water, m_snow, m_lava, &edit), edit);
     }
 }
 
 
 // WRITE KEY RELEASE EVENT WHICH DOES THE SAME THING AS BEFORE BUT TURNS EVERYTHING FALSE
 void MyGL::keyReleaseEvent(QKeyEvent *e) {
+    ScopedStageTimer timer(&m_profiler, STAGE_INPUT);
     float amount = 2.0f;
     if(e->modifiers() & Qt::ShiftModifier){
         amount = 10.0f;
@@ -310,6 +644,7 @@ void MyGL::keyReleaseEvent(QKeyEvent *e) {
 }
 
 void MyGL::mouseMoveEvent(QMouseEvent *e) {
+    ScopedStageTimer timer(&m_profiler, STAGE_INPUT);
     // teleport mouse back to the center after i update m_inputs
     // can calculate the distance different because i know how large the screen is and where the center is
     // calculate what ^ degree away this is & then rotate the camera that way
@@ -318,14 +653,16 @@ void MyGL::mouseMoveEvent(QMouseEvent *e) {
     float centerX = width() / 2;
     float centerY= height() / 2;
 
-    m_inputs.mouseDeltaX = e->pos().rx() - centerX;
-    m_inputs.mouseDeltaY = e->pos().ry() - centerY;
+    // Adds up until the next simulation step uses it
+    m_inputs.mouseDeltaX += e->pos().rx() - centerX;
+    m_inputs.mouseDeltaY += e->pos().ry() - centerY;
 
     moveMouseToCenter();
 
 }
 
 void MyGL::mousePressEvent(QMouseEvent *e) {
+    ScopedStageTimer timer(&m_profiler, STAGE_INPUT);
 //    if (e->button() == Qt::LeftButton) {
 // find block that i want to destroy
     // in chunk information, take list of blocks and remove it
@@ -335,9 +672,10 @@ void MyGL::mousePressEvent(QMouseEvent *e) {
     // createvbo data
 //    }
 
+    BlockEdit edit;
     if (e->button() == Qt::LeftButton) {
-        m_player.editBlock(m_inputs, m_terrain, false, EMPTY, m_grass, m_dirt, m_stone, m_water, m_snow, m_lava);
+        recordBlockEdit(m_player.editBlock(m_inputs, m_terrain, false, EMPTY, m_grass, m_dirt, m_stone, m_water, m_snow, m_lava, &edit), edit);
     } else if (e->button() == Qt::RightButton) {
-        m_player.editBlock(m_inputs, m_terrain, true, m_inventorySelectedBlock, m_grass, m_dirt, m_stone, m_water, m_snow, m_lava);
+        recordBlockEdit(m_player.editBlock(m_inputs, m_terrain, true, m_inventorySelectedBlock, m_grass, m_dirt, m_stone, m_water, m_snow, m_lava, &edit), edit);
     }
 }
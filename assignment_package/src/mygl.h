@@ -1,7 +1,7 @@
 #ifndef MYGL_H
 #define MYGL_H
 
-#include "framebuffer.h"
+#include "rendergraph.h"
 #include "openglcontext.h"
 #include "scene/quad.h"
 #include "scene/texture.h"
@@ -10,12 +10,32 @@
 #include "scene/camera.h"
 #include "scene/terrain.h"
 #include "scene/player.h"
+#include "scene/entitysystem.h"
+#include "drawdistancecontroller.h"
+#include "frameuniforms.h"
+#include "frameprofiler.h"
+#include "inputrecording.h"
+#include "resolutionscalecontroller.h"
+#include "resourcecache.h"
+#include "scene/noisetexture.h"
 #include <QDate>
+#include <QElapsedTimer>
 
 #include <QOpenGLVertexArrayObject>
 #include <QOpenGLShaderProgram>
 #include <smartpointerhelp.h>
 
+// The sky, which the screen is cleared to and distant terrain fades into
+#define SKY_COLOR glm::vec3(0.37f, 0.74f, 1.0f)
+// Fraction of the visible distance at which fog starts to thicken
+#define FOG_START_FRACTION 0.6f
+// Default rates of the simulation and of the timer that draws frames, in
+// times per second; --sim-hz=<n> and --render-hz=<n> change them
+#define SIM_TICK_HZ 60
+#define RENDER_HZ 60
+// Most simulation steps one tick() runs to catch up. Time beyond that is
+// dropped, so a stall slows the game down rather than snowballing.
+#define SIM_MAX_STEPS_PER_TICK 5
 
 class MyGL : public OpenGLContext
 {
@@ -31,22 +51,51 @@ private:
     ShaderProgram m_progWater;
     ShaderProgram m_progNothing;
 
+    FrameUniforms m_frameUniforms; // The view-projection matrix, time and fog shared by every shader
+
     GLuint vao; // A handle for our vertex array object. This will store the VBOs created in our geometry classes.
                 // Don't worry too much about this. Just know it is necessary in order to render geometry.
 
     Terrain m_terrain; // All of the Chunks that currently comprise the world.
     Player m_player; // The entity controlled by the user. Contains a camera to display what it sees as well.
+    // Every other entity in the world. Nothing in the game spawns any yet,
+    // and there is no way to draw them, so for now its tick is only put
+    // under load by the bench's crowd.
+    EntitySystem m_entities;
     InputBundle m_inputs; // A collection of variables to be updated in keyPressEvent, mouseMoveEvent, mousePressEvent, etc.
 
     bool m_inventory; //status of inventory window
-    QTimer m_timer; // Timer linked to tick(). Fires approximately 60 times per second.
-    qint64 m_previousTime;
+    QTimer m_timer; // Timer linked to tick(). Fires RENDER_HZ times per second unless --render-hz says otherwise.
+    // The simulation advances in fixed steps of m_simStep seconds, however
+    // often the timer fires, and frames are drawn between the last two
+    float m_simStep;
+    float m_simAccumulator; // Wall time not yet simulated, in seconds
+    float m_simAlpha; // How far into the next step the wall clock is, from 0 to 1
+    QElapsedTimer m_simClock; // Time since the previous tick()
+
+    QElapsedTimer m_frameTimer; // Measures the interval between consecutive paintGL() calls
+    float m_lastFrameMs;
+    QElapsedTimer m_startupTimer; // Runs from construction, for reporting the time to the first frame
+    int m_programsFromCache; // Shader programs initializeGL() loaded as binaries rather than compiled
+    DrawDistanceController m_drawDistance; // Adjusts the terrain draw radius to hold the frame rate
+    ResolutionScaleController m_resolutionScale; // Adjusts the resolution the scene is rendered at, every frame
+    FrameProfiler m_profiler; // Times the stages of every frame, for the graph in the player info window
+    bool m_showFrameGraph; // Toggled with F4
+    std::string m_tracePath; // Where the Tracer's events go when F5 turns it off, or at exit
+    InputRecording m_recording; // Every tick since startup, when --record was given
+    bool m_recordingInputs;
+    std::string m_recordingPath; // Written at exit
 
     // Post-processing overlays
-    FrameBuffer m_frameBuffer;
+    RenderGraph m_renderGraph; // The scene pass, and the overlay pass that is skipped when it has nothing to do
+    ShaderProgram *mp_postEffect; // Overlay for this frame; m_progNothing just copies the scene
     Quad m_quad;
+    glm::mat4 m_viewProj; // The camera's, computed once per frame in paintGL()
+    glm::vec3 m_eye; // Where m_viewProj looks from
 
     Texture m_texture; // MS2: Adding in texturing
+    ResourceCache m_resourceCache; // Startup data baked to disk; only enabled by --resource-cache
+    NoiseTexture m_noiseTexture; // Animates water and lava surfaces
     int m_time; //MS2:: NOT to be confused with m_timer!
 
     void moveMouseToCenter(); // Forces the mouse position to the screen's center. You should call this
@@ -54,6 +103,14 @@ private:
                               // your mouse stays within the screen bounds and is always read.
 
     void sendPlayerDataToGUI() const;
+    void writeTrace() const;
+    // One fixed step of the player, redstone, fluids and entities
+    void simulate(float dT);
+    // Does something that changes the player or the world, noting it
+    // down first if recording
+    void playEvent(const RecordedEvent &e);
+    // Notes down a block edit that has already been done
+    void recordBlockEdit(bool edited, const BlockEdit &edit);
 
 
 public:
@@ -79,6 +136,22 @@ public:
     // Calls Terrain::draw().
     void renderTerrain();
 
+    // Stops the tick timer and the adaptive controllers, so that frames
+    // only happen through benchmarkFrame() or replayTick() and all do the
+    // same work
+    void prepareBenchmark();
+    // Puts the player at pos looking along forward, then does what tick()
+    // would minus the physics, and draws a frame
+    void benchmarkFrame(const glm::vec3 &pos, const glm::vec3 &forward);
+    // Does what tick() would with the recorded dT and inputs, then waits
+    // for every terrain worker to finish and takes its results, so the
+    // world is in the same state after each tick on every run. Nothing is
+    // drawn.
+    void replayTick(const RecordedTick &tick);
+    const glm::vec3 &playerPosition() const;
+    const TerrainCounters &terrainCounters() const;
+    const FrameProfiler *frameProfiler() const;
+
 protected:
     // Automatically invoked when the user
     // presses a key on the keyboard
@@ -94,7 +167,7 @@ protected:
     void mousePressEvent(QMouseEvent *e);
 
 private slots:
-    void tick(); // Slot that gets called ~60 times per second by m_timer firing.
+    void tick(); // Slot that gets called by m_timer firing. Runs whatever simulation steps are due, then draws.
 
 signals:
     void sig_sendPlayerPos(QString) const;
@@ -103,6 +176,9 @@ signals:
     void sig_sendPlayerLook(QString) const;
     void sig_sendPlayerChunk(QString) const;
     void sig_sendPlayerTerrainZone(QString) const;
+    void sig_sendRenderStats(QString) const;
+    void sig_showFrameGraph(bool);
+    void sig_frameProfiled() const;
 
     void sig_openCloseInventory(bool);
 
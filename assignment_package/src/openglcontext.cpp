@@ -1,6 +1,8 @@
 #include "openglcontext.h"
+#include "memorystats.h"
 
 #include <iostream>
+#include <stdexcept>
 #include <QApplication>
 #include <QProcessEnvironment>
 #include <QOpenGLContext>
@@ -8,8 +10,12 @@
 
 
 OpenGLContext::OpenGLContext(QWidget *parent)
-    : QOpenGLWidget(parent)
-{}
+    : QOpenGLWidget(parent),
+      m_glState{GL_STATE_UNKNOWN, GL_STATE_UNKNOWN, 0, -1, {}, 0, 0},
+      m_targetFramebuffer(0), m_bufferBytes()
+{
+    m_glState.textures.fill(GL_STATE_UNKNOWN);
+}
 
 OpenGLContext::~OpenGLContext()
 {}
@@ -21,7 +27,8 @@ inline const char *glGS(GLenum e)
 
 void OpenGLContext::debugContextVersion()
 {
-    QOpenGLContext *ctx = context();
+    // Not context(): a widget rendering offscreen never gets one of its own
+    QOpenGLContext *ctx = QOpenGLContext::currentContext();
     QSurfaceFormat form = format();
     QSurfaceFormat ctxform = ctx->format();
     QSurfaceFormat::OpenGLContextProfile prof = ctxform.profile();
@@ -143,3 +150,107 @@ void OpenGLContext::printShaderInfoLog(int shader)
     // Throwing here allows us to use the debugger to track down the error.
     throw;
 }
+
+void OpenGLContext::useProgramCached(GLuint prog) {
+    if (m_glState.program == prog) {
+        m_glState.skippedCalls++;
+        return;
+    }
+    glUseProgram(prog);
+    m_glState.program = prog;
+}
+
+void OpenGLContext::bindVertexArrayCached(GLuint vao) {
+    if (m_glState.vertexArray == vao) {
+        m_glState.skippedCalls++;
+        return;
+    }
+    glBindVertexArray(vao);
+    m_glState.vertexArray = vao;
+}
+
+void OpenGLContext::bindTexture2DCached(int slot, GLuint texture) {
+    bindTextureCached(slot, GL_TEXTURE_2D, texture);
+}
+
+// Texture names are unique across targets, so one name per slot is enough
+// to recognize a repeated bind
+void OpenGLContext::bindTextureCached(int slot, GLenum target, GLuint texture) {
+    if (slot < 0 || slot >= GL_STATE_CACHE_TEXTURE_SLOTS) {
+        throw std::out_of_range("Texture slot " + std::to_string(slot) + " is not tracked by the GL state cache!");
+    }
+    if (m_glState.textures[slot] == texture) {
+        m_glState.skippedCalls += 2;
+        return;
+    }
+    if (m_glState.activeTextureSlot != slot) {
+        glActiveTexture(GL_TEXTURE0 + slot);
+        m_glState.activeTextureSlot = slot;
+    }
+    glBindTexture(target, texture);
+    m_glState.textures[slot] = texture;
+}
+
+void OpenGLContext::setDefaultVertexArray(GLuint vao) {
+    m_glState.defaultVertexArray = vao;
+    glBindVertexArray(vao);
+    m_glState.vertexArray = vao;
+}
+
+void OpenGLContext::bindDefaultVertexArray() {
+    bindVertexArrayCached(m_glState.defaultVertexArray);
+}
+
+void OpenGLContext::invalidateGLStateCache() {
+    m_glState.program = GL_STATE_UNKNOWN;
+    m_glState.vertexArray = GL_STATE_UNKNOWN;
+    m_glState.activeTextureSlot = -1;
+    m_glState.textures.fill(GL_STATE_UNKNOWN);
+}
+
+void OpenGLContext::countSkippedGLCalls(int calls) {
+    m_glState.skippedCalls += calls;
+}
+
+void OpenGLContext::endGLCallCount() {
+    m_glState.skippedCallsLastFrame = m_glState.skippedCalls;
+    m_glState.skippedCalls = 0;
+}
+
+int OpenGLContext::skippedGLCallsLastFrame() const {
+    return m_glState.skippedCallsLastFrame;
+}
+
+void OpenGLContext::setTargetFramebufferObject(GLuint fbo) {
+    m_targetFramebuffer = fbo;
+}
+
+GLuint OpenGLContext::targetFramebufferObject() const {
+    return m_targetFramebuffer != 0 ? m_targetFramebuffer : defaultFramebufferObject();
+}
+
+void OpenGLContext::bufferDataTracked(GLenum target, GLuint buffer, GLsizeiptr size, const void *data, GLenum usage) {
+    glBufferData(target, size, data, usage);
+    GLsizeiptr &bytes = m_bufferBytes[buffer];
+    MemoryStats::add(MEM_GPU_BUFFERS, size - bytes);
+    bytes = size;
+}
+
+void OpenGLContext::bindIndexBuffer(GLuint buffer) {
+    bindDefaultVertexArray();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+}
+
+void OpenGLContext::bufferIndicesTracked(GLuint buffer, GLsizeiptr size, const void *data, GLenum usage) {
+    bindIndexBuffer(buffer);
+    bufferDataTracked(GL_ELEMENT_ARRAY_BUFFER, buffer, size, data, usage);
+}
+
+void OpenGLContext::deleteBufferTracked(GLuint buffer) {
+    glDeleteBuffers(1, &buffer);
+    auto it = m_bufferBytes.find(buffer);
+    if (it != m_bufferBytes.end()) {
+        MemoryStats::add(MEM_GPU_BUFFERS, -it->second);
+        m_bufferBytes.erase(it);
+    }
+}
@@ -3,7 +3,27 @@
 #include <QOpenGLWidget>
 #include <QTimer>
 #include <QOpenGLExtraFunctions>
+#include <array>
+#include <unordered_map>
 
+// Texture units whose bindings the state cache tracks
+#define GL_STATE_CACHE_TEXTURE_SLOTS 8
+// Stands in for a binding the state cache doesn't know
+#define GL_STATE_UNKNOWN 0xffffffffu
+
+// The GL state our own code last set. Lets redundant program, VAO and
+// texture binds be skipped without asking the driver what is bound.
+struct GLStateCache {
+    GLuint program;
+    GLuint vertexArray;
+    GLuint defaultVertexArray;
+    int activeTextureSlot;
+    std::array<GLuint, GL_STATE_CACHE_TEXTURE_SLOTS> textures;
+
+    // GL calls made unnecessary by the cache or by per-mesh VAOs
+    int skippedCalls;
+    int skippedCallsLastFrame;
+};
 
 class OpenGLContext
     : public QOpenGLWidget,
@@ -18,4 +38,48 @@ public:
     void printGLErrorLog();
     void printLinkInfoLog(int prog);
     void printShaderInfoLog(int shader);
+
+    // Cached versions of glUseProgram, glBindVertexArray and
+    // glActiveTexture + glBindTexture(GL_TEXTURE_2D, ...)
+    void useProgramCached(GLuint prog);
+    void bindVertexArrayCached(GLuint vao);
+    void bindTexture2DCached(int slot, GLuint texture);
+    // For texture targets other than GL_TEXTURE_2D
+    void bindTextureCached(int slot, GLenum target, GLuint texture);
+    // The VAO used by everything that sets up its attributes at draw time
+    void setDefaultVertexArray(GLuint vao);
+    void bindDefaultVertexArray();
+    // Forgets what is bound. Call after anything outside of the cached
+    // functions (including Qt itself) may have changed the bindings.
+    void invalidateGLStateCache();
+
+    void countSkippedGLCalls(int calls);
+    // Ends the current frame's count, which skippedGLCallsLastFrame()
+    // then reports until the next call
+    void endGLCallCount();
+    int skippedGLCallsLastFrame() const;
+
+    // Framebuffer that stands in for the window's when the widget isn't
+    // shown, e.g. when rendering offscreen. Pass 0 to go back to the window's.
+    void setTargetFramebufferObject(GLuint fbo);
+    // Where frames end up: the override if one is set, otherwise the window
+    GLuint targetFramebufferObject() const;
+
+    // glBufferData for buffer, which must be the one bound to target, with
+    // the size counted as MEM_GPU_BUFFERS until the buffer is re-specified
+    // or deleted with deleteBufferTracked
+    void bufferDataTracked(GLenum target, GLuint buffer, GLsizeiptr size, const void *data, GLenum usage);
+    // Binds buffer to GL_ELEMENT_ARRAY_BUFFER with the default VAO bound.
+    // The element buffer binding belongs to the bound VAO, so binding it
+    // with a mesh's VAO bound would replace that mesh's indices.
+    void bindIndexBuffer(GLuint buffer);
+    // bindIndexBuffer, then bufferDataTracked
+    void bufferIndicesTracked(GLuint buffer, GLsizeiptr size, const void *data, GLenum usage);
+    void deleteBufferTracked(GLuint buffer);
+
+private:
+    GLStateCache m_glState;
+    GLuint m_targetFramebuffer;
+    // Bytes last given to each buffer by bufferDataTracked
+    std::unordered_map<GLuint, GLsizeiptr> m_bufferBytes;
 };
@@ -1,11 +1,18 @@
 #include "playerinfo.h"
 #include "ui_playerinfo.h"
 
+// Where the frame graph goes, under the labels laid out in playerinfo.ui
+#define FRAME_GRAPH_TOP 340
+#define FRAME_GRAPH_HEIGHT 160
+
 PlayerInfo::PlayerInfo(QWidget *parent) :
     QWidget(parent),
-    ui(new Ui::PlayerInfo)
+    ui(new Ui::PlayerInfo), mp_frameGraph(new FrameGraph(this)), m_labelsHeight(0)
 {
     ui->setupUi(this);
+    m_labelsHeight = height();
+    mp_frameGraph->setGeometry(10, FRAME_GRAPH_TOP, 381, FRAME_GRAPH_HEIGHT);
+    mp_frameGraph->hide();
 }
 
 PlayerInfo::~PlayerInfo()
@@ -35,4 +42,24 @@ void PlayerInfo::slot_setChunkText(QString s) {
 void PlayerInfo::slot_setZoneText(QString s) {
     ui->zoneLabel->setText(s);
 }
+void PlayerInfo::slot_setRenderStatsText(QString s) {
+    ui->renderStatsLabel->setText(s);
+}
+
+void PlayerInfo::setFrameProfiler(const FrameProfiler *profiler) {
+    mp_frameGraph->setProfiler(profiler);
+}
 
+void PlayerInfo::slot_showFrameGraph(bool show) {
+    if (show) {
+        resize(width(), FRAME_GRAPH_TOP + FRAME_GRAPH_HEIGHT + 10);
+        mp_frameGraph->show();
+    } else {
+        mp_frameGraph->hide();
+        resize(width(), m_labelsHeight);
+    }
+}
+
+void PlayerInfo::slot_updateFrameGraph() {
+    mp_frameGraph->update();
+}
@@ -2,6 +2,7 @@
 #define PLAYERINFO_H
 
 #include <QWidget>
+#include "framegraph.h"
 
 namespace Ui {
 class PlayerInfo;
@@ -13,6 +14,8 @@ public:
     explicit PlayerInfo(QWidget *parent = nullptr);
     ~PlayerInfo();
 
+    void setFrameProfiler(const FrameProfiler *profiler);
+
 public slots:
     void slot_setPosText(QString);
     void slot_setVelText(QString);
@@ -20,9 +23,14 @@ public slots:
     void slot_setLookText(QString);
     void slot_setChunkText(QString);
     void slot_setZoneText(QString);
+    void slot_setRenderStatsText(QString);
+    void slot_showFrameGraph(bool);
+    void slot_updateFrameGraph();
 
 private:
     Ui::PlayerInfo *ui;
+    FrameGraph *mp_frameGraph; // Below the labels, shown with F4; owned by Qt as our child
+    int m_labelsHeight; // Window height without the frame graph
 };
 
 #endif // PLAYERINFO_H
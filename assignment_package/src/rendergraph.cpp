@@ -0,0 +1,112 @@
+#include "rendergraph.h"
+#include <stdexcept>
+
+RenderGraph::RenderGraph(OpenGLContext *context)
+    : mp_context(context), m_passes(), m_pool(), m_aliases(),
+      m_width(1), m_height(1), m_devicePixelRatio(1), m_scale(1.f), m_passesSkipped(0)
+{}
+
+void RenderGraph::addPass(const RenderPass &pass) {
+    m_passes.push_back(pass);
+}
+
+void RenderGraph::setPassEnabled(const std::string &name, bool enabled) {
+    for (RenderPass &pass : m_passes) {
+        if (pass.name == name) {
+            pass.enabled = enabled;
+            return;
+        }
+    }
+    throw std::out_of_range("No render pass named " + name + "!");
+}
+
+void RenderGraph::resize(unsigned int width, unsigned int height, unsigned int devicePixelRatio) {
+    // No GL work here; compile() reallocates whatever no longer fits
+    m_width = width;
+    m_height = height;
+    m_devicePixelRatio = devicePixelRatio;
+}
+
+void RenderGraph::setScale(float scale) {
+    m_scale = scale;
+}
+
+std::string RenderGraph::resolve(const std::string &name) const {
+    std::string resolved = name;
+    for (auto it = m_aliases.find(resolved); it != m_aliases.end(); it = m_aliases.find(resolved)) {
+        resolved = it->second;
+    }
+    return resolved;
+}
+
+void RenderGraph::compile() {
+    m_aliases.clear();
+    m_passesSkipped = 0;
+    // Backwards, so that a chain of disabled passes collapses onto the
+    // last output in it
+    for (auto it = m_passes.rbegin(); it != m_passes.rend(); ++it) {
+        if (it->enabled) {
+            continue;
+        }
+        m_passesSkipped++;
+        if (!it->input.empty()) {
+            m_aliases[it->input] = it->output;
+        }
+    }
+
+    for (const RenderPass &pass : m_passes) {
+        if (!pass.enabled) {
+            continue;
+        }
+        std::string output = resolve(pass.output);
+        if (output == RENDER_GRAPH_BACKBUFFER) {
+            continue;
+        }
+        uPtr<FrameBuffer> &fb = m_pool[output];
+        if (fb == nullptr) {
+            fb = mkU<FrameBuffer>(mp_context, m_width, m_height, m_devicePixelRatio);
+        }
+        fb->resize(m_width, m_height, m_devicePixelRatio);
+        fb->setScale(m_scale);
+        if (fb->needsReallocation()) {
+            fb->destroy();
+            fb->create();
+        }
+    }
+}
+
+FrameBuffer *RenderGraph::attachment(const std::string &name) {
+    auto it = m_pool.find(resolve(name));
+    return it == m_pool.end() ? nullptr : it->second.get();
+}
+
+void RenderGraph::bindOutput(const std::string &name) {
+    if (name == RENDER_GRAPH_BACKBUFFER) {
+        mp_context->glBindFramebuffer(GL_FRAMEBUFFER, mp_context->targetFramebufferObject());
+        mp_context->glViewport(0, 0, mp_context->width() * mp_context->devicePixelRatio(),
+                               mp_context->height() * mp_context->devicePixelRatio());
+    } else {
+        m_pool.at(name)->bindFrameBuffer();
+    }
+}
+
+void RenderGraph::execute() {
+    for (const RenderPass &pass : m_passes) {
+        if (!pass.enabled) {
+            continue;
+        }
+        bindOutput(resolve(pass.output));
+        pass.execute(pass.input.empty() ? nullptr : attachment(pass.input));
+    }
+}
+
+int RenderGraph::passesSkipped() const {
+    return m_passesSkipped;
+}
+
+void RenderGraph::destroy() {
+    for (auto &entry : m_pool) {
+        entry.second->destroy();
+    }
+    m_pool.clear();
+}
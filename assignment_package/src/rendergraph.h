@@ -0,0 +1,75 @@
+#pragma once
+#include "framebuffer.h"
+#include "smartpointerhelp.h"
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Name of the window's own framebuffer as a pass output
+#define RENDER_GRAPH_BACKBUFFER "backbuffer"
+
+// One step of the frame, drawing into an attachment and optionally
+// reading another one as a texture
+struct RenderPass {
+    std::string name;
+    // Attachment read as a texture, or empty
+    std::string input;
+    // Attachment drawn into
+    std::string output;
+    // A disabled pass is skipped, and if it has an input, whichever pass
+    // writes that input draws straight into this pass's output instead.
+    // That's how the scene ends up in the window without an offscreen
+    // copy when no post effect needs it as a texture.
+    bool enabled;
+    // Runs with the output bound and the viewport set; gets the input's
+    // frame buffer, or nullptr if the pass has no input
+    std::function<void(FrameBuffer *input)> execute;
+};
+
+// Runs a fixed list of passes each frame, working out from which passes
+// are enabled where every attachment actually lives. Offscreen attachments
+// are pooled by name and outlive resizes; they are only reallocated when
+// the window outgrows them or shrinks to well under their size.
+class RenderGraph {
+private:
+    OpenGLContext *mp_context;
+    std::vector<RenderPass> m_passes;
+    std::unordered_map<std::string, uPtr<FrameBuffer>> m_pool;
+    // Attachments redirected to another attachment by a disabled pass, as
+    // of the last compile()
+    std::unordered_map<std::string, std::string> m_aliases;
+
+    unsigned int m_width, m_height, m_devicePixelRatio;
+    float m_scale;
+    int m_passesSkipped;
+
+    // The attachment name is drawn into this frame
+    std::string resolve(const std::string &name) const;
+    void bindOutput(const std::string &name);
+
+public:
+    RenderGraph(OpenGLContext *context);
+
+    // Passes run in the order they were added
+    void addPass(const RenderPass &pass);
+    void setPassEnabled(const std::string &name, bool enabled);
+
+    // Size of the window in device-independent pixels
+    void resize(unsigned int width, unsigned int height, unsigned int devicePixelRatio);
+    // Fraction of the window size offscreen attachments are rendered at
+    void setScale(float scale);
+
+    // Works out the aliases for the enabled passes and makes sure every
+    // attachment still needed offscreen is allocated at a usable size
+    void compile();
+    // The frame buffer backing an attachment this frame, or nullptr if it
+    // is being drawn straight into the window
+    FrameBuffer *attachment(const std::string &name);
+    // Runs the enabled passes. Call compile() first.
+    void execute();
+    // Passes skipped in the last compile()
+    int passesSkipped() const;
+
+    void destroy();
+};
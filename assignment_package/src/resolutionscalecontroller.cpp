@@ -0,0 +1,48 @@
+#include "resolutionscalecontroller.h"
+#include "drawdistancecontroller.h"
+#include "glm_includes.h"
+
+// Weight of the newest frame in the moving average. Higher than the draw
+// distance controller's, since the scale can follow the frame time closely.
+#define FRAME_AVERAGE_WEIGHT 0.2f
+
+ResolutionScaleController::ResolutionScaleController()
+    : m_enabled(true), m_targetFrameMs(DRAW_DISTANCE_TARGET_FRAME_MS),
+      m_averageFrameMs(DRAW_DISTANCE_TARGET_FRAME_MS), m_scale(RESOLUTION_SCALE_MAX)
+{}
+
+void ResolutionScaleController::setEnabled(bool enabled) {
+    m_enabled = enabled;
+    if (!enabled) {
+        m_scale = RESOLUTION_SCALE_MAX;
+    }
+}
+
+bool ResolutionScaleController::enabled() const {
+    return m_enabled;
+}
+
+void ResolutionScaleController::setTargetFrameMs(float ms) {
+    m_targetFrameMs = ms;
+}
+
+float ResolutionScaleController::update(float frameMs) {
+    m_averageFrameMs += FRAME_AVERAGE_WEIGHT * (frameMs - m_averageFrameMs);
+    if (!m_enabled) {
+        return m_scale;
+    }
+
+    // Same thresholds as the draw distance: frames paced by the 16 ms timer
+    // count as fast enough, so the scale climbs back to full when there's room
+    float wanted = m_scale;
+    if (m_averageFrameMs > 1.2f * m_targetFrameMs || m_averageFrameMs < 1.05f * m_targetFrameMs) {
+        wanted = m_scale * glm::sqrt(m_targetFrameMs / m_averageFrameMs);
+    }
+    m_scale += glm::clamp(wanted - m_scale, -RESOLUTION_SCALE_MAX_STEP, RESOLUTION_SCALE_MAX_STEP);
+    m_scale = glm::clamp(m_scale, RESOLUTION_SCALE_MIN, RESOLUTION_SCALE_MAX);
+    return m_scale;
+}
+
+float ResolutionScaleController::scale() const {
+    return m_scale;
+}
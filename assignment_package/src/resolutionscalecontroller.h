@@ -0,0 +1,31 @@
+#pragma once
+
+// Bounds on the fraction of the window's width and height the scene is rendered at
+#define RESOLUTION_SCALE_MIN 0.5f
+#define RESOLUTION_SCALE_MAX 1.f
+// Largest change to the scale in a single frame, so the image doesn't visibly pump
+#define RESOLUTION_SCALE_MAX_STEP 0.02f
+
+// Picks the resolution the scene is rendered at each frame so that the
+// frame time stays near a target. Fill cost goes with the pixel count, i.e.
+// the square of the scale, so the scale is nudged by the square root of how
+// far the smoothed frame time is from the target. Unlike the draw distance
+// this is cheap to change, so it is adjusted every frame.
+class ResolutionScaleController {
+private:
+    bool m_enabled;
+    float m_targetFrameMs;
+    float m_averageFrameMs;
+    float m_scale;
+
+public:
+    ResolutionScaleController();
+
+    void setEnabled(bool enabled);
+    bool enabled() const;
+    void setTargetFrameMs(float ms);
+
+    // Feeds one frame's time and returns the scale to render the next frame at
+    float update(float frameMs);
+    float scale() const;
+};
@@ -0,0 +1,75 @@
+#include "resourcecache.h"
+#include <QDir>
+#include <QString>
+#include <cstdio>
+#include <fstream>
+
+ResourceCache::ResourceCache()
+    : m_directory(), m_enabled(false)
+{}
+
+bool ResourceCache::setDirectory(const std::string &directory) {
+    m_enabled = QDir().mkpath(QString::fromStdString(directory));
+    m_directory = directory;
+    return m_enabled;
+}
+
+bool ResourceCache::enabled() const {
+    return m_enabled;
+}
+
+std::string ResourceCache::pathFor(const std::string &key) const {
+    return m_directory + "/" + key + ".bin";
+}
+
+bool ResourceCache::load(const std::string &key, uint32_t version, std::vector<unsigned char> *data) const {
+    if (!m_enabled) {
+        return false;
+    }
+    std::ifstream in(pathFor(key), std::ios::binary);
+    uint32_t magic = 0, storedVersion = 0;
+    uint64_t size = 0;
+    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    in.read(reinterpret_cast<char*>(&storedVersion), sizeof(storedVersion));
+    in.read(reinterpret_cast<char*>(&size), sizeof(size));
+    if (!in || magic != RESOURCE_CACHE_MAGIC || storedVersion != version) {
+        return false;
+    }
+    // The size comes from the file, so a corrupt or cut-off entry could ask
+    // for any amount. Only trust it if it is exactly what the file holds.
+    std::streampos start = in.tellg();
+    in.seekg(0, std::ios::end);
+    uint64_t remaining = static_cast<uint64_t>(in.tellg() - start);
+    in.seekg(start);
+    if (!in || size != remaining) {
+        return false;
+    }
+    data->resize(size);
+    in.read(reinterpret_cast<char*>(data->data()), size);
+    // A short read means the file was cut off, so it's as good as missing
+    return static_cast<uint64_t>(in.gcount()) == size;
+}
+
+bool ResourceCache::store(const std::string &key, uint32_t version, const std::vector<unsigned char> &data) const {
+    if (!m_enabled) {
+        return false;
+    }
+    // Write beside the real file and move it into place once complete, so
+    // that a crash midway never leaves a truncated entry behind
+    std::string path = pathFor(key);
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        uint32_t magic = RESOURCE_CACHE_MAGIC;
+        uint64_t size = data.size();
+        out.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+        out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        out.write(reinterpret_cast<const char*>(data.data()), size);
+        if (!out) {
+            return false;
+        }
+    }
+    std::remove(path.c_str());
+    return std::rename(tempPath.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Files in the cache start with this, followed by the entry's version
+// and the payload's size in bytes
+#define RESOURCE_CACHE_MAGIC 0x4352524du // "MRRC"
+
+// On-disk store for data that takes a while to build at startup but only
+// changes when the code that builds it does. Each entry carries a version
+// chosen by its owner; loading an entry written with any other version
+// fails, so bumping the version is enough to rebuild it.
+// Loads and stores of different keys may run on different threads at once.
+class ResourceCache {
+private:
+    std::string m_directory;
+    bool m_enabled;
+
+    std::string pathFor(const std::string &key) const;
+
+public:
+    // Disabled until given a directory
+    ResourceCache();
+
+    // Creates the directory if needed. Returns false, leaving the cache
+    // disabled, if it can't.
+    bool setDirectory(const std::string &directory);
+    bool enabled() const;
+
+    // Both fail quietly when the cache is disabled
+    bool load(const std::string &key, uint32_t version, std::vector<unsigned char> *data) const;
+    bool store(const std::string &key, uint32_t version, const std::vector<unsigned char> &data) const;
+};
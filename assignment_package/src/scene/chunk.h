@@ -4,7 +4,8 @@
 #include <array>
 #include <unordered_map>
 #include <cstddef>
-#include "chunkhelpers.h"
+#include "chunkdata.h"
+#include "chunkmesher.h"
 
 
 //using namespace std;
@@ -16,47 +17,101 @@
 // render all the world at once, while also not having
 // to render the world block by block.
 
+// Transparent faces are re-sorted whenever the camera moves into another
+// cell of this many blocks, i.e. crosses a section boundary
+#define TRANSPARENCY_SORT_CELL_SIZE 16
+
+// Cell of the transparency sort grid containing pos
+glm::ivec3 transparencySortCell(const glm::vec3 &pos);
+
 class Chunk;
 
-struct ChunkVBOData {
+// A chunk's mesh data on its way from a VBOWorker to the main thread
+struct ChunkVBOData : public ChunkMeshData {
+    Chunk *c;
+
+    ChunkVBOData(Chunk *c, const glm::vec3 &sortEye = glm::vec3())
+        : ChunkMeshData(sortEye), c(c)
+    {}
+};
+
+// Transparent indices re-sorted for a new camera position, built on a
+// worker thread for a mesh that is already on the GPU
+struct ChunkSortData {
     Chunk *c;
-    std::vector<float> vboDataOpaque, vboDataTransparent;
-    std::vector<GLuint> idxDataOpaque, idxDataTransparent;
+    std::vector<GLuint> idxDataTransparent;
+    // Chunk::m_meshUploads of the mesh the indices were sorted for
+    uint32_t meshUpload;
+    glm::ivec3 sortCell;
+    TrackedBytes trackedBytes;
 
-    ChunkVBOData(Chunk *c)
-        : c(c), vboDataOpaque{}, vboDataTransparent{}, idxDataOpaque{}, idxDataTransparent{}
+    ChunkSortData(Chunk *c, uint32_t meshUpload, glm::ivec3 sortCell)
+        : c(c), idxDataTransparent{}, meshUpload(meshUpload), sortCell(sortCell),
+          trackedBytes(MEM_MESH_CPU)
     {}
 };
 
-class Chunk : public Drawable {
+// The GPU side of a chunk: its uploaded mesh and everything Terrain::draw
+// needs to cull and draw it. The blocks themselves live in ChunkData.
+class Chunk : public ChunkData, public Drawable {
 private:
-    // All of the blocks contained within this Chunk
-    std::array<BlockType, 65536> m_blocks;
-    // This Chunk's four neighbors to the north, south, east, and west
-    // The third input to this map just lets us use a Direction as
-    // a key for this map.
-    // These allow us to properly determine
-    std::unordered_map<Direction, Chunk*, EnumHash> m_neighbors;
-
-    int chunkX, chunkZ;
     int countOpq;
 
     ChunkVBOData vboData;
 
+    // Copied out of the ChunkVBOData whose buffers are currently uploaded,
+    // so that Terrain::draw can draw and cull individual sections.
+    std::array<unsigned int, SECTIONS_PER_CHUNK + 1> m_sectionIdxOpq, m_sectionIdxTra;
+    std::array<SectionVisibility, SECTIONS_PER_CHUNK> m_sectionVisibility;
+
+    // meshInputVersion() of the mesh currently on the GPU, if there is one
+    bool m_hasMesh;
+    uint64_t m_meshVersion;
+
+    // Level of detail of the mesh currently on the GPU
+    int m_meshLod;
+
+    // Kept from the uploaded mesh so its transparent faces can be re-sorted
+    // without remeshing
+    std::vector<glm::vec3> m_quadCentersTra;
+    // Sort cell the uploaded transparent indices were sorted in
+    glm::ivec3 m_sortCell;
+    // Whether a TransparencySortWorker is working on this chunk
+    bool m_sortPending;
+    // Bumped whenever the GPU buffers are replaced or freed, so that sort
+    // results for an older mesh can be recognized and dropped
+    uint32_t m_meshUploads;
+
+    // Instance buffer of the uploaded mesh's decorations, with the range of
+    // each shape in it, and the instance of every decoration block by index
+    // into m_blocks so that switching one on or off is a small buffer write
+    GLuint m_bufDecorations;
+    bool m_decorationsGenerated;
+    std::array<unsigned int, DECORATION_SHAPE_COUNT + 1> m_decorationOffsets;
+    std::unordered_map<int, unsigned int> m_decorationSlots;
+    // m_quadCentersTra and m_decorationSlots
+    TrackedBytes m_trackedBytes;
+
 public:
     Chunk(OpenGLContext* mp_context, int x, int y);
+    // Meshes and uploads the chunk right away, on the calling thread
     void createVBOdata() override;
-    BlockType getBlockAt(unsigned int x, unsigned int y, unsigned int z) const;
-    BlockType getBlockAt(int x, int y, int z) const;
-    void setBlockAt(unsigned int x, unsigned int y, unsigned int z, BlockType t);
-    void linkNeighbor(uPtr<Chunk>& neighbor, Direction dir);
-    glm::ivec2 getCoords();
 
-    void createVBOdata(const std::vector<float> &vboDataOpaque, const std::vector<GLuint> &idxDataOpaque,
-                       const std::vector<float> &vboDataTransparent, const std::vector<GLuint> &idxDataTransparent);
-    static void buildVBODataForChunk(Chunk *chunk, ChunkVBOData *chunkData);
+    // True if the mesh on the GPU is up to date with the blocks and at the requested LOD
+    bool hasCurrentMesh() const;
+    void destroyVBOdata() override;
+
+    void createVBOdata(const ChunkVBOData &data);
+    // Replaces the transparent index buffer's contents in place. The
+    // vertices and section ranges stay as they are.
+    void updateTransparentIndices(const ChunkSortData &data);
+    // Swaps a decoration for another of the same shape, such as a lever
+    // being switched, by rewriting its instance in place. Returns false,
+    // changing nothing, if the swap needs a remesh instead.
+    bool updateDecoration(unsigned int x, unsigned int y, unsigned int z, BlockType t);
 
     friend class Terrain;
     friend class FBMWorker;
     friend class VBOWorker;
+    friend class TransparencySortWorker;
 };
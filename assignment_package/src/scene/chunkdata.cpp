@@ -0,0 +1,108 @@
+#include "chunkdata.h"
+#include <algorithm>
+
+// Combine two 32-bit ints into one 64-bit int
+// where the upper 32 bits are X and the lower 32 bits are Z
+int64_t toKey(int x, int z) {
+    int64_t xz = 0xffffffffffffffff;
+    int64_t x64 = x;
+    int64_t z64 = z;
+
+    // Set all lower 32 bits to 1 so we can & with Z later
+    xz = (xz & (x64 << 32)) | 0x00000000ffffffff;
+
+    // Set all upper 32 bits to 1 so we can & with XZ
+    z64 = z64 | 0xffffffff00000000;
+
+    // Combine
+    xz = xz & z64;
+    return xz;
+}
+
+glm::ivec2 toCoords(int64_t k) {
+    // Z is lower 32 bits
+    int64_t z = k & 0x00000000ffffffff;
+    // If the most significant bit of Z is 1, then it's a negative number
+    // so we have to set all the upper 32 bits to 1.
+    // Note the 8    V
+    if(z & 0x0000000080000000) {
+        z = z | 0xffffffff00000000;
+    }
+    int64_t x = (k >> 32);
+
+    return glm::ivec2(x, z);
+}
+
+ChunkData::ChunkData(int x, int z)
+    : m_blocks(), m_neighbors{{XPOS, nullptr}, {XNEG, nullptr}, {ZPOS, nullptr}, {ZNEG, nullptr}},
+      chunkX(x), chunkZ(z), m_blockVersion(0), m_lod(0),
+      m_trackedBlocks(MEM_CHUNK_BLOCKS, sizeof(m_blocks))
+{
+    std::fill_n(m_blocks.begin(), 65536, EMPTY);
+}
+
+ChunkData::~ChunkData()
+{}
+
+// Does bounds checking with at()
+BlockType ChunkData::getBlockAt(unsigned int x, unsigned int y, unsigned int z) const {
+    return m_blocks.at(x + 16 * y + 16 * 256 * z);
+}
+
+// Exists to get rid of compiler warnings about int -> unsigned int implicit conversion
+BlockType ChunkData::getBlockAt(int x, int y, int z) const {
+    if (y < 0 || y > 255) return EMPTY;
+    return getBlockAt(static_cast<unsigned int>(x), static_cast<unsigned int>(y), static_cast<unsigned int>(z));
+}
+
+// Does bounds checking with at()
+void ChunkData::setBlockAt(unsigned int x, unsigned int y, unsigned int z, BlockType t) {
+    m_blocks.at(x + 16 * y + 16 * 256 * z) = t;
+    m_blockVersion.fetch_add(1, std::memory_order_relaxed);
+}
+
+const std::array<BlockType, 65536> &ChunkData::blocks() const {
+    return m_blocks;
+}
+
+ChunkData *ChunkData::neighbor(Direction dir) const {
+    return m_neighbors.at(dir);
+}
+
+const static std::unordered_map<Direction, Direction, EnumHash> oppositeDirection {
+    {XPOS, XNEG},
+    {XNEG, XPOS},
+    {YPOS, YNEG},
+    {YNEG, YPOS},
+    {ZPOS, ZNEG},
+    {ZNEG, ZPOS}
+};
+
+void ChunkData::linkNeighbor(ChunkData *neighbor, Direction dir) {
+    if(neighbor != nullptr) {
+        this->m_neighbors[dir] = neighbor;
+        neighbor->m_neighbors[oppositeDirection.at(dir)] = this;
+    }
+}
+
+glm::ivec2 ChunkData::getCoords() const {
+    return glm::ivec2(chunkX, chunkZ);
+}
+
+uint64_t ChunkData::meshInputVersion() const {
+    uint64_t version = m_blockVersion.load(std::memory_order_relaxed);
+    for (Direction dir : {XPOS, XNEG, ZPOS, ZNEG}) {
+        const ChunkData *n = m_neighbors.at(dir);
+        // Missing neighbors count differently from empty ones
+        version = version * 1000003u + (n ? n->m_blockVersion.load(std::memory_order_relaxed) + 1 : 0);
+    }
+    return version;
+}
+
+void ChunkData::setLOD(int lod) {
+    m_lod.store(lod, std::memory_order_relaxed);
+}
+
+int ChunkData::lod() const {
+    return m_lod.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "chunkhelpers.h"
+#include "memorystats.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+
+// Helper functions to convert (x, z) to and from hash map key
+int64_t toKey(int x, int z);
+glm::ivec2 toCoords(int64_t k);
+
+// The blocks of one 16 x 256 x 16 Chunk and its links to the chunks around
+// it, without any of the GPU side. Everything that only reads or writes
+// blocks (terrain generation, meshing, raycasts) works on this, so that it
+// can run, and be benchmarked, without an OpenGL context.
+class ChunkData {
+protected:
+    // All of the blocks contained within this Chunk
+    std::array<BlockType, 65536> m_blocks;
+    // This Chunk's four neighbors to the north, south, east, and west
+    // The third input to this map just lets us use a Direction as
+    // a key for this map.
+    std::unordered_map<Direction, ChunkData*, EnumHash> m_neighbors;
+
+    int chunkX, chunkZ;
+
+    // Bumped on every block change, from any thread
+    std::atomic<uint32_t> m_blockVersion;
+
+    // Level of detail the next mesh should be built at, chosen by Terrain
+    // and read by VBOWorkers
+    std::atomic<int> m_lod;
+
+    TrackedBytes m_trackedBlocks;
+
+public:
+    ChunkData(int x, int z);
+    virtual ~ChunkData();
+
+    BlockType getBlockAt(unsigned int x, unsigned int y, unsigned int z) const;
+    BlockType getBlockAt(int x, int y, int z) const;
+    void setBlockAt(unsigned int x, unsigned int y, unsigned int z, BlockType t);
+    const std::array<BlockType, 65536> &blocks() const;
+    // The chunk in direction dir, or nullptr if it doesn't exist yet
+    ChunkData *neighbor(Direction dir) const;
+    void linkNeighbor(ChunkData *neighbor, Direction dir);
+    glm::ivec2 getCoords() const;
+
+    // Combines this chunk's block version with those of its neighbors, since
+    // faces on the chunk border depend on the neighboring blocks too.
+    // If two calls return the same value, remeshing would produce the same mesh.
+    uint64_t meshInputVersion() const;
+    void setLOD(int lod);
+    int lod() const;
+};
@@ -24,6 +24,22 @@ const static std::unordered_set<unsigned char> redstoneBlocks {
     REDSTONE_LAMP_ON, REDSTONE_LAMP_OFF
 };
 
+// True for blocks that fill their whole cell and hide everything behind them.
+// Water, lava and the thin "cross" blocks (torches, levers, flowers, cactus)
+// can all be seen through.
+inline bool occludesView(BlockType b) {
+    switch (b) {
+    case EMPTY: case WATER: case LAVA:
+    case REDSTONE_TORCH_ON: case REDSTONE_TORCH_OFF:
+    case REDSTONE_LEVER_ON: case REDSTONE_LEVER_OFF:
+    case SPRUCE_SAPLING: case ROSE: case DAF: case REDSHROOM: case SHROOM: case DRY_SPRIG:
+    case CACTUS:
+        return false;
+    default:
+        return true;
+    }
+}
+
 // The six cardinal directions in 3D space
 enum Direction : unsigned char
 {
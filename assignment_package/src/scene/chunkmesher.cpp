@@ -0,0 +1,418 @@
+#include "chunkmesher.h"
+#include <algorithm>
+
+size_t ChunkMeshData::byteSize() const {
+    return (vboDataOpaque.size() + vboDataTransparent.size()) * sizeof(float) +
+           (idxDataOpaque.size() + idxDataTransparent.size()) * sizeof(unsigned int) +
+           decorations.size() * sizeof(DecorationInstance);
+}
+
+static bool crossesBorder(glm::ivec3 pos, glm::ivec3 dir) {
+    return pos.x + dir.x < 0 || pos.x + dir.x >= 16 || pos.z + dir.z < 0 || pos.z + dir.z >= 16;
+}
+
+// Positions are relative to the chunk's corner; lambert.vert adds u_ChunkOrigin back
+static void appendVBOData(std::vector<float> &vboData, std::vector<unsigned int> &idxData,
+                   const BlockFace &f, BlockType curr, glm::ivec3 xyz,
+                   unsigned int &maxIdx, int scale = 1) {
+    int x = xyz.x;
+    int y = xyz.y;
+    int z = xyz.z;
+
+    const std::array<VertexData, 4> &vertData = f.vertices;
+    const std::array<glm::vec2, 4> offset =  {glm::vec2{0.f, 0.f}, glm::vec2{1.f, 0.f}, glm::vec2{1.f, 1.f}, glm::vec2{0.f, 1.f}};
+
+    int i = 0;
+    for (const VertexData &vd : vertData){
+        // position
+        vboData.push_back(x + vd.pos.x * scale);
+        vboData.push_back(y + vd.pos.y * scale);
+        vboData.push_back(z + vd.pos.z * scale);
+        vboData.push_back(vd.pos.w);
+        // normal
+        vboData.push_back(f.directionVec.x);
+        vboData.push_back(f.directionVec.y);
+        vboData.push_back(f.directionVec.z);
+        vboData.push_back(0.f);
+        // milestone 2 -- testing
+        switch(curr) {
+        case GRASS:
+            if (f.directionVec.y == 1) {
+               //Top face:
+                vboData.push_back((8.f + offset[i].x)/16.f);
+                vboData.push_back((13.f + offset[i].y)/16.f);
+            } else if (f.directionVec.y == -1){
+               //Bottom:
+                vboData.push_back((2.f + offset[i].x)/16.f);
+                vboData.push_back((15.f + offset[i].y)/16.f);
+            } else {
+                //Side:
+                vboData.push_back((3.f+ offset[i].x)/16.f);
+                vboData.push_back((15.f+ offset[i].y)/16.f);
+            }
+            vboData.push_back(0.0f);
+            break;
+        case DIRT:
+            vboData.push_back((2.f + offset[i].x)/16.f);
+            vboData.push_back((15.f + offset[i].y)/16.f);
+            vboData.push_back(0.0f);
+            break;
+        case STONE:
+            vboData.push_back((1.f + offset[i].x)/16.f);
+            vboData.push_back((15.f + offset[i].y)/16.f);
+            vboData.push_back(0.0f);
+            break;
+        case WATER:
+            vboData.push_back((13.f + offset[i].x)/16.f);
+            vboData.push_back((3.f + offset[i].y)/16.f);
+            vboData.push_back(1.0f);
+            break;
+        case LAVA:
+            vboData.push_back((13.f + offset[i].x)/16.f);
+            vboData.push_back((1.f + offset[i].y)/16.f);
+            vboData.push_back(1.0f);
+            break;
+        case BEDROCK:
+            vboData.push_back((1.f + offset[i].x)/16.f);
+            vboData.push_back((14.f + offset[i].y)/16.f);
+            vboData.push_back(0.0f);
+            break;
+        case SNOW:
+            vboData.push_back((2.f + offset[i].x)/16.f);
+            vboData.push_back((11.f + offset[i].y)/16.f);
+            vboData.push_back(0.0f);
+            break;
+        // redstone block types
+        case REDSTONE_TORCH_ON:
+            vboData.push_back((3.f + offset[i].x)/16.f);
+            vboData.push_back((9.f + offset[i].y)/16.f);
+            vboData.push_back(0.0f);
+            break;
+        case REDSTONE_TORCH_OFF:
+            vboData.push_back((3.f + offset[i].x)/16.f);
+            vboData.push_back((8.f + offset[i].y)/16.f);
+            vboData.push_back(0.0f);
+            break;
+        case REDSTONE_LEVER_ON:
+        case REDSTONE_LEVER_OFF:
+            vboData.push_back((0.f + offset[i].x) / 16.f);
+            vboData.push_back((9.f + offset[i].y) / 16.f);
+            vboData.push_back(0.f);
+            break;
+        case REDSTONE_LAMP_ON:
+            vboData.push_back((4.f + offset[i].x) / 16.f);
+            vboData.push_back((2.f + offset[i].y) / 16.f);
+            vboData.push_back(0.f);
+            break;
+        case REDSTONE_LAMP_OFF:
+            vboData.push_back((3.f + offset[i].x) / 16.f);
+            vboData.push_back((2.f + offset[i].y) / 16.f);
+            vboData.push_back(0.f);
+            break;
+        case REDSTONE_WIRE_ON:
+            vboData.push_back((1.f + offset[i].x) / 16.f);
+            vboData.push_back((7.f + offset[i].y) / 16.f);
+            vboData.push_back(0.f);
+            break;
+        case REDSTONE_WIRE_OFF:
+            vboData.push_back((1.f + offset[i].x) / 16.f);
+            vboData.push_back((1.f + offset[i].y) / 16.f);
+            vboData.push_back(0.f);
+            break;
+        case SPRUCE_SAPLING:
+            vboData.push_back((15.f + offset[i].x) / 16.f);
+            vboData.push_back((12.f + offset[i].y) / 16.f);
+            vboData.push_back(0.f);
+            break;
+        case ROSE:
+            vboData.push_back((12.f + offset[i].x) / 16.f);
+            vboData.push_back((15.f + offset[i].y) / 16.f);
+            vboData.push_back(0.f);
+            break;
+        case DAF:
+            vboData.push_back((13.f + offset[i].x) / 16.f);
+            vboData.push_back((15.f + offset[i].y) / 16.f);
+            vboData.push_back(0.f);
+            break;
+        case REDSHROOM:
+            vboData.push_back((12.f + offset[i].x) / 16.f);
+            vboData.push_back((14.f + offset[i].y) / 16.f);
+            vboData.push_back(0.f);
+            break;
+        case SHROOM:
+            vboData.push_back((13.f + offset[i].x) / 16.f);
+            vboData.push_back((14.f + offset[i].y) / 16.f);
+            vboData.push_back(0.f);
+            break;
+        case DRY_SPRIG:
+            vboData.push_back((7.f + offset[i].x) / 16.f);
+            vboData.push_back((12.f + offset[i].y) / 16.f);
+            vboData.push_back(0.f);
+            break;
+        case CACTUS:
+            if (f.directionVec.y == 1 || f.directionVec.y == -1) {
+                vboData.push_back((5.f + offset[i].x)/16.f);
+                vboData.push_back((11.f + offset[i].y)/16.f);
+            } else {
+                vboData.push_back((6.f+ offset[i].x)/16.f);
+                vboData.push_back((11.f+ offset[i].y)/16.f);
+            }
+            vboData.push_back(0.0f);
+            break;
+        default:
+            // Other block types are not yet handled, so we default to debug purple
+            vboData.push_back(7.f/16.f);
+            vboData.push_back(1.f/16.f);
+            vboData.push_back(0.0f);
+            break;
+        }
+        i++;
+    }
+
+    // Two triangles per face, over the four vertices just pushed
+    idxData.push_back(0 + maxIdx);
+    idxData.push_back(1 + maxIdx);
+    idxData.push_back(2 + maxIdx);
+    idxData.push_back(0 + maxIdx);
+    idxData.push_back(2 + maxIdx);
+    idxData.push_back(3 + maxIdx);
+    maxIdx += 4;
+}
+
+inline bool isTransparent(BlockType b) {
+    return b == WATER || b == LAVA;
+}
+
+inline bool drawAnyways(BlockType b) {
+    return isDecoration(b) || b == CACTUS;
+}
+
+void ChunkMesher::build(const ChunkData *c, ChunkMeshData *chunkData) {
+    // Read before any blocks so that edits made while meshing make this mesh stale
+    chunkData->meshVersion = c->meshInputVersion();
+    chunkData->lod = c->lod();
+    if (chunkData->lod > 0) {
+        buildLOD(c, chunkData, chunkData->lod);
+    } else {
+        buildFull(c, chunkData);
+    }
+
+    // Every face is four vertices of 11 floats, starting with the position
+    const std::vector<float> &vbo = chunkData->vboDataTransparent;
+    chunkData->quadCentersTransparent.resize(vbo.size() / 44);
+    for (size_t q = 0; q < chunkData->quadCentersTransparent.size(); q++) {
+        glm::vec3 sum(0.f);
+        for (int v = 0; v < 4; v++) {
+            const float *p = &vbo[(4 * q + v) * 11];
+            sum += glm::vec3(p[0], p[1], p[2]);
+        }
+        chunkData->quadCentersTransparent[q] = sum / 4.f;
+    }
+    sortTransparentIndices(chunkData->quadCentersTransparent, chunkData->sectionIdxTransparent,
+                           chunkData->sortEye - glm::vec3(c->getCoords().x, 0.f, c->getCoords().y),
+                           &chunkData->idxDataTransparent);
+    chunkData->trackedBytes.set(chunkData->byteSize() + chunkData->quadCentersTransparent.size() * sizeof(glm::vec3));
+}
+
+void ChunkMesher::buildFull(const ChunkData *c, ChunkMeshData *chunkData) {
+    unsigned int maxIdxOpq = 0;
+    unsigned int maxIdxTra = 0;
+    std::array<std::vector<DecorationInstance>, DECORATION_SHAPE_COUNT> decorations;
+    // Y is the outer loop so that each section's faces end up
+    // contiguous in the index buffers and can be drawn on their own.
+    for (int y = 0; y < 256; y++) {
+        if (y % SECTION_SIZE == 0) {
+            int section = y / SECTION_SIZE;
+            chunkData->sectionIdxOpaque[section] = chunkData->idxDataOpaque.size();
+            chunkData->sectionIdxTransparent[section] = chunkData->idxDataTransparent.size();
+            chunkData->sectionVisibility[section] = SectionVisibility::compute(c->blocks(), section);
+        }
+        for (int x = 0; x < 16; x++) {
+            for (int z = 0; z < 16; z++) {
+                BlockType curr = c->getBlockAt(x, y, z);
+
+                if (isDecoration(curr)) {
+
+                    // Drawn as instances of a shared mesh, see Terrain::draw
+                    decorations[static_cast<int>(decorationShapeOf(curr))].push_back(DecorationInstance(glm::ivec3(x, y, z), curr));
+
+                } else if (curr == CACTUS) {
+
+                    for (const BlockFace &f : cactusFaces) {
+                        appendVBOData(chunkData->vboDataTransparent, chunkData->idxDataTransparent, f, curr, glm::ivec3(x,y,z), maxIdxTra);
+                    }
+
+                } else if (curr != EMPTY) {
+
+                    for (const BlockFace &f : adjacentFaces) {
+                        BlockType adj;
+                        if (crossesBorder(glm::ivec3(x, y, z), glm::ivec3(f.directionVec))) {
+                            const ChunkData *neighbor = c->neighbor(f.direction);
+                            if (neighbor == nullptr) {
+                                adj = EMPTY;
+                            } else {
+                                int dx = (x + (int) f.directionVec.x) % 16;
+                                if (dx < 0) dx += 16;
+                                int dy = (y + (int) f.directionVec.y) % 256;
+                                if (dy < 0) dy += 256;
+                                int dz = (z + (int) f.directionVec.z) % 16;
+                                if (dz < 0) dz += 16;
+                                adj = neighbor->getBlockAt(dx, dy, dz);
+                            }
+                        } else {
+                            adj = c->getBlockAt(
+                                        x + (int) f.directionVec.x,
+                                        y + (int) f.directionVec.y,
+                                        z + (int) f.directionVec.z
+                                    );
+                        }
+
+                        if (isTransparent(curr) && adj == EMPTY) {
+                            appendVBOData(chunkData->vboDataTransparent, chunkData->idxDataTransparent, f, curr, glm::ivec3(x,y,z), maxIdxTra);
+                        } else if (adj == EMPTY || ((isTransparent(adj) || drawAnyways(adj)) && !isTransparent(curr))) {
+                            appendVBOData(chunkData->vboDataOpaque, chunkData->idxDataOpaque, f, curr, glm::ivec3(x,y,z), maxIdxOpq);
+                        }
+                    }
+
+                }
+            }
+        }
+    }
+
+    chunkData->sectionIdxOpaque[SECTIONS_PER_CHUNK] = chunkData->idxDataOpaque.size();
+    chunkData->sectionIdxTransparent[SECTIONS_PER_CHUNK] = chunkData->idxDataTransparent.size();
+
+    for (int s = 0; s < DECORATION_SHAPE_COUNT; s++) {
+        chunkData->decorationOffsets[s] = chunkData->decorations.size();
+        chunkData->decorations.insert(chunkData->decorations.end(), decorations[s].begin(), decorations[s].end());
+    }
+    chunkData->decorationOffsets[DECORATION_SHAPE_COUNT] = chunkData->decorations.size();
+}
+
+BlockType ChunkMesher::getLODCellAt(const ChunkData *chunk, int x, int y, int z, int lod) {
+    int size = 1 << lod;
+    int filled = 0;
+    BlockType top = EMPTY;
+    for (int by = y * size; by < (y + 1) * size; by++) {
+        for (int bx = x * size; bx < (x + 1) * size; bx++) {
+            for (int bz = z * size; bz < (z + 1) * size; bz++) {
+                BlockType b = chunk->blocks()[bx + 16 * by + 16 * 256 * bz];
+                // Torches, flowers and the like are far too small to show up
+                if (b != EMPTY && !drawAnyways(b)) {
+                    filled++;
+                    top = b;
+                }
+            }
+        }
+    }
+    return 2 * filled >= size * size * size ? top : EMPTY;
+}
+
+void ChunkMesher::buildLOD(const ChunkData *c, ChunkMeshData *chunkData, int lod) {
+    unsigned int maxIdxOpq = 0;
+    unsigned int maxIdxTra = 0;
+    const int size = 1 << lod;
+    const int cellsXZ = 16 / size;
+    const int cellsY = 256 / size;
+    const int cellsPerSection = SECTION_SIZE / size;
+
+    // Downsample once up front; every cell is looked at up to seven times
+    std::vector<BlockType> cells(cellsXZ * cellsY * cellsXZ);
+    auto cellIdx = [=](int x, int y, int z) { return x + cellsXZ * y + cellsXZ * cellsY * z; };
+    for (int x = 0; x < cellsXZ; x++) {
+        for (int y = 0; y < cellsY; y++) {
+            for (int z = 0; z < cellsXZ; z++) {
+                cells[cellIdx(x, y, z)] = getLODCellAt(c, x, y, z, lod);
+            }
+        }
+    }
+    // The highest filled cell of each column, for placing skirts
+    std::vector<int> columnTop(cellsXZ * cellsXZ, -1);
+    for (int x = 0; x < cellsXZ; x++) {
+        for (int z = 0; z < cellsXZ; z++) {
+            for (int y = cellsY - 1; y >= 0; y--) {
+                if (cells[cellIdx(x, y, z)] != EMPTY) {
+                    columnTop[x + cellsXZ * z] = y;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (int y = 0; y < cellsY; y++) {
+        if (y % cellsPerSection == 0) {
+            int section = y / cellsPerSection;
+            chunkData->sectionIdxOpaque[section] = chunkData->idxDataOpaque.size();
+            chunkData->sectionIdxTransparent[section] = chunkData->idxDataTransparent.size();
+            chunkData->sectionVisibility[section] = SectionVisibility::compute(c->blocks(), section);
+        }
+        for (int x = 0; x < cellsXZ; x++) {
+            for (int z = 0; z < cellsXZ; z++) {
+                BlockType curr = cells[cellIdx(x, y, z)];
+                if (curr == EMPTY) {
+                    continue;
+                }
+                glm::ivec3 blockPos = glm::ivec3(x, y, z) * size;
+                for (const BlockFace &f : adjacentFaces) {
+                    glm::ivec3 n = glm::ivec3(x, y, z) + glm::ivec3(f.directionVec);
+                    BlockType adj;
+                    bool skirt = false;
+                    if (n.y < 0 || n.y >= cellsY) {
+                        adj = EMPTY;
+                    } else if (n.x < 0 || n.x >= cellsXZ || n.z < 0 || n.z >= cellsXZ) {
+                        const ChunkData *neighbor = c->neighbor(f.direction);
+                        adj = neighbor == nullptr ? EMPTY
+                                                  : getLODCellAt(neighbor, (n.x + cellsXZ) % cellsXZ, n.y,
+                                                                                 (n.z + cellsXZ) % cellsXZ, lod);
+                        // The neighbor may be meshed at another LOD, whose
+                        // surface won't line up with ours. Hanging the top
+                        // few cells' border faces down as a skirt covers
+                        // the gap whichever side is higher.
+                        skirt = y > columnTop[x + cellsXZ * z] - CHUNK_LOD_SKIRT_CELLS;
+                    } else {
+                        adj = cells[cellIdx(n.x, n.y, n.z)];
+                    }
+
+                    if (isTransparent(curr) && adj == EMPTY) {
+                        appendVBOData(chunkData->vboDataTransparent, chunkData->idxDataTransparent, f, curr, blockPos, maxIdxTra, size);
+                    } else if (!isTransparent(curr) && (adj == EMPTY || isTransparent(adj) || skirt)) {
+                        appendVBOData(chunkData->vboDataOpaque, chunkData->idxDataOpaque, f, curr, blockPos, maxIdxOpq, size);
+                    }
+                }
+            }
+        }
+    }
+
+    chunkData->sectionIdxOpaque[SECTIONS_PER_CHUNK] = chunkData->idxDataOpaque.size();
+    chunkData->sectionIdxTransparent[SECTIONS_PER_CHUNK] = chunkData->idxDataTransparent.size();
+}
+
+
+void ChunkMesher::sortTransparentIndices(const std::vector<glm::vec3> &quadCenters,
+                                         const std::array<unsigned int, SECTIONS_PER_CHUNK + 1> &sectionIdx,
+                                         const glm::vec3 &eye, std::vector<unsigned int> *idxData) {
+    idxData->resize(quadCenters.size() * 6);
+    std::vector<std::pair<float, unsigned int>> order;
+    for (int s = 0; s < SECTIONS_PER_CHUNK; s++) {
+        // Section offsets count indices, six to a face
+        unsigned int first = sectionIdx[s] / 6, last = sectionIdx[s + 1] / 6;
+        order.clear();
+        for (unsigned int q = first; q < last; q++) {
+            glm::vec3 d = quadCenters[q] - eye;
+            order.push_back({glm::dot(d, d), q});
+        }
+        std::sort(order.begin(), order.end(), [](const std::pair<float, unsigned int> &a, const std::pair<float, unsigned int> &b) {
+            return a.first > b.first;
+        });
+        unsigned int *out = idxData->data() + sectionIdx[s];
+        for (const auto &entry : order) {
+            unsigned int v = entry.second * 4;
+            *out++ = v;
+            *out++ = v + 1;
+            *out++ = v + 2;
+            *out++ = v;
+            *out++ = v + 2;
+            *out++ = v + 3;
+        }
+    }
+}
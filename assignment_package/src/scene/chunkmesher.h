@@ -0,0 +1,72 @@
+#pragma once
+#include "chunkdata.h"
+#include "sectionvisibility.h"
+#include "decorations.h"
+#include <array>
+#include <vector>
+
+// Level 0 is the full-resolution mesh; level n merges 2^n x 2^n x 2^n
+// blocks into one cell
+#define CHUNK_LOD_LEVELS 4
+// How many cells below the surface the border skirts of a LOD mesh reach
+#define CHUNK_LOD_SKIRT_CELLS 2
+
+// The mesh of one chunk as it will be uploaded: interleaved vertices of
+// position, normal and UV (with z flagging animated liquid), 11 floats
+// each, and the indices of their triangles
+struct ChunkMeshData {
+    std::vector<float> vboDataOpaque, vboDataTransparent;
+    std::vector<unsigned int> idxDataOpaque, idxDataTransparent;
+    // Where each section's indices begin in the index buffers;
+    // the last entry is the total index count.
+    std::array<unsigned int, SECTIONS_PER_CHUNK + 1> sectionIdxOpaque, sectionIdxTransparent;
+    std::array<SectionVisibility, SECTIONS_PER_CHUNK> sectionVisibility;
+    // ChunkData::meshInputVersion() at the moment meshing started
+    uint64_t meshVersion;
+    // Level of detail the mesh was built at
+    int lod;
+    // Chunk-space center of every transparent face, in vertex buffer order
+    std::vector<glm::vec3> quadCentersTransparent;
+    // World-space point idxDataTransparent is sorted back to front from
+    glm::vec3 sortEye;
+    // Torches, levers and plants, grouped by shape. Where each shape's
+    // instances begin; the last entry is the total instance count.
+    std::vector<DecorationInstance> decorations;
+    std::array<unsigned int, DECORATION_SHAPE_COUNT + 1> decorationOffsets;
+    // byteSize() plus the face centers, once built
+    TrackedBytes trackedBytes;
+
+    ChunkMeshData(const glm::vec3 &sortEye = glm::vec3())
+        : vboDataOpaque{}, vboDataTransparent{}, idxDataOpaque{}, idxDataTransparent{},
+          sectionIdxOpaque{}, sectionIdxTransparent{}, sectionVisibility{}, meshVersion(0), lod(0),
+          quadCentersTransparent{}, sortEye(sortEye), decorations{}, decorationOffsets{},
+          trackedBytes(MEM_MESH_CPU)
+    {}
+
+    // Bytes this data will occupy once uploaded to the GPU
+    size_t byteSize() const;
+};
+
+// Turns a chunk's blocks into mesh data. Only reads blocks, so it is safe
+// to call from any thread and needs no OpenGL context.
+class ChunkMesher {
+private:
+    // The block that stands for the 2^lod sized cell at cell coordinates
+    // (x, y, z): EMPTY unless at least half of the cell is filled, otherwise
+    // the topmost block in the cell so that surfaces keep their material
+    static BlockType getLODCellAt(const ChunkData *chunk, int x, int y, int z, int lod);
+    static void buildLOD(const ChunkData *chunk, ChunkMeshData *data, int lod);
+    static void buildFull(const ChunkData *chunk, ChunkMeshData *data);
+
+public:
+    // Meshes the chunk at its current level of detail, with the transparent
+    // faces sorted for data->sortEye
+    static void build(const ChunkData *chunk, ChunkMeshData *data);
+
+    // Writes the transparent index buffer with the faces of each section
+    // ordered from farthest to nearest to eye, which is in chunk space.
+    // Sections keep their ranges so they can still be culled separately.
+    static void sortTransparentIndices(const std::vector<glm::vec3> &quadCenters,
+                                       const std::array<unsigned int, SECTIONS_PER_CHUNK + 1> &sectionIdx,
+                                       const glm::vec3 &eye, std::vector<unsigned int> *idxData);
+};
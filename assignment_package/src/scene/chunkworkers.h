@@ -1,49 +1,17 @@
 #pragma once
 
 #include "scene/chunk.h"
+#include "scene/terraingen.h"
 #include "QtCore/QMutex"
 #include "QtCore/QRunnable"
 
-int getGrasslandHeight(int x, int z);
-
-int getMountainHeight(int x, int z);
-
-int getSandHeight(int x, int z);
-
-float perlinNoise(glm::vec2 uv);
-
-float surflet(glm::vec2 p, glm::vec2 gridPoint);
-
-float worleyNoise(glm::vec2 uv);
-
-float interpolate(float a);
-
-float randomNoise(int a);
-
-float remap(float a, float b, float c, float d, float e);
-
-void fillBlock(Chunk *c, int x, int z);
-
-float smoothstep(float a, float b, float t);
-
-//lerp function
-
-float lerp(float a, float b, float t);
-
-//standard perlinNoise function
-
-float PerlinNoise(glm::vec2 uv);
-
-//2D perlin noise
-
-float perlin_noise_2d(float x, float y);
-
 class FBMWorker : public QRunnable {
 private:
     int x, z;
     std::vector<Chunk*> chunks;
     std::unordered_set<Chunk*> &chunksWithBlockData;
     QMutex &chunksWithBlockDataMutex;
+    uint64_t job, queuedAt; // For the Tracer
 
 public:
     FBMWorker(int x, int z,
@@ -57,11 +25,36 @@ public:
 class VBOWorker : public QRunnable {
 private:
     Chunk *chunk;
+    // Where the camera was when the worker was spawned, for the initial
+    // transparency sort
+    glm::vec3 sortEye;
     std::vector<ChunkVBOData> *chunksWithVBOs;
     QMutex *chunksWithVBOsMutex;
+    uint64_t job, queuedAt;
+
+public:
+    VBOWorker(Chunk *chunk, const glm::vec3 &sortEye, std::vector<ChunkVBOData> *chunksWithVBOs, QMutex *chunksWithVBOsMutex);
+
+    void run() override;
+};
+
+// Re-sorts the transparent faces of an uploaded chunk mesh for a new camera
+// position. Works from its own copy of the face centers, so the chunk can
+// be remeshed or evicted meanwhile.
+class TransparencySortWorker : public QRunnable {
+private:
+    Chunk *chunk;
+    std::vector<glm::vec3> quadCenters;
+    std::array<unsigned int, SECTIONS_PER_CHUNK + 1> sectionIdx;
+    glm::vec3 eye;
+    uint32_t meshUpload;
+    std::vector<ChunkSortData> *chunksWithSorts;
+    QMutex *chunksWithSortsMutex;
+    uint64_t job, queuedAt;
 
 public:
-    VBOWorker(Chunk *chunk, std::vector<ChunkVBOData> *chunksWithVBOs, QMutex *chunksWithVBOsMutex);
+    TransparencySortWorker(Chunk *chunk, const glm::vec3 &eye,
+                           std::vector<ChunkSortData> *chunksWithSorts, QMutex *chunksWithSortsMutex);
 
     void run() override;
 };
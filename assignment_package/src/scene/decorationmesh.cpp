@@ -0,0 +1,33 @@
+#include "decorationmesh.h"
+
+DecorationMesh::DecorationMesh(OpenGLContext *context, DecorationShape shape)
+    : InstancedDrawable(context), m_shape(shape)
+{}
+
+void DecorationMesh::createVBOdata() {
+    // Levers are built switched off; the shader moves the ones that are on
+    const std::array<BlockFace, 4> &faces = m_shape == DecorationShape::TORCH ? torchFaces :
+                                            m_shape == DecorationShape::LEVER ? leverOffFaces : flowerFaces;
+
+    // Same layout as chunk vertices, with UVs relative to the block's atlas cell
+    std::vector<float> vboData;
+    std::vector<GLuint> idxData;
+    for (const BlockFace &f : faces) {
+        GLuint first = vboData.size() / 11;
+        for (const VertexData &vd : f.vertices) {
+            vboData.insert(vboData.end(), {vd.pos.x, vd.pos.y, vd.pos.z, vd.pos.w,
+                                           f.directionVec.x, f.directionVec.y, f.directionVec.z, 0.f,
+                                           vd.uv.x, vd.uv.y, 0.f});
+        }
+        idxData.insert(idxData.end(), {first, first + 1, first + 2, first, first + 2, first + 3});
+    }
+
+    m_count = idxData.size();
+
+    generateIdx();
+    mp_context->bufferIndicesTracked(m_bufIdx, idxData.size() * sizeof(GLuint), idxData.data(), GL_STATIC_DRAW);
+
+    generateInterleaved();
+    mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufInterleaved);
+    mp_context->bufferDataTracked(GL_ARRAY_BUFFER, m_bufInterleaved, vboData.size() * sizeof(float), vboData.data(), GL_STATIC_DRAW);
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "drawable.h"
+#include "decorations.h"
+
+// One decoration shape's quads, shared by every chunk. Chunks own the
+// instance buffers that say where to draw it.
+class DecorationMesh : public InstancedDrawable {
+private:
+    DecorationShape m_shape;
+
+public:
+    DecorationMesh(OpenGLContext *context, DecorationShape shape);
+    void createVBOdata() override;
+    // Instances come from the chunks' buffers instead
+    void createInstancedVBOdata(std::vector<glm::vec3>&, std::vector<glm::vec3>&) override {}
+};
@@ -0,0 +1,44 @@
+#include "decorations.h"
+
+bool isDecoration(BlockType b) {
+    switch (b) {
+    case REDSTONE_TORCH_ON: case REDSTONE_TORCH_OFF:
+    case REDSTONE_LEVER_ON: case REDSTONE_LEVER_OFF:
+    case SPRUCE_SAPLING: case ROSE: case DAF: case REDSHROOM: case SHROOM: case DRY_SPRIG:
+        return true;
+    default:
+        return false;
+    }
+}
+
+DecorationShape decorationShapeOf(BlockType b) {
+    switch (b) {
+    case REDSTONE_TORCH_ON: case REDSTONE_TORCH_OFF:
+        return DecorationShape::TORCH;
+    case REDSTONE_LEVER_ON: case REDSTONE_LEVER_OFF:
+        return DecorationShape::LEVER;
+    default:
+        return DecorationShape::CROSS;
+    }
+}
+
+DecorationInstance::DecorationInstance(glm::ivec3 pos, BlockType type)
+    : pos(pos), type(type), state(type == REDSTONE_TORCH_ON || type == REDSTONE_LEVER_ON ? 1.f : 0.f)
+{}
+
+std::array<glm::vec4, DECORATION_TYPE_TABLE_SIZE> decorationTypeTable() {
+    std::array<glm::vec4, DECORATION_TYPE_TABLE_SIZE> table;
+    // Debug purple, like appendVBOData uses for unknown blocks
+    table.fill(glm::vec4(7.f, 1.f, 0.f, 0.f));
+    table[REDSTONE_TORCH_ON] = glm::vec4(3.f, 9.f, 0.f, 0.f);
+    table[REDSTONE_TORCH_OFF] = glm::vec4(3.f, 8.f, 0.f, 0.f);
+    table[REDSTONE_LEVER_ON] = glm::vec4(0.f, 9.f, DECORATION_LEVER_THROW, 0.f);
+    table[REDSTONE_LEVER_OFF] = glm::vec4(0.f, 9.f, DECORATION_LEVER_THROW, 0.f);
+    table[SPRUCE_SAPLING] = glm::vec4(15.f, 12.f, 0.f, 0.f);
+    table[ROSE] = glm::vec4(12.f, 15.f, 0.f, 0.f);
+    table[DAF] = glm::vec4(13.f, 15.f, 0.f, 0.f);
+    table[REDSHROOM] = glm::vec4(12.f, 14.f, 0.f, 0.f);
+    table[SHROOM] = glm::vec4(13.f, 14.f, 0.f, 0.f);
+    table[DRY_SPRIG] = glm::vec4(7.f, 12.f, 0.f, 0.f);
+    return table;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "chunkhelpers.h"
+#include <array>
+#include <vector>
+
+// Entries in decoration.vert.glsl's per-block-type table; covers every BlockType
+#define DECORATION_TYPE_TABLE_SIZE 32
+// How far along x a lever's handle moves when it is switched on
+#define DECORATION_LEVER_THROW 0.875f
+
+// The meshes that torches, levers and plants are drawn as. Each is a few
+// quads around one block, drawn once per block with instanced rendering.
+enum class DecorationShape : unsigned char {
+    CROSS, TORCH, LEVER
+};
+#define DECORATION_SHAPE_COUNT 3
+
+// True for the blocks drawn as decorations rather than as part of a chunk mesh
+bool isDecoration(BlockType b);
+DecorationShape decorationShapeOf(BlockType b);
+
+// One decoration in a chunk's instance buffer
+struct DecorationInstance {
+    glm::vec3 pos;  // The block's corner, in chunk space
+    float type;     // BlockType, which picks the texture
+    float state;    // 1 for torches and levers that are switched on
+
+    DecorationInstance(glm::ivec3 pos, BlockType type);
+};
+
+// For each BlockType: texture atlas cell in x and y, then how far the mesh
+// moves along x when the block is switched on. Uploaded as u_DecorationTypes.
+std::array<glm::vec4, DECORATION_TYPE_TABLE_SIZE> decorationTypeTable();
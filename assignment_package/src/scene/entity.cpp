@@ -86,3 +86,10 @@ void Entity::rotateOnUpGlobal(float degrees) {
     m_right = glm::vec3(glm::rotate(glm::mat4(), rad, glm::vec3(0,1,0)) * glm::vec4(m_right, 0.f));
     m_up = glm::vec3(glm::rotate(glm::mat4(), rad, glm::vec3(0,1,0)) * glm::vec4(m_up, 0.f));
 }
+
+void Entity::setPose(glm::vec3 pos, glm::vec3 forward) {
+    m_position = pos;
+    m_forward = glm::normalize(forward);
+    m_right = glm::normalize(glm::cross(m_forward, glm::vec3(0,1,0)));
+    m_up = glm::cross(m_right, m_forward);
+}
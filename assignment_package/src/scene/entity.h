@@ -57,4 +57,8 @@ public:
     virtual void rotateOnForwardGlobal(float degrees);
     virtual void rotateOnRightGlobal(float degrees);
     virtual void rotateOnUpGlobal(float degrees);
+
+    // Moves to pos and faces along forward, keeping the world's up axis
+    // upright. forward must not be vertical.
+    virtual void setPose(glm::vec3 pos, glm::vec3 forward);
 };
@@ -0,0 +1,300 @@
+#include "entitysystem.h"
+#include "tracer.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+
+// Batches of one runBatches() call. Held by every worker, as a worker may
+// only get going after the call has returned, and then finds nothing left.
+struct EntityBatches {
+    std::function<void(int, int)> fn;
+    int count, batches;
+    std::atomic<int> next; // The next batch nobody has claimed
+    QSemaphore done; // Released once per finished batch
+
+    EntityBatches(const std::function<void(int, int)> &fn, int count)
+        : fn(fn), count(count), batches((count + ENTITY_BATCH_SIZE - 1) / ENTITY_BATCH_SIZE), next(0), done(0)
+    {}
+};
+
+// Claims batches until there are none left
+static void runClaimedBatches(EntityBatches *work) {
+    for (int b = work->next++; b < work->batches; b = work->next++) {
+        TraceScope scope("entity batch");
+        int first = b * ENTITY_BATCH_SIZE;
+        work->fn(first, std::min(work->count, first + ENTITY_BATCH_SIZE));
+        work->done.release();
+    }
+}
+
+class EntityBatchWorker : public QRunnable {
+private:
+    std::shared_ptr<EntityBatches> work;
+
+public:
+    EntityBatchWorker(const std::shared_ptr<EntityBatches> &work)
+        : work(work)
+    {}
+
+    void run() override {
+        runClaimedBatches(work.get());
+    }
+};
+
+// xorshift32; state must not be zero
+static float nextRandom(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (x >> 8) / 16777216.f;
+}
+
+EntitySystem::EntitySystem()
+    : m_ids(), m_kinds(), m_positions(), m_nextPositions(), m_velocities(), m_sizes(),
+      m_timers(), m_rngs(), m_flags(), m_slots(), m_freeIds(),
+      m_grid(ENTITY_GRID_CELL), m_gridStale(false), m_parallel(true), m_trackedBytes(MEM_ENTITIES)
+{}
+
+glm::vec2 EntitySystem::sizeOf(EntityKind kind) {
+    switch (kind) {
+    case ENTITY_MOB: return glm::vec2(0.6f, 1.8f);
+    case ENTITY_ITEM: return glm::vec2(0.25f, 0.25f);
+    default: return glm::vec2(0.1f, 0.1f);
+    }
+}
+
+float EntitySystem::stepHeightOf(EntityKind kind) {
+    return kind == ENTITY_MOB ? 0.5f : 0.f;
+}
+
+EntityId EntitySystem::spawn(EntityKind kind, glm::vec3 pos, glm::vec3 velocity) {
+    EntityId id;
+    if (m_freeIds.empty()) {
+        id = static_cast<EntityId>(m_slots.size());
+        m_slots.push_back(-1);
+    } else {
+        id = m_freeIds.back();
+        m_freeIds.pop_back();
+    }
+    m_slots[id] = static_cast<int>(m_ids.size());
+    m_ids.push_back(id);
+    m_kinds.push_back(kind);
+    m_positions.push_back(pos);
+    m_nextPositions.push_back(pos);
+    m_velocities.push_back(velocity);
+    m_sizes.push_back(sizeOf(kind));
+    m_timers.push_back(kind == ENTITY_MOB ? 0.f : kind == ENTITY_ITEM ? ENTITY_ITEM_LIFETIME : ENTITY_PROJECTILE_LIFETIME);
+    // Odd times non-zero, so never zero
+    m_rngs.push_back((id + 1) * 2654435761u);
+    m_flags.push_back(0);
+    m_gridStale = true;
+    updateTrackedBytes();
+    return id;
+}
+
+void EntitySystem::despawn(EntityId id) {
+    if (alive(id)) {
+        removeSlot(m_slots[id]);
+        updateTrackedBytes();
+    }
+}
+
+bool EntitySystem::alive(EntityId id) const {
+    return id < m_slots.size() && m_slots[id] != -1;
+}
+
+size_t EntitySystem::count() const {
+    return m_ids.size();
+}
+
+EntityKind EntitySystem::kind(EntityId id) const {
+    return m_kinds[m_slots[id]];
+}
+
+glm::vec3 EntitySystem::position(EntityId id) const {
+    return m_positions[m_slots[id]];
+}
+
+glm::vec3 EntitySystem::velocity(EntityId id) const {
+    return m_velocities[m_slots[id]];
+}
+
+const std::vector<glm::vec3> &EntitySystem::positions() const {
+    return m_positions;
+}
+
+void EntitySystem::entitiesNear(glm::vec3 center, float radius, std::vector<EntityId> *out_ids) {
+    refreshGrid();
+    out_ids->clear();
+    m_grid.forEachNear(center, radius, [&](int slot) {
+        if (glm::distance(m_positions[slot], center) <= radius) {
+            out_ids->push_back(m_ids[slot]);
+        }
+    });
+}
+
+void EntitySystem::setParallel(bool parallel) {
+    m_parallel = parallel;
+}
+
+void EntitySystem::refreshGrid() {
+    if (m_gridStale) {
+        m_grid.rebuild(m_positions);
+        m_gridStale = false;
+    }
+}
+
+// The last slot moves into the removed one
+void EntitySystem::removeSlot(int slot) {
+    int last = static_cast<int>(m_ids.size()) - 1;
+    m_slots[m_ids[slot]] = -1;
+    m_freeIds.push_back(m_ids[slot]);
+    if (slot != last) {
+        m_ids[slot] = m_ids[last];
+        m_kinds[slot] = m_kinds[last];
+        m_positions[slot] = m_positions[last];
+        m_nextPositions[slot] = m_nextPositions[last];
+        m_velocities[slot] = m_velocities[last];
+        m_sizes[slot] = m_sizes[last];
+        m_timers[slot] = m_timers[last];
+        m_rngs[slot] = m_rngs[last];
+        m_flags[slot] = m_flags[last];
+        m_slots[m_ids[slot]] = slot;
+    }
+    m_ids.pop_back();
+    m_kinds.pop_back();
+    m_positions.pop_back();
+    m_nextPositions.pop_back();
+    m_velocities.pop_back();
+    m_sizes.pop_back();
+    m_timers.pop_back();
+    m_rngs.pop_back();
+    m_flags.pop_back();
+    m_gridStale = true;
+}
+
+void EntitySystem::updateTrackedBytes() {
+    size_t perEntity = sizeof(EntityId) + sizeof(EntityKind) + 3 * sizeof(glm::vec3) + sizeof(glm::vec2) +
+                       sizeof(float) + sizeof(uint32_t) + sizeof(unsigned char);
+    m_trackedBytes.set(m_ids.capacity() * perEntity + m_slots.capacity() * sizeof(int) +
+                       m_freeIds.capacity() * sizeof(EntityId));
+}
+
+glm::vec3 EntitySystem::steer(int slot, float dT) {
+    glm::vec3 &v = m_velocities[slot];
+    unsigned char &flags = m_flags[slot];
+    float &timer = m_timers[slot];
+    timer -= dT;
+    v.y -= ENTITY_GRAVITY * dT;
+
+    switch (m_kinds[slot]) {
+    case ENTITY_MOB: {
+        if (timer <= 0.f) {
+            // Off in a new direction, or a rest now and then
+            float angle = 2.f * glm::pi<float>() * nextRandom(&m_rngs[slot]);
+            float speed = nextRandom(&m_rngs[slot]) < 0.25f ? 0.f : ENTITY_MOB_SPEED;
+            v.x = glm::cos(angle) * speed;
+            v.z = glm::sin(angle) * speed;
+            timer = 2.f + 4.f * nextRandom(&m_rngs[slot]);
+        }
+        // Edged away from mobs standing too close
+        glm::vec3 pos = m_positions[slot];
+        glm::vec2 push(0.f);
+        m_grid.forEachNear(pos, ENTITY_MOB_SPACING, [&](int other) {
+            glm::vec3 d = pos - m_positions[other];
+            float dist = glm::length(glm::vec2(d.x, d.z));
+            if (other == slot || m_kinds[other] != ENTITY_MOB ||
+                dist >= ENTITY_MOB_SPACING || glm::abs(d.y) >= m_sizes[slot].y) {
+                return;
+            }
+            // Two in the same spot split along x, the older one first
+            glm::vec2 away = dist > 1e-4f ? glm::vec2(d.x, d.z) / dist
+                                          : glm::vec2(m_ids[slot] < m_ids[other] ? 1.f : -1.f, 0.f);
+            push += away * (ENTITY_MOB_SPACING - dist);
+        });
+        return v * dT + glm::vec3(push.x, 0.f, push.y) * ENTITY_MOB_SPEED * dT;
+    }
+    case ENTITY_ITEM:
+        if (timer <= 0.f) {
+            flags |= ENTITY_DEAD;
+        }
+        if (flags & ENTITY_GROUNDED) {
+            float friction = glm::max(0.f, 1.f - 8.f * dT);
+            v.x *= friction;
+            v.z *= friction;
+        }
+        return v * dT;
+    default:
+        if (timer <= 0.f) {
+            flags |= ENTITY_DEAD;
+        }
+        if (flags & ENTITY_STUCK) {
+            v = glm::vec3(0.f);
+        }
+        return v * dT;
+    }
+}
+
+void EntitySystem::land(int slot, const SweepResult &result) {
+    glm::vec3 &v = m_velocities[slot];
+    unsigned char &flags = m_flags[slot];
+    m_nextPositions[slot] = m_positions[slot] + result.movement;
+    bool landed = result.blocked.y && v.y <= 0.f;
+    flags = landed ? flags | ENTITY_GROUNDED : flags & ~ENTITY_GROUNDED;
+
+    bool blockedSideways = result.blocked.x || result.blocked.z;
+    if (m_kinds[slot] == ENTITY_PROJECTILE && (blockedSideways || result.blocked.y)) {
+        flags |= ENTITY_STUCK;
+        v = glm::vec3(0.f);
+        return;
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        if (result.blocked[axis]) {
+            v[axis] = 0.f;
+        }
+    }
+    if (m_kinds[slot] == ENTITY_MOB && blockedSideways) {
+        // Over the wall if it's low enough, and a new heading either way
+        if (landed) {
+            v.y = ENTITY_MOB_JUMP_SPEED;
+        }
+        m_timers[slot] = 0.f;
+    }
+}
+
+void EntitySystem::finishTick() {
+    std::swap(m_positions, m_nextPositions);
+    bool removed = false;
+    for (int slot = static_cast<int>(m_ids.size()) - 1; slot >= 0; slot--) {
+        if (m_flags[slot] & ENTITY_DEAD) {
+            removeSlot(slot);
+            removed = true;
+        }
+    }
+    if (removed) {
+        updateTrackedBytes();
+    }
+    m_grid.rebuild(m_positions);
+    m_gridStale = false;
+}
+
+void EntitySystem::runBatches(int count, const std::function<void(int, int)> &fn) {
+    auto work = std::make_shared<EntityBatches>(fn, count);
+    if (m_parallel) {
+        // The pool may be busy generating terrain, so this thread takes
+        // batches too rather than waiting for a worker to come free
+        int helpers = glm::min(work->batches, QThread::idealThreadCount()) - 1;
+        for (int i = 0; i < helpers; i++) {
+            // Ahead of queued terrain work, as the tick is waiting on these
+            QThreadPool::globalInstance()->start(new EntityBatchWorker(work), 1);
+        }
+    }
+    runClaimedBatches(work.get());
+    work->done.acquire(work->batches);
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include "spatialhash.h"
+#include "voxelcollision.h"
+#include <functional>
+#include <vector>
+
+// Entities updated by one job of the parallel stage
+#define ENTITY_BATCH_SIZE 256
+#define ENTITY_GRAVITY 25.f
+#define ENTITY_MOB_SPEED 2.f
+#define ENTITY_MOB_JUMP_SPEED 7.f
+// How close two mobs come before they push each other apart
+#define ENTITY_MOB_SPACING 1.f
+// Width of the columns entities are bucketed by for neighbour lookups.
+// Divides a chunk's, and is near the spacing, so a crowded chunk isn't
+// searched through whole.
+#define ENTITY_GRID_CELL 2
+// Seconds a dropped item, or a projectile, lasts
+#define ENTITY_ITEM_LIFETIME 300.f
+#define ENTITY_PROJECTILE_LIFETIME 60.f
+
+enum EntityKind : unsigned char {
+    ENTITY_MOB,        // Wanders about, steps up ledges and jumps at walls
+    ENTITY_ITEM,       // Falls and slides to a stop
+    ENTITY_PROJECTILE  // Flies until it hits something, then sticks there
+};
+
+enum EntityFlag : unsigned char {
+    ENTITY_GROUNDED = 1,
+    ENTITY_STUCK = 2,  // A projectile that has hit something
+    ENTITY_DEAD = 4    // Removed at the end of the tick
+};
+
+// Names one entity for as long as it lives. Its slot in the arrays below
+// changes whenever another entity is removed.
+typedef uint32_t EntityId;
+
+// Mobs, dropped items and projectiles: everything that moves through the
+// world on its own, apart from the Player. Each component is kept in an
+// array of its own, one slot per entity, rather than in an object per
+// entity, so a tick streams through only the parts it uses. Ticks run in
+// batches on the global thread pool; an entity's update writes only its own
+// slot, and reads the others' positions from before the tick, so the
+// outcome doesn't depend on how the batches fall across threads.
+class EntitySystem {
+private:
+    std::vector<EntityId> m_ids;
+    std::vector<EntityKind> m_kinds;
+    std::vector<glm::vec3> m_positions; // Bottom center of each box
+    std::vector<glm::vec3> m_nextPositions; // Written by tick() while m_positions is read
+    std::vector<glm::vec3> m_velocities;
+    std::vector<glm::vec2> m_sizes; // Width and height of each box
+    // Mobs: seconds until they pick a new heading. The rest: seconds left
+    // to live.
+    std::vector<float> m_timers;
+    std::vector<uint32_t> m_rngs; // Each entity's own random state
+    // EntityFlags. Not vector<bool>, whose elements threads can't write
+    // apart from each other.
+    std::vector<unsigned char> m_flags;
+
+    std::vector<int> m_slots; // Slot of each id, or -1
+    std::vector<EntityId> m_freeIds;
+
+    ChunkSpatialHash m_grid; // Of m_positions
+    bool m_gridStale; // Entities were added or removed since it was built
+    bool m_parallel;
+    TrackedBytes m_trackedBytes;
+
+    static glm::vec2 sizeOf(EntityKind kind);
+    static float stepHeightOf(EntityKind kind);
+
+    void refreshGrid();
+    void removeSlot(int slot);
+    void updateTrackedBytes();
+
+    // The parts of an entity's update that don't touch the world: its
+    // velocity under gravity, steering and crowding, and how far it tries
+    // to move this tick
+    glm::vec3 steer(int slot, float dT);
+    // Takes in where the swept move from steer() got to
+    void land(int slot, const SweepResult &result);
+    // Swaps in the new positions and removes the dead
+    void finishTick();
+
+    // Calls fn(first, last) over [0, count) in runs of ENTITY_BATCH_SIZE,
+    // on the thread pool and the calling thread, and returns once all of
+    // them are done. Serially when m_parallel is off.
+    void runBatches(int count, const std::function<void(int, int)> &fn);
+
+public:
+    EntitySystem();
+
+    EntityId spawn(EntityKind kind, glm::vec3 pos, glm::vec3 velocity);
+    void despawn(EntityId id);
+    bool alive(EntityId id) const;
+    size_t count() const;
+
+    // Only valid for ids that are alive
+    EntityKind kind(EntityId id) const;
+    glm::vec3 position(EntityId id) const;
+    glm::vec3 velocity(EntityId id) const;
+
+    // Every entity's position, in no particular order, for drawing
+    const std::vector<glm::vec3> &positions() const;
+
+    // The entities whose positions are within radius of center
+    void entitiesNear(glm::vec3 center, float radius, std::vector<EntityId> *out_ids);
+
+    // On by default; off updates every batch on the calling thread
+    void setParallel(bool parallel);
+
+    // Moves every entity on by dT through the solid blocks of world, with
+    // the same swept box as the player. World is anything with
+    // hasChunkAt(x, z) and getChunkAt(x, z), such as Terrain. Entities in
+    // chunks that aren't loaded stay where they are.
+    template <typename World>
+    void tick(float dT, const World &world);
+};
+
+template <typename World>
+void EntitySystem::tick(float dT, const World &world) {
+    refreshGrid();
+    runBatches(static_cast<int>(m_ids.size()), [this, dT, &world](int first, int last) {
+        VoxelNeighborhood blocks;
+        for (int i = first; i < last; i++) {
+            glm::vec3 pos = m_positions[i];
+            if (!world.hasChunkAt(static_cast<int>(glm::floor(pos.x)), static_cast<int>(glm::floor(pos.z)))) {
+                m_nextPositions[i] = pos;
+                continue;
+            }
+            glm::vec3 movement = steer(i, dT);
+            glm::vec2 size = m_sizes[i];
+            float step = stepHeightOf(m_kinds[i]);
+            AABB box {pos - glm::vec3(size.x / 2.f, 0.f, size.x / 2.f), pos + glm::vec3(size.x / 2.f, size.y, size.x / 2.f)};
+            glm::vec3 reach = glm::abs(movement) + glm::vec3(0.f, step, 0.f);
+            blocks.gather(world, glm::ivec3(glm::floor(box.min - reach)) - 1, glm::ivec3(glm::ceil(box.max + reach)) + 1);
+            land(i, sweepAABB(blocks, box, movement, step));
+        }
+    });
+    finishTick();
+}
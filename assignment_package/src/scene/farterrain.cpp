@@ -0,0 +1,225 @@
+#include "farterrain.h"
+#include "chunkworkers.h"
+#include "terrain.h"
+#include "tracer.h"
+#include <QThreadPool>
+
+FarTerrainTile::FarTerrainTile(OpenGLContext *context)
+    : Drawable(context)
+{}
+
+void FarTerrainTile::createVBOdata(const FarTileVBOData &data) {
+    generateIdxOpq();
+    mp_context->bufferIndicesTracked(m_bufIdxOpq, data.idxDataOpaque.size() * sizeof(GLuint), data.idxDataOpaque.data(), GL_STATIC_DRAW);
+
+    generateInterleavedOpq();
+    mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufInterleavedOpq);
+    mp_context->bufferDataTracked(GL_ARRAY_BUFFER, m_bufInterleavedOpq, data.vboDataOpaque.size() * sizeof(float), data.vboDataOpaque.data(), GL_STATIC_DRAW);
+
+    generateIdxTra();
+    mp_context->bufferIndicesTracked(m_bufIdxTra, data.idxDataTransparent.size() * sizeof(GLuint), data.idxDataTransparent.data(), GL_STATIC_DRAW);
+
+    generateInterleavedTra();
+    mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufInterleavedTra);
+    mp_context->bufferDataTracked(GL_ARRAY_BUFFER, m_bufInterleavedTra, data.vboDataTransparent.size() * sizeof(float), data.vboDataTransparent.data(), GL_STATIC_DRAW);
+
+    generateInterleavedVAOs();
+
+    m_countOpq = data.idxDataOpaque.size();
+    m_countTra = data.idxDataTransparent.size();
+}
+
+FarTerrainWorker::FarTerrainWorker(int64_t zone, std::vector<FarTileVBOData> *tilesWithVBOs, QMutex *tilesWithVBOsMutex)
+    : zone(zone), tilesWithVBOs(tilesWithVBOs), tilesWithVBOsMutex(tilesWithVBOsMutex),
+      job(Tracer::nextJobId()), queuedAt(Tracer::now())
+{}
+
+void FarTerrainWorker::run() {
+    TraceScope trace("FarTerrainWorker", job, queuedAt, toCoords(zone));
+    FarTileVBOData tileData(zone);
+
+    FarTerrain::buildTileData(zone, &tileData);
+    tileData.trackedBytes.set((tileData.vboDataOpaque.size() + tileData.vboDataTransparent.size()) * sizeof(float) +
+                              (tileData.idxDataOpaque.size() + tileData.idxDataTransparent.size()) * sizeof(GLuint));
+
+    tilesWithVBOsMutex->lock();
+    tilesWithVBOs->push_back(tileData);
+    tilesWithVBOsMutex->unlock();
+}
+
+// Texture atlas cell of the top face of each surface block, matching
+// the ones appendVBOData uses for full blocks
+static glm::vec2 surfaceUV(BlockType b) {
+    switch (b) {
+    case GRASS:
+        return glm::vec2(8.f, 13.f);
+    case DIRT:
+        return glm::vec2(2.f, 15.f);
+    case SNOW:
+        return glm::vec2(2.f, 11.f);
+    case WATER:
+        return glm::vec2(13.f, 3.f);
+    default:
+        return glm::vec2(1.f, 15.f);
+    }
+}
+
+// Appends one quad in the chunk vertex layout: position, normal, then
+// UV with z flagging animated liquid
+static void appendQuad(std::vector<float> &vboData, std::vector<GLuint> &idxData,
+                       const std::array<glm::vec3, 4> &corners, const glm::vec3 &normal,
+                       glm::vec2 uvCell, float uvZ) {
+    const std::array<glm::vec2, 4> offset = {glm::vec2{0.f, 0.f}, glm::vec2{1.f, 0.f}, glm::vec2{1.f, 1.f}, glm::vec2{0.f, 1.f}};
+    GLuint first = vboData.size() / 11;
+    for (int i = 0; i < 4; i++) {
+        vboData.insert(vboData.end(), {corners[i].x, corners[i].y, corners[i].z, 1.f,
+                                       normal.x, normal.y, normal.z, 0.f,
+                                       (uvCell.x + offset[i].x) / 16.f, (uvCell.y + offset[i].y) / 16.f, uvZ});
+    }
+    idxData.insert(idxData.end(), {first, first + 1, first + 2, first, first + 2, first + 3});
+}
+
+void FarTerrain::buildTileData(int64_t zone, FarTileVBOData *data) {
+    const int cells = 64 / FAR_TERRAIN_SPACING;
+    glm::ivec2 origin = toCoords(zone);
+
+    // Sample on the cell corners so that neighbouring tiles share their edges
+    std::vector<float> heights((cells + 1) * (cells + 1));
+    std::vector<BlockType> surfaces((cells + 1) * (cells + 1));
+    for (int i = 0; i <= cells; i++) {
+        for (int j = 0; j <= cells; j++) {
+            float biome;
+            int height = getTerrainHeight(origin.x + i * FAR_TERRAIN_SPACING, origin.y + j * FAR_TERRAIN_SPACING, &biome);
+            heights[i + (cells + 1) * j] = height;
+            surfaces[i + (cells + 1) * j] = getSurfaceBlock(height, biome);
+        }
+    }
+    // Positions are relative to the zone's corner, which the shader adds back
+    auto corner = [&](int i, int j) {
+        return glm::vec3(i * FAR_TERRAIN_SPACING, heights[i + (cells + 1) * j], j * FAR_TERRAIN_SPACING);
+    };
+
+    for (int i = 0; i < cells; i++) {
+        for (int j = 0; j < cells; j++) {
+            std::array<glm::vec3, 4> quad = {corner(i, j), corner(i + 1, j), corner(i + 1, j + 1), corner(i, j + 1)};
+            glm::vec3 normal = glm::normalize(glm::cross(quad[3] - quad[0], quad[1] - quad[0]) +
+                                              glm::cross(quad[1] - quad[2], quad[3] - quad[2]));
+            appendQuad(data->vboDataOpaque, data->idxDataOpaque, quad, normal,
+                       surfaceUV(surfaces[i + (cells + 1) * j]), 0.f);
+
+            float lowest = glm::min(glm::min(quad[0].y, quad[1].y), glm::min(quad[2].y, quad[3].y));
+            if (lowest < SEA_LEVEL) {
+                std::array<glm::vec3, 4> water = quad;
+                for (glm::vec3 &p : water) {
+                    p.y = SEA_LEVEL;
+                }
+                appendQuad(data->vboDataTransparent, data->idxDataTransparent, water, glm::vec3(0.f, 1.f, 0.f),
+                           surfaceUV(WATER), 1.f);
+            }
+        }
+    }
+
+    // Skirts along the four edges, facing outwards
+    const glm::vec3 down(0.f, -FAR_TERRAIN_SKIRT_DEPTH, 0.f);
+    for (int k = 0; k < cells; k++) {
+        std::array<std::pair<glm::vec3, glm::vec3>, 4> edges = {
+            std::make_pair(corner(k + 1, 0), corner(k, 0)),
+            std::make_pair(corner(k, cells), corner(k + 1, cells)),
+            std::make_pair(corner(0, k), corner(0, k + 1)),
+            std::make_pair(corner(cells, k + 1), corner(cells, k))
+        };
+        const std::array<glm::vec3, 4> normals = {glm::vec3(0, 0, -1), glm::vec3(0, 0, 1), glm::vec3(-1, 0, 0), glm::vec3(1, 0, 0)};
+        for (int e = 0; e < 4; e++) {
+            const glm::vec3 &a = edges[e].first;
+            const glm::vec3 &b = edges[e].second;
+            appendQuad(data->vboDataOpaque, data->idxDataOpaque, {a + down, b + down, b, a}, normals[e],
+                       surfaceUV(STONE), 0.f);
+        }
+    }
+}
+
+FarTerrain::FarTerrain(OpenGLContext *context)
+    : mp_context(context), m_tiles(), m_pendingTiles(),
+      m_tilesWithVBOsMutex(), m_tilesWithVBOs{},
+      m_enabled(true)
+{}
+
+FarTerrain::~FarTerrain() {
+    for (auto &tile : m_tiles) {
+        tile.second->destroyVBOdata();
+    }
+}
+
+void FarTerrain::update(const QSet<int64_t> &wanted, const QSet<int64_t> &keep) {
+    if (!m_enabled) {
+        return;
+    }
+    for (int64_t zone : wanted) {
+        if (m_tiles.count(zone) || m_pendingTiles.count(zone)) {
+            continue;
+        }
+        m_pendingTiles.insert(zone);
+        FarTerrainWorker *worker = new FarTerrainWorker(zone, &m_tilesWithVBOs, &m_tilesWithVBOsMutex);
+        QThreadPool::globalInstance()->start(worker);
+    }
+    for (auto it = m_tiles.begin(); it != m_tiles.end();) {
+        if (!keep.contains(it->first)) {
+            it->second->destroyVBOdata();
+            it = m_tiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void FarTerrain::checkThreadResults() {
+    m_tilesWithVBOsMutex.lock();
+    for (FarTileVBOData &td : m_tilesWithVBOs) {
+        m_pendingTiles.erase(td.zone);
+        uPtr<FarTerrainTile> &tile = m_tiles[td.zone];
+        if (tile == nullptr) {
+            tile = mkU<FarTerrainTile>(mp_context);
+        }
+        tile->createVBOdata(td);
+    }
+    m_tilesWithVBOs.clear();
+    m_tilesWithVBOsMutex.unlock();
+}
+
+void FarTerrain::drawOpaque(ShaderProgram *shaderProgram, const std::function<bool(int64_t)> &isCovered) {
+    if (!m_enabled) {
+        return;
+    }
+    for (auto &tile : m_tiles) {
+        if (tile.second->opqCount() > 0 && !isCovered(tile.first)) {
+            glm::ivec2 origin = toCoords(tile.first);
+            shaderProgram->setChunkOrigin(glm::vec3(origin.x, 0.f, origin.y));
+            shaderProgram->drawOpaque(*tile.second);
+        }
+    }
+}
+
+void FarTerrain::drawTransparent(ShaderProgram *shaderProgram, const std::function<bool(int64_t)> &isCovered) {
+    if (!m_enabled) {
+        return;
+    }
+    for (auto &tile : m_tiles) {
+        if (tile.second->traCount() > 0 && !isCovered(tile.first)) {
+            glm::ivec2 origin = toCoords(tile.first);
+            shaderProgram->setChunkOrigin(glm::vec3(origin.x, 0.f, origin.y));
+            shaderProgram->drawTransparent(*tile.second);
+        }
+    }
+}
+
+void FarTerrain::setEnabled(bool enabled) {
+    m_enabled = enabled;
+}
+
+bool FarTerrain::enabled() const {
+    return m_enabled;
+}
+
+size_t FarTerrain::tileCount() const {
+    return m_tiles.size();
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include "drawable.h"
+#include "smartpointerhelp.h"
+#include "shaderprogram.h"
+#include "memorystats.h"
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <QSet>
+#include <QtCore/QMutex>
+#include <QtCore/QRunnable>
+
+// Blocks between neighbouring height samples of a far terrain tile
+#define FAR_TERRAIN_SPACING 8
+// How far the edges of each tile hang down, to hide cracks against
+// neighbouring tiles and chunk meshes
+#define FAR_TERRAIN_SKIRT_DEPTH 24.f
+// Default number of zones past the draw radius that far terrain covers
+#define FAR_TERRAIN_RADIUS 10
+// Tiles are freed once this many zones outside the far terrain radius
+#define FAR_TERRAIN_UNLOAD_MARGIN 2
+
+// Mesh data for one far terrain tile, built on a worker thread.
+// Tiles line up with terrain generation zones.
+struct FarTileVBOData {
+    int64_t zone;
+    std::vector<float> vboDataOpaque, vboDataTransparent;
+    std::vector<GLuint> idxDataOpaque, idxDataTransparent;
+    TrackedBytes trackedBytes;
+
+    FarTileVBOData(int64_t zone)
+        : zone(zone), vboDataOpaque{}, vboDataTransparent{}, idxDataOpaque{}, idxDataTransparent{},
+          trackedBytes(MEM_MESH_CPU)
+    {}
+};
+
+// A coarse heightfield standing in for one zone of terrain that
+// hasn't been generated or meshed as blocks
+class FarTerrainTile : public Drawable {
+public:
+    FarTerrainTile(OpenGLContext *context);
+    // Tiles only get their data from a FarTerrainWorker
+    void createVBOdata() override {}
+    void createVBOdata(const FarTileVBOData &data);
+};
+
+class FarTerrainWorker : public QRunnable {
+private:
+    int64_t zone;
+    std::vector<FarTileVBOData> *tilesWithVBOs;
+    QMutex *tilesWithVBOsMutex;
+    uint64_t job, queuedAt; // For the Tracer
+
+public:
+    FarTerrainWorker(int64_t zone, std::vector<FarTileVBOData> *tilesWithVBOs, QMutex *tilesWithVBOsMutex);
+
+    void run() override;
+};
+
+// The horizon beyond the block draw distance. Samples the same height and
+// biome functions as fillBlock on a coarse grid, so no Chunks or block
+// arrays are ever created for it. Terrain decides which tiles to keep and
+// skips drawing those whose zone is already covered by real chunk meshes.
+class FarTerrain {
+private:
+    OpenGLContext *mp_context;
+
+    std::unordered_map<int64_t, uPtr<FarTerrainTile>> m_tiles;
+    // Zones with a worker building their tile
+    std::unordered_set<int64_t> m_pendingTiles;
+
+    QMutex m_tilesWithVBOsMutex;
+    std::vector<FarTileVBOData> m_tilesWithVBOs;
+
+    bool m_enabled;
+
+public:
+    FarTerrain(OpenGLContext *context);
+    ~FarTerrain();
+
+    // Builds the heightfield mesh for one zone. Safe to call from any thread.
+    static void buildTileData(int64_t zone, FarTileVBOData *data);
+
+    // Spawns workers for the zones in wanted that have no tile yet and
+    // frees the tiles of zones no longer in keep
+    void update(const QSet<int64_t> &wanted, const QSet<int64_t> &keep);
+    // Uploads finished tiles. Must run on the main thread.
+    void checkThreadResults();
+
+    // Draws every tile whose zone isn't covered
+    void drawOpaque(ShaderProgram *shaderProgram, const std::function<bool(int64_t)> &isCovered);
+    void drawTransparent(ShaderProgram *shaderProgram, const std::function<bool(int64_t)> &isCovered);
+
+    void setEnabled(bool enabled);
+    bool enabled() const;
+    size_t tileCount() const;
+};
@@ -0,0 +1,74 @@
+#include "fluidsim.h"
+
+FluidSim::FluidSim()
+    : m_tick(0), m_schedule(), m_scheduled(), m_levels(), m_changes()
+{}
+
+// x and z in 28 bits each, y in 8
+int64_t FluidSim::cellKey(glm::ivec3 cell) {
+    return (static_cast<int64_t>(cell.x & 0x0fffffff) << 36) |
+           (static_cast<int64_t>(cell.z & 0x0fffffff) << 8) |
+           static_cast<int64_t>(cell.y & 0xff);
+}
+
+int FluidSim::reachOf(BlockType fluid) {
+    return fluid == LAVA ? FLUID_LAVA_REACH : FLUID_WATER_REACH;
+}
+
+int FluidSim::delayOf(BlockType fluid) {
+    return fluid == LAVA ? FLUID_LAVA_DELAY_TICKS : FLUID_WATER_DELAY_TICKS;
+}
+
+unsigned char FluidSim::levelAt(glm::ivec3 cell) const {
+    auto it = m_levels.find(cellKey(cell));
+    return it == m_levels.end() ? 0 : it->second;
+}
+
+void FluidSim::setLevel(glm::ivec3 cell, unsigned char level) {
+    if (level == 0) {
+        m_levels.erase(cellKey(cell));
+    } else {
+        m_levels[cellKey(cell)] = level;
+    }
+}
+
+void FluidSim::schedule(glm::ivec3 cell, int delay) {
+    if (m_scheduled.insert(cellKey(cell)).second) {
+        m_schedule[m_tick + delay].push_back(cell);
+    }
+}
+
+void FluidSim::scheduleAround(glm::ivec3 cell, int delay) {
+    schedule(cell, delay);
+    schedule(cell + glm::ivec3(1, 0, 0), delay);
+    schedule(cell - glm::ivec3(1, 0, 0), delay);
+    schedule(cell + glm::ivec3(0, 1, 0), delay);
+    schedule(cell - glm::ivec3(0, 1, 0), delay);
+    schedule(cell + glm::ivec3(0, 0, 1), delay);
+    schedule(cell - glm::ivec3(0, 0, 1), delay);
+}
+
+void FluidSim::takeDue(std::vector<glm::ivec3> *out_cells) {
+    while (!m_schedule.empty() && m_schedule.begin()->first <= m_tick &&
+           out_cells->size() < FLUID_MAX_CELLS_PER_TICK) {
+        std::vector<glm::ivec3> &due = m_schedule.begin()->second;
+        // From the back, so what's left over stays put
+        while (!due.empty() && out_cells->size() < FLUID_MAX_CELLS_PER_TICK) {
+            m_scheduled.erase(cellKey(due.back()));
+            out_cells->push_back(due.back());
+            due.pop_back();
+        }
+        if (due.empty()) {
+            m_schedule.erase(m_schedule.begin());
+        }
+    }
+}
+
+void FluidSim::blockChanged(glm::ivec3 cell) {
+    setLevel(cell, 0);
+    scheduleAround(cell, 1);
+}
+
+size_t FluidSim::activeCount() const {
+    return m_scheduled.size();
+}
@@ -0,0 +1,165 @@
+#pragma once
+#include "chunkhelpers.h"
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// How many blocks flowing fluid spreads sideways from where it lands
+#define FLUID_WATER_REACH 7
+#define FLUID_LAVA_REACH 3
+// Simulation ticks between a change and the cells around it following
+#define FLUID_WATER_DELAY_TICKS 5
+#define FLUID_LAVA_DELAY_TICKS 20
+// Most cells looked at in one tick. Cells left over wait for the next.
+#define FLUID_MAX_CELLS_PER_TICK 512
+
+inline bool isFluid(BlockType t) {
+    return t == WATER || t == LAVA;
+}
+
+// Flowing water and lava as a cellular automaton. A fluid block is either
+// a source, which never changes on its own, or flowing, with a level of
+// how many blocks it is from where it came down: the source's neighbours
+// are 1, theirs 2, and so on up to the fluid's reach. Water falling into
+// an empty block lands at 1. Only flowing blocks have their level stored,
+// so a lake of sources costs nothing to keep.
+//
+// Nothing is looked at unless something near it changed. Each change
+// schedules the block and its six neighbours a few ticks later, and a tick
+// works through the blocks that are due, up to FLUID_MAX_CELLS_PER_TICK.
+// Every due block works out what it should hold from the blocks around it
+// before any of them change, so the order they are looked at in doesn't
+// matter. Water and lava meeting in a flowing block turn it to STONE.
+class FluidSim {
+private:
+    uint64_t m_tick;
+    // Blocks to look at, by the tick they are due in
+    std::map<uint64_t, std::vector<glm::ivec3>> m_schedule;
+    std::unordered_set<int64_t> m_scheduled; // Everything in m_schedule, so nothing is in it twice
+    std::unordered_map<int64_t, unsigned char> m_levels; // Of flowing blocks
+
+    struct Change {
+        glm::ivec3 cell;
+        BlockType type;
+        unsigned char level; // 0 for anything but flowing fluid
+        int delay; // Before the blocks around it follow
+    };
+    std::vector<Change> m_changes; // Scratch for step()
+
+    static int64_t cellKey(glm::ivec3 cell);
+    static int reachOf(BlockType fluid);
+    static int delayOf(BlockType fluid);
+
+    void schedule(glm::ivec3 cell, int delay);
+    void scheduleAround(glm::ivec3 cell, int delay);
+    // Pops up to FLUID_MAX_CELLS_PER_TICK due blocks into out_cells
+    void takeDue(std::vector<glm::ivec3> *out_cells);
+    void setLevel(glm::ivec3 cell, unsigned char level);
+
+    // What a block that is EMPTY or flowing fluid should hold, given the
+    // blocks around it. at(cell) returns the block there, or BEDROCK if
+    // its chunk isn't loaded.
+    template <typename BlockAt>
+    Change settle(glm::ivec3 cell, BlockAt at) const;
+
+public:
+    FluidSim();
+
+    // 0 for sources and anything that isn't fluid
+    unsigned char levelAt(glm::ivec3 cell) const;
+
+    // To be called whenever a block is set from outside the simulation, so
+    // the fluid around it reacts. A fluid block set this way is a source.
+    void blockChanged(glm::ivec3 cell);
+
+    // Blocks waiting to be looked at. Zero once everything has settled.
+    size_t activeCount() const;
+
+    // Moves the fluids on by one tick. World is anything with
+    // hasChunkAt(x, z), getBlockAt(x, y, z) and setBlockAt(x, y, z, t) in
+    // world coordinates, such as Terrain. Every block set is appended to
+    // out_changed so the caller can remesh its chunk. Returns the number
+    // of blocks looked at.
+    template <typename World>
+    int step(World *world, std::vector<glm::ivec3> *out_changed);
+};
+
+template <typename BlockAt>
+FluidSim::Change FluidSim::settle(glm::ivec3 cell, BlockAt at) const {
+    Change result {cell, EMPTY, 0, 0};
+    BlockType above = at(cell + glm::ivec3(0, 1, 0));
+    if (isFluid(above)) {
+        result.type = above;
+        result.level = 1;
+    }
+    bool mixed = false;
+    static const std::array<glm::ivec3, 4> sides {{
+        glm::ivec3(1, 0, 0), glm::ivec3(-1, 0, 0), glm::ivec3(0, 0, 1), glm::ivec3(0, 0, -1)
+    }};
+    for (const glm::ivec3 &side : sides) {
+        glm::ivec3 n = cell + side;
+        BlockType t = at(n);
+        if (!isFluid(t)) {
+            continue;
+        }
+        // Fluid only spreads sideways from something it rests on: not from
+        // a block that is still falling
+        BlockType below = at(n - glm::ivec3(0, 1, 0));
+        int level = levelAt(n);
+        if (below == EMPTY || (isFluid(below) && levelAt(n - glm::ivec3(0, 1, 0)) != 0) || level >= reachOf(t)) {
+            continue;
+        }
+        if (result.type != EMPTY && result.type != t) {
+            mixed = true;
+        } else if (result.type == EMPTY || level + 1 < result.level) {
+            result.type = t;
+            result.level = static_cast<unsigned char>(level + 1);
+        }
+    }
+    if (mixed) {
+        result.type = STONE;
+        result.level = 0;
+    }
+    return result;
+}
+
+template <typename World>
+int FluidSim::step(World *world, std::vector<glm::ivec3> *out_changed) {
+    m_tick++;
+    std::vector<glm::ivec3> cells;
+    takeDue(&cells);
+    auto at = [world](glm::ivec3 p) {
+        if (!world->hasChunkAt(p.x, p.z)) {
+            return BEDROCK;
+        }
+        return world->getBlockAt(p.x, p.y, p.z);
+    };
+
+    // Everything is decided from the world as it was at the start of the tick
+    m_changes.clear();
+    for (const glm::ivec3 &cell : cells) {
+        if (cell.y < 0 || cell.y >= 256 || !world->hasChunkAt(cell.x, cell.z)) {
+            continue;
+        }
+        BlockType current = at(cell);
+        unsigned char level = levelAt(cell);
+        if (current != EMPTY && !(isFluid(current) && level != 0)) {
+            // Solid, or a source
+            continue;
+        }
+        Change next = settle(cell, at);
+        if (next.type != current || next.level != level) {
+            next.delay = delayOf(isFluid(next.type) ? next.type : current);
+            m_changes.push_back(next);
+        }
+    }
+
+    for (const Change &c : m_changes) {
+        world->setBlockAt(c.cell.x, c.cell.y, c.cell.z, c.type);
+        setLevel(c.cell, c.level);
+        scheduleAround(c.cell, c.delay);
+        out_changed->push_back(c.cell);
+    }
+    return static_cast<int>(cells.size());
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "chunkhelpers.h"
+#include <stdexcept>
+
+// Steps along the ray one grid cell at a time until it reaches a cell that
+// isn't EMPTY or has gone the length of rayDirection. World is anything
+// with a getBlockAt(x, y, z) taking world coordinates, such as Terrain.
+// The game casts rays with raycast() now; this stays as the baseline the
+// bench target measures it against.
+template <typename World>
+bool gridMarch(glm::vec3 rayOrigin, glm::vec3 rayDirection, const World &world,
+               float *out_dist, glm::vec3 *out_blockHit, BlockType *out_blockType) {
+    float maxLen = glm::length(rayDirection); // Farthest we search
+    glm::vec3 currCell = glm::vec3(glm::floor(rayOrigin));
+    rayDirection = glm::normalize(rayDirection); // Now all t values represent world dist.
+
+    float curr_t = 0.f;
+    while(curr_t < maxLen) {
+        float min_t = glm::sqrt(3.f);
+        float interfaceAxis = -1; // Track axis for which t is smallest
+        for(int i = 0; i < 3; ++i) { // Iterate over the three axes
+            if(rayDirection[i] != 0) { // Is ray parallel to axis i?
+                float offset = glm::max(0.f, glm::sign(rayDirection[i])); // See slide 5
+                // If the player is *exactly* on an interface then
+                // they'll never move if they're looking in a negative direction
+                if(currCell[i] == rayOrigin[i] && offset == 0.f) {
+                    offset = -1.f;
+                }
+                int nextIntercept = currCell[i] + offset;
+                float axis_t = (nextIntercept - rayOrigin[i]) / rayDirection[i];
+                axis_t = glm::min(axis_t, maxLen); // Clamp to max len to avoid super out of bounds errors
+                if(axis_t < min_t) {
+                    min_t = axis_t;
+                    interfaceAxis = i;
+                }
+            }
+        }
+        if(interfaceAxis == -1) {
+            throw std::out_of_range("interfaceAxis was -1 after the for loop in gridMarch!");
+        }
+        curr_t += min_t; // min_t is declared in slide 7 algorithm
+        rayOrigin += rayDirection * min_t;
+        glm::vec3 offset = glm::vec3(0,0,0);
+        // Sets it to 0 if sign is +, -1 if sign is -
+        offset[interfaceAxis] = glm::min(0.f, glm::sign(rayDirection[interfaceAxis]));
+        currCell = glm::vec3(glm::floor(rayOrigin)) + offset;
+        // If currCell contains something other than EMPTY, return
+        // curr_t
+        BlockType cellType = world.getBlockAt(currCell.x, currCell.y, currCell.z);
+        if(cellType != EMPTY) {
+            *out_blockHit = currCell;
+            *out_dist = glm::min(maxLen, curr_t);
+            *out_blockType = cellType;
+            return true;
+        }
+    }
+    *out_dist = glm::min(maxLen, curr_t);
+    return false;
+}
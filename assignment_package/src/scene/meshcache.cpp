@@ -0,0 +1,74 @@
+#include "meshcache.h"
+
+MeshCache::MeshCache(size_t budgetBytes)
+    : m_budgetBytes(budgetBytes), m_usedBytes(0), m_lru(), m_entries()
+{}
+
+void MeshCache::setBudget(size_t budgetBytes) {
+    m_budgetBytes = budgetBytes;
+}
+
+size_t MeshCache::budget() const {
+    return m_budgetBytes;
+}
+
+size_t MeshCache::usedBytes() const {
+    return m_usedBytes;
+}
+
+size_t MeshCache::size() const {
+    return m_entries.size();
+}
+
+void MeshCache::insert(Chunk *c, size_t bytes) {
+    auto it = m_entries.find(c);
+    if (it != m_entries.end()) {
+        m_usedBytes -= it->second.bytes;
+        it->second.bytes = bytes;
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lruPos);
+    } else {
+        m_lru.push_front(c);
+        m_entries[c] = Entry{m_lru.begin(), bytes};
+    }
+    m_usedBytes += bytes;
+}
+
+void MeshCache::touch(Chunk *c) {
+    auto it = m_entries.find(c);
+    if (it != m_entries.end()) {
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lruPos);
+    }
+}
+
+void MeshCache::remove(Chunk *c) {
+    auto it = m_entries.find(c);
+    if (it != m_entries.end()) {
+        m_usedBytes -= it->second.bytes;
+        m_lru.erase(it->second.lruPos);
+        m_entries.erase(it);
+    }
+}
+
+bool MeshCache::contains(Chunk *c) const {
+    return m_entries.count(c);
+}
+
+std::vector<Chunk*> MeshCache::evict(const std::function<bool(Chunk*)> &isPinned) {
+    std::vector<Chunk*> evicted;
+    auto it = m_lru.end();
+    while (m_usedBytes > m_budgetBytes && it != m_lru.begin()) {
+        --it;
+        Chunk *c = *it;
+        if (isPinned(c)) {
+            continue;
+        }
+        // Move off the victim before erasing it; the next --it lands on its predecessor
+        auto victim = it++;
+        auto entry = m_entries.find(c);
+        m_usedBytes -= entry->second.bytes;
+        m_entries.erase(entry);
+        m_lru.erase(victim);
+        evicted.push_back(c);
+    }
+    return evicted;
+}
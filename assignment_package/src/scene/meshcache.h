@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+class Chunk;
+
+// Default upper bound on the GPU memory held by chunk meshes;
+// --mesh-cache-mb=<n> changes it
+#define MESH_CACHE_BUDGET_BYTES (256u * 1024u * 1024u)
+
+// Tracks which Chunks currently own GPU meshes, how large those meshes
+// are, and how recently each was used. When the total exceeds the
+// budget, the least recently used meshes that aren't pinned are handed
+// back to be destroyed. The cache only does the bookkeeping; it never
+// touches OpenGL itself.
+class MeshCache {
+private:
+    struct Entry {
+        std::list<Chunk*>::iterator lruPos;
+        size_t bytes;
+    };
+
+    size_t m_budgetBytes;
+    size_t m_usedBytes;
+    // Most recently used at the front
+    std::list<Chunk*> m_lru;
+    std::unordered_map<Chunk*, Entry> m_entries;
+
+public:
+    MeshCache(size_t budgetBytes = MESH_CACHE_BUDGET_BYTES);
+
+    void setBudget(size_t budgetBytes);
+    size_t budget() const;
+    size_t usedBytes() const;
+    size_t size() const;
+
+    // Records a freshly uploaded mesh (replacing any previous one for
+    // the same chunk) and marks it as most recently used
+    void insert(Chunk *c, size_t bytes);
+    // Marks the chunk's mesh as most recently used, if it has one
+    void touch(Chunk *c);
+    void remove(Chunk *c);
+    bool contains(Chunk *c) const;
+
+    // Removes and returns least recently used meshes until usage fits the
+    // budget. Meshes for which isPinned returns true are never chosen.
+    std::vector<Chunk*> evict(const std::function<bool(Chunk*)> &isPinned);
+};
@@ -0,0 +1,129 @@
+#include "noisetexture.h"
+#include "glm_includes.h"
+#include <QThreadPool>
+
+// Key of the texture in the resource cache
+#define NOISE_TEXTURE_CACHE_KEY "water_noise"
+// How steep a slope reaches the ends of the G and B channels' range
+#define NOISE_TEXTURE_SLOPE_GAIN 4.f
+
+NoiseTexture::NoiseTexture(OpenGLContext *context)
+    : mp_context(context), m_handle(), m_created(false), m_trackedBytes(MEM_GPU_TEXTURES),
+      m_texelsMutex(), m_texels(), m_texelsReady(false)
+{}
+
+// The same hash and distance as the Worley loop lambert.frag.glsl used to
+// run per fragment, with the cell coordinates wrapped so that the texture tiles
+static float worleyNoise(glm::vec2 uv, float time) {
+    float maxDist = 0.f;
+    for (int xo = -1; xo <= 1; ++xo) {
+        for (int yo = -1; yo <= 1; ++yo) {
+            glm::vec2 pos = glm::mod(glm::floor(uv) + glm::vec2(xo, yo), float(NOISE_TEXTURE_CELLS));
+            glm::vec2 randomVec = glm::fract(glm::vec2(
+                glm::fract(glm::sin(glm::dot(pos, glm::vec2(127.1f, 311.7f))) * 43758.5453f) + time,
+                glm::fract(glm::sin(glm::dot(pos, glm::vec2(269.5f, 183.3f))) * 43758.5453f) + time));
+            maxDist = glm::max(maxDist, glm::length(randomVec - glm::fract(uv)));
+        }
+    }
+    return maxDist;
+}
+
+void NoiseTexture::generate(std::vector<unsigned char> *texels) {
+    const int size = NOISE_TEXTURE_SIZE;
+    texels->resize(NOISE_TEXTURE_SLICES * size * size * 4);
+    std::vector<float> values(size * size);
+    for (int slice = 0; slice < NOISE_TEXTURE_SLICES; slice++) {
+        // The hash is offset by time and wrapped, so one loop of the
+        // animation is one unit of time
+        float time = slice / float(NOISE_TEXTURE_SLICES);
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                glm::vec2 uv = (glm::vec2(x, y) + 0.5f) * float(NOISE_TEXTURE_CELLS) / float(size);
+                // The farthest point can be up to a diagonal away
+                values[x + size * y] = worleyNoise(uv, time) / glm::sqrt(2.f);
+            }
+        }
+
+        unsigned char *out = texels->data() + slice * size * size * 4;
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                float dx = values[(x + 1) % size + size * y] - values[(x + size - 1) % size + size * y];
+                float dy = values[x + size * ((y + 1) % size)] - values[x + size * ((y + size - 1) % size)];
+                glm::vec4 texel(values[x + size * y],
+                                0.5f + 0.5f * glm::clamp(dx * NOISE_TEXTURE_SLOPE_GAIN, -1.f, 1.f),
+                                0.5f + 0.5f * glm::clamp(dy * NOISE_TEXTURE_SLOPE_GAIN, -1.f, 1.f),
+                                1.f);
+                for (int c = 0; c < 4; c++) {
+                    *out++ = static_cast<unsigned char>(glm::round(255.f * glm::clamp(texel[c], 0.f, 1.f)));
+                }
+            }
+        }
+    }
+}
+
+void NoiseTexture::create(const ResourceCache *cache) {
+    mp_context->glGenTextures(1, &m_handle);
+    mp_context->glActiveTexture(GL_TEXTURE0 + NOISE_TEXTURE_SLOT);
+    mp_context->glBindTexture(GL_TEXTURE_2D_ARRAY, m_handle);
+    mp_context->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    mp_context->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    mp_context->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    mp_context->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // Flat and still until the real texels arrive
+    const unsigned char flat[4] = {128, 128, 128, 255};
+    mp_context->glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, 1, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, flat);
+    m_trackedBytes.set(sizeof(flat));
+    // Bound behind the state cache's back
+    mp_context->invalidateGLStateCache();
+    m_created = true;
+
+    QThreadPool::globalInstance()->start(new NoiseTextureWorker(this, cache));
+}
+
+void NoiseTexture::checkThreadResults() {
+    m_texelsMutex.lock();
+    if (m_texelsReady && m_created) {
+        mp_context->bindTextureCached(NOISE_TEXTURE_SLOT, GL_TEXTURE_2D_ARRAY, m_handle);
+        mp_context->glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8,
+                                 NOISE_TEXTURE_SIZE, NOISE_TEXTURE_SIZE, NOISE_TEXTURE_SLICES,
+                                 0, GL_RGBA, GL_UNSIGNED_BYTE, m_texels.data());
+        m_trackedBytes.set(int64_t(NOISE_TEXTURE_SIZE) * NOISE_TEXTURE_SIZE * NOISE_TEXTURE_SLICES * 4);
+        m_texels = std::vector<unsigned char>();
+        m_texelsReady = false;
+    }
+    m_texelsMutex.unlock();
+}
+
+void NoiseTexture::bind(int texSlot) {
+    mp_context->bindTextureCached(texSlot, GL_TEXTURE_2D_ARRAY, m_handle);
+}
+
+void NoiseTexture::destroy() {
+    if (m_created) {
+        mp_context->glDeleteTextures(1, &m_handle);
+        m_created = false;
+    }
+    m_trackedBytes.set(0);
+}
+
+NoiseTextureWorker::NoiseTextureWorker(NoiseTexture *texture, const ResourceCache *cache)
+    : texture(texture), cache(cache)
+{}
+
+void NoiseTextureWorker::run() {
+    std::vector<unsigned char> texels;
+    const size_t expectedSize = NOISE_TEXTURE_SLICES * NOISE_TEXTURE_SIZE * NOISE_TEXTURE_SIZE * 4;
+    bool cached = cache != nullptr && cache->load(NOISE_TEXTURE_CACHE_KEY, NOISE_TEXTURE_VERSION, &texels) &&
+                  texels.size() == expectedSize;
+    if (!cached) {
+        NoiseTexture::generate(&texels);
+        if (cache != nullptr) {
+            cache->store(NOISE_TEXTURE_CACHE_KEY, NOISE_TEXTURE_VERSION, texels);
+        }
+    }
+
+    texture->m_texelsMutex.lock();
+    texture->m_texels.swap(texels);
+    texture->m_texelsReady = true;
+    texture->m_texelsMutex.unlock();
+}
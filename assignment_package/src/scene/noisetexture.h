@@ -0,0 +1,65 @@
+#pragma once
+#include "openglcontext.h"
+#include "resourcecache.h"
+#include "memorystats.h"
+#include <vector>
+#include <QtCore/QMutex>
+#include <QtCore/QRunnable>
+
+// Texels along each side of a slice
+#define NOISE_TEXTURE_SIZE 64
+// Worley cells along each side of a slice. The cell hash wraps around at
+// this many cells so the texture tiles; lambert.frag.glsl must agree.
+#define NOISE_TEXTURE_CELLS 8
+// Animation frames in one loop of the noise
+#define NOISE_TEXTURE_SLICES 32
+// Texture unit the noise is bound to for every frame
+#define NOISE_TEXTURE_SLOT 2
+// Bump whenever generate() changes, so baked copies get rebuilt
+#define NOISE_TEXTURE_VERSION 1
+
+// The animated Worley noise that water and lava are shaded with, as a
+// tileable RGBA8 2D texture array with one layer per animation frame.
+// R is the noise value and G and B are its x and y slopes, remapped to
+// [0, 1], for bending the surface normals. Built once, on a worker thread,
+// so the shaders only have to sample it.
+class NoiseTexture {
+private:
+    OpenGLContext *mp_context;
+    GLuint m_handle;
+    bool m_created;
+    TrackedBytes m_trackedBytes;
+
+    // Handed over by the worker and uploaded by checkThreadResults()
+    QMutex m_texelsMutex;
+    std::vector<unsigned char> m_texels;
+    bool m_texelsReady;
+
+public:
+    NoiseTexture(OpenGLContext *context);
+
+    // Fills texels with every slice of the texture. Safe to call from any thread.
+    static void generate(std::vector<unsigned char> *texels);
+
+    // Creates the texture with a flat placeholder and starts building the
+    // real one. If cache is enabled the texels are loaded from it when
+    // present, and baked into it when not.
+    void create(const ResourceCache *cache);
+    // Uploads the texels once the worker is done. Must run on the main thread.
+    void checkThreadResults();
+    void bind(int texSlot);
+    void destroy();
+
+    friend class NoiseTextureWorker;
+};
+
+class NoiseTextureWorker : public QRunnable {
+private:
+    NoiseTexture *texture;
+    const ResourceCache *cache;
+
+public:
+    NoiseTextureWorker(NoiseTexture *texture, const ResourceCache *cache);
+
+    void run() override;
+};
@@ -0,0 +1,225 @@
+#include "occlusionculler.h"
+#include <algorithm>
+#include <fstream>
+#include <limits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Anything closer than this is treated as straddling the camera
+#define OCCLUSION_NEAR_W 0.1f
+
+static const float DEPTH_CLEAR = std::numeric_limits<float>::infinity();
+
+OcclusionCuller::OcclusionCuller()
+    : m_depth(OCCLUSION_BUFFER_WIDTH * OCCLUSION_BUFFER_HEIGHT, DEPTH_CLEAR),
+      m_viewProj(1.f)
+{}
+
+void OcclusionCuller::beginFrame(const glm::mat4 &viewProj) {
+    m_viewProj = viewProj;
+    std::fill(m_depth.begin(), m_depth.end(), DEPTH_CLEAR);
+}
+
+bool OcclusionCuller::project(const glm::vec3 &p, glm::vec3 &out) const {
+    glm::vec4 clip = m_viewProj * glm::vec4(p, 1.f);
+    if (clip.w < OCCLUSION_NEAR_W) {
+        return false;
+    }
+    out.x = (clip.x / clip.w * 0.5f + 0.5f) * OCCLUSION_BUFFER_WIDTH;
+    out.y = (clip.y / clip.w * 0.5f + 0.5f) * OCCLUSION_BUFFER_HEIGHT;
+    out.z = clip.w;
+    return true;
+}
+
+static float cross2(const glm::vec2 &o, const glm::vec2 &a, const glm::vec2 &b) {
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+// Andrew's monotone chain; returns the hull counter-clockwise
+static std::vector<glm::vec2> convexHull(std::vector<glm::vec2> pts) {
+    std::sort(pts.begin(), pts.end(), [](const glm::vec2 &a, const glm::vec2 &b) {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    });
+    std::vector<glm::vec2> hull(2 * pts.size());
+    size_t k = 0;
+    for (size_t i = 0; i < pts.size(); i++) {
+        while (k >= 2 && cross2(hull[k - 2], hull[k - 1], pts[i]) <= 0) k--;
+        hull[k++] = pts[i];
+    }
+    for (size_t i = pts.size() - 1, t = k + 1; i > 0; i--) {
+        while (k >= t && cross2(hull[k - 2], hull[k - 1], pts[i - 1]) <= 0) k--;
+        hull[k++] = pts[i - 1];
+    }
+    hull.resize(k > 0 ? k - 1 : 0);
+    return hull;
+}
+
+void OcclusionCuller::rasterizeConvex(const std::vector<glm::vec2> &hull, float depth) {
+    if (hull.size() < 3) {
+        return;
+    }
+
+    glm::vec2 lo = hull[0], hi = hull[0];
+    for (const glm::vec2 &p : hull) {
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    int x0 = std::max(0, static_cast<int>(glm::floor(lo.x)));
+    int y0 = std::max(0, static_cast<int>(glm::floor(lo.y)));
+    int x1 = std::min(OCCLUSION_BUFFER_WIDTH - 1, static_cast<int>(glm::ceil(hi.x)));
+    int y1 = std::min(OCCLUSION_BUFFER_HEIGHT - 1, static_cast<int>(glm::ceil(hi.y)));
+    if (x0 > x1 || y0 > y1) {
+        return;
+    }
+    // Rows are walked in aligned groups of four pixels
+    x0 &= ~3;
+
+    // Edge i is E(x, y) = a * x + b * y + c, positive inside. A pixel is only
+    // covered if its center is at least half a pixel's extent inside every edge,
+    // i.e. the whole pixel is inside.
+    size_t n = hull.size();
+    std::vector<float> a(n), b(n), c(n);
+    for (size_t i = 0; i < n; i++) {
+        const glm::vec2 &p0 = hull[i];
+        const glm::vec2 &p1 = hull[(i + 1) % n];
+        a[i] = -(p1.y - p0.y);
+        b[i] = p1.x - p0.x;
+        c[i] = -(a[i] * p0.x + b[i] * p0.y) - 0.5f * (glm::abs(a[i]) + glm::abs(b[i]));
+    }
+
+    for (int y = y0; y <= y1; y++) {
+        float py = y + 0.5f;
+        float *row = &m_depth[y * OCCLUSION_BUFFER_WIDTH];
+#ifdef __SSE2__
+        const __m128 depth4 = _mm_set1_ps(depth);
+        const __m128 zero = _mm_setzero_ps();
+        for (int x = x0; x <= x1; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps(x + 0.5f), _mm_set_ps(3.f, 2.f, 1.f, 0.f));
+            __m128 inside = _mm_cmpeq_ps(zero, zero);
+            for (size_t i = 0; i < n; i++) {
+                __m128 e = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[i]), px), _mm_set1_ps(b[i] * py + c[i]));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(e, zero));
+            }
+            if (_mm_movemask_ps(inside) == 0) {
+                continue;
+            }
+            __m128 old = _mm_loadu_ps(row + x);
+            __m128 closer = _mm_min_ps(old, depth4);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, old)));
+        }
+#else
+        for (int x = x0; x <= x1; x++) {
+            float px = x + 0.5f;
+            bool inside = true;
+            for (size_t i = 0; i < n && inside; i++) {
+                inside = a[i] * px + b[i] * py + c[i] >= 0.f;
+            }
+            if (inside) {
+                row[x] = std::min(row[x], depth);
+            }
+        }
+#endif
+    }
+}
+
+static void boxCorners(const glm::vec3 &boxMin, const glm::vec3 &boxMax, glm::vec3 corners[8]) {
+    for (int i = 0; i < 8; i++) {
+        corners[i] = glm::vec3((i & 1) ? boxMax.x : boxMin.x,
+                               (i & 2) ? boxMax.y : boxMin.y,
+                               (i & 4) ? boxMax.z : boxMin.z);
+    }
+}
+
+void OcclusionCuller::addOccluder(const glm::vec3 &boxMin, const glm::vec3 &boxMax) {
+    glm::vec3 corners[8];
+    boxCorners(boxMin, boxMax, corners);
+
+    std::vector<glm::vec2> pts;
+    pts.reserve(8);
+    float farthest = 0.f;
+    for (const glm::vec3 &corner : corners) {
+        glm::vec3 s;
+        // Clipping occluders isn't worth it; just drop ones that cross the near plane
+        if (!project(corner, s)) {
+            return;
+        }
+        pts.push_back(glm::vec2(s));
+        farthest = std::max(farthest, s.z);
+    }
+    rasterizeConvex(convexHull(pts), farthest);
+}
+
+bool OcclusionCuller::isVisible(const glm::vec3 &boxMin, const glm::vec3 &boxMax) const {
+    glm::vec3 corners[8];
+    boxCorners(boxMin, boxMax, corners);
+
+    glm::vec2 lo(std::numeric_limits<float>::max());
+    glm::vec2 hi(std::numeric_limits<float>::lowest());
+    float nearest = std::numeric_limits<float>::max();
+    for (const glm::vec3 &corner : corners) {
+        glm::vec3 s;
+        if (!project(corner, s)) {
+            return true;
+        }
+        lo = glm::min(lo, glm::vec2(s));
+        hi = glm::max(hi, glm::vec2(s));
+        nearest = std::min(nearest, s.z);
+    }
+
+    if (hi.x < 0.f || hi.y < 0.f || lo.x > OCCLUSION_BUFFER_WIDTH || lo.y > OCCLUSION_BUFFER_HEIGHT) {
+        return false;
+    }
+    int x0 = std::max(0, static_cast<int>(glm::floor(lo.x))) & ~3;
+    int y0 = std::max(0, static_cast<int>(glm::floor(lo.y)));
+    int x1 = std::min(OCCLUSION_BUFFER_WIDTH - 1, static_cast<int>(glm::floor(hi.x)));
+    int y1 = std::min(OCCLUSION_BUFFER_HEIGHT - 1, static_cast<int>(glm::floor(hi.y)));
+
+    for (int y = y0; y <= y1; y++) {
+        const float *row = &m_depth[y * OCCLUSION_BUFFER_WIDTH];
+#ifdef __SSE2__
+        const __m128 nearest4 = _mm_set1_ps(nearest);
+        for (int x = x0; x <= x1; x += 4) {
+            if (_mm_movemask_ps(_mm_cmplt_ps(nearest4, _mm_loadu_ps(row + x))) != 0) {
+                return true;
+            }
+        }
+#else
+        for (int x = x0; x <= x1; x++) {
+            if (nearest < row[x]) {
+                return true;
+            }
+        }
+#endif
+    }
+    return false;
+}
+
+bool OcclusionCuller::dumpDepthBuffer(const std::string &path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        return false;
+    }
+
+    float maxDepth = 0.f;
+    for (float d : m_depth) {
+        if (d != DEPTH_CLEAR) {
+            maxDepth = std::max(maxDepth, d);
+        }
+    }
+
+    out << "P5\n" << OCCLUSION_BUFFER_WIDTH << " " << OCCLUSION_BUFFER_HEIGHT << "\n255\n";
+    // PGM rows go top to bottom, ours go bottom to top
+    for (int y = OCCLUSION_BUFFER_HEIGHT - 1; y >= 0; y--) {
+        for (int x = 0; x < OCCLUSION_BUFFER_WIDTH; x++) {
+            float d = m_depth[y * OCCLUSION_BUFFER_WIDTH + x];
+            unsigned char v = 0;
+            if (d != DEPTH_CLEAR && maxDepth > 0.f) {
+                v = static_cast<unsigned char>(255.f * (1.f - 0.9f * d / maxDepth));
+            }
+            out.put(static_cast<char>(v));
+        }
+    }
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "glm_includes.h"
+#include <string>
+#include <vector>
+
+// Resolution of the CPU depth buffer. The width must be a multiple of 4
+// so that rows can be processed four pixels at a time.
+#define OCCLUSION_BUFFER_WIDTH 128
+#define OCCLUSION_BUFFER_HEIGHT 64
+
+// A tiny software rasterizer used to skip chunks and sections that are
+// hidden behind nearby solid terrain. Each frame, a handful of large
+// opaque boxes are rasterized into a low resolution depth buffer and
+// the bounding boxes of everything we are about to draw are tested
+// against it. Depth is stored as clip-space w (distance along the view
+// direction), with "nothing drawn here" being +infinity.
+//
+// Both halves are conservative: occluders only cover pixels they cover
+// completely and write the depth of their farthest corner, while a
+// candidate covers every pixel its bounds touch and uses the depth of
+// its nearest corner.
+class OcclusionCuller {
+private:
+    std::vector<float> m_depth;
+    glm::mat4 m_viewProj;
+
+    // Projected corner in buffer pixel coordinates, with w as depth.
+    // Returns false if the point is behind (or too close to) the camera.
+    bool project(const glm::vec3 &p, glm::vec3 &out) const;
+    void rasterizeConvex(const std::vector<glm::vec2> &hull, float depth);
+
+public:
+    OcclusionCuller();
+
+    // Clears the depth buffer and sets the transform used for this frame
+    void beginFrame(const glm::mat4 &viewProj);
+
+    // Rasterizes the screen-space silhouette of a solid box
+    void addOccluder(const glm::vec3 &boxMin, const glm::vec3 &boxMax);
+
+    // False if the box is entirely behind occluders already in the
+    // buffer or entirely outside the view
+    bool isVisible(const glm::vec3 &boxMin, const glm::vec3 &boxMax) const;
+
+    // Writes the depth buffer as a binary greyscale PGM, nearer is brighter
+    bool dumpDepthBuffer(const std::string &path) const;
+};
@@ -4,9 +4,10 @@
 #include "player.h"
 #include <QString>
 #include <iostream>
+#include "raycast.h"
 
 Player::Player(glm::vec3 pos, const Terrain &terrain)
-    : Entity(pos), m_velocity(0,0,0), m_acceleration(0,0,0), m_camera(pos + glm::vec3(0, 1.5f, 0)),
+    : Entity(pos), m_velocity(0,0,0), m_acceleration(0,0,0), m_previousPosition(pos), m_neighborhood(), m_camera(pos + glm::vec3(0, 1.5f, 0)),
       mcr_terrain(terrain), mcr_camera(m_camera),
       flightMode(true), waterMode(false), swimming(new QSoundEffect), thunk(new QSoundEffect)
 {
@@ -20,82 +21,109 @@ Player::~Player()
 {}
 
 void Player::tick(float dT, InputBundle &input) {
-    processInputs(input);
+    m_previousPosition = m_position;
+    processInputs(dT, input);
     computePhysics(dT, mcr_terrain);
 }
 
-void Player::editBlock(InputBundle &inputs, Terrain &terrain, bool mode, BlockType b, int& m_grass, int& m_dirt, int& m_stone, int& m_water, int& m_snow,int& m_lava) {
-    // if mode is true - add block ; if mode is false - remove block
-    float dist = 0;
-    glm::vec3 blockHit;
-    BlockType blockType;
-    bool collided = gridMarch(m_camera.mcr_position,
-                              3.f * glm::normalize(m_camera.mcr_forward), terrain, &dist, &blockHit, &blockType);
+Camera Player::interpolatedCamera(float alpha) const {
+    // Only the position is blended; turning already happens a little at a
+    // time, and blending it would make the view lag behind the mouse
+    Camera camera(m_camera);
+    camera.moveAlongVector((alpha - 1.f) * (m_position - m_previousPosition));
+    return camera;
+}
 
-    if (collided) {
-        if (mode) {
-            // ADD BLOCK MODE --
-            float dist2 = 0;
-            glm::vec3 blockHit2;
-            thunk ->play();
-            gridMarchBlockBefore(m_camera.mcr_position, 3.f * glm::normalize(m_camera.mcr_forward), terrain, &dist2, &blockHit2);
-            terrain.setBlockAt(blockHit2.x, blockHit2.y, blockHit2.z, b);
-            terrain.updateChunk(terrain.getChunkAt(blockHit2.x, blockHit2.z).get());
+bool Player::editBlock(InputBundle &inputs, Terrain &terrain, bool mode, BlockType b, int& m_grass, int& m_dirt, int& m_stone, int& m_water, int& m_snow,int& m_lava,
+                       BlockEdit *out_edit) {
+    // if mode is true - add block ; if mode is false - remove block
+    RayHit hit;
+    if (!raycast(terrain, m_camera.mcr_position, m_camera.mcr_forward, 3.f, &hit) ||
+        (!mode && hit.type == BEDROCK)) {
+        return false;
+    }
+    BlockType blockType = hit.type;
+    BlockEdit edit {BlockEdit::PLACE, hit.cell, b, blockType};
+    if (mode) {
+        // ADD BLOCK MODE --
+        edit.pos = hit.previous;
+    } else if (blockType == REDSTONE_LEVER_OFF || blockType == REDSTONE_LEVER_ON) {
+        edit.kind = BlockEdit::TOGGLE_LEVER;
+    } else {
+        edit.kind = BlockEdit::REMOVE;
+    }
+    if (edit.kind != BlockEdit::TOGGLE_LEVER) {
+        thunk ->play();
+    }
+    applyEdit(edit, terrain, m_grass, m_dirt, m_stone, m_water, m_snow, m_lava);
+    if (out_edit) {
+        *out_edit = edit;
+    }
+    return true;
+}
 
-            // redstone
-            if (redstoneBlocks.count(b)) {
-                terrain.setRedstoneItemAt(blockHit2.x, blockHit2.y, blockHit2.z, b);
-            }
+void Player::applyEdit(const BlockEdit &edit, Terrain &terrain, int& m_grass, int& m_dirt, int& m_stone, int& m_water, int& m_snow,int& m_lava) {
+    int x = edit.pos.x, y = edit.pos.y, z = edit.pos.z;
+    if (!terrain.hasChunkAt(x, z)) {
+        return;
+    }
+    BlockType b = edit.placed;
+    BlockType blockType = edit.removed;
+    if (edit.kind == BlockEdit::PLACE) {
+        terrain.setBlockAt(x, y, z, b);
+        terrain.updateChunk(terrain.getChunkAt(x, z).get());
+        terrain.wakeFluidsAt(x, y, z);
 
-            if (b == GRASS){
-                m_grass --;
-            } if (b == DIRT){
-                m_dirt --;
-            } if (b == STONE){
-                m_stone --;
-            } if (b == WATER){
-                m_water --;
-            } if (b == SNOW){
-                m_snow --;
-            } if (b == LAVA){
-                m_lava --;
-            }
-        } else if (blockType != BEDROCK) {
-            if (blockType == REDSTONE_LEVER_OFF || blockType == REDSTONE_LEVER_ON) {
-                terrain.toggleLever(blockHit.x, blockHit.y, blockHit.z);
-                return void();
-            }
+        // redstone
+        if (redstoneBlocks.count(b)) {
+            terrain.setRedstoneItemAt(x, y, z, b);
+        }
 
-            thunk ->play();
-            // REMOVE BLOCK MODE --
-            // remove blockHit
-            terrain.setBlockAt(blockHit.x, blockHit.y, blockHit.z, EMPTY);
-            terrain.updateChunk(terrain.getChunkAt(blockHit.x, blockHit.z).get());
+        if (b == GRASS){
+            m_grass --;
+        } if (b == DIRT){
+            m_dirt --;
+        } if (b == STONE){
+            m_stone --;
+        } if (b == WATER){
+            m_water --;
+        } if (b == SNOW){
+            m_snow --;
+        } if (b == LAVA){
+            m_lava --;
+        }
+    } else if (edit.kind == BlockEdit::TOGGLE_LEVER) {
+        terrain.toggleLever(x, y, z);
+    } else {
+        // REMOVE BLOCK MODE --
+        // remove blockHit
+        terrain.setBlockAt(x, y, z, EMPTY);
+        terrain.updateChunk(terrain.getChunkAt(x, z).get());
+        terrain.wakeFluidsAt(x, y, z);
 
-            // redstone
-            if (redstoneBlocks.count(b)) {
-                terrain.removeRedstoneItemAt(blockHit.x, blockHit.y, blockHit.z, b);
-            }
+        // redstone
+        if (redstoneBlocks.count(b)) {
+            terrain.removeRedstoneItemAt(x, y, z, b);
+        }
 
 
-            if (blockType == GRASS){
-                m_grass ++;
-            } if (blockType == DIRT){
-                m_dirt ++;
-            } if (blockType == STONE){
-                m_stone ++;
-            } if (blockType == WATER){
-                m_water ++;
-            } if (blockType == SNOW){
-                m_snow ++;
-            } if (blockType == LAVA){
-                m_lava ++;
-            }
+        if (blockType == GRASS){
+            m_grass ++;
+        } if (blockType == DIRT){
+            m_dirt ++;
+        } if (blockType == STONE){
+            m_stone ++;
+        } if (blockType == WATER){
+            m_water ++;
+        } if (blockType == SNOW){
+            m_snow ++;
+        } if (blockType == LAVA){
+            m_lava ++;
         }
     }
 }
 
-void Player::processInputs(InputBundle &inputs) {
+void Player::processInputs(float dT, InputBundle &inputs) {
     // KEYBOARD CHANGES
     float acc = 40;
     m_acceleration = glm::vec3(0.0f);
@@ -122,7 +150,8 @@ void Player::processInputs(InputBundle &inputs) {
         }
     }
     if ((!flightMode || waterMode) && inputs.spacePressed) {
-        m_velocity.y += 5;
+        // Pushes for as long as space is held, 5 per step at PLAYER_TUNED_HZ
+        m_velocity.y += 5.f * dT * PLAYER_TUNED_HZ;
     }
 
     // MOUSE CHANGES
@@ -151,150 +180,42 @@ void Player::computePhysics(float dT, const Terrain &terrain) {
 
     m_acceleration += !flightMode ? gravity : glm::vec3();
     m_velocity += m_acceleration * dT;
-    m_velocity *= 0.9;
+    m_velocity *= glm::pow(0.9f, dT * PLAYER_TUNED_HZ);
     glm::vec3 finalMovement = m_velocity *dT;
 
-    for (double x = -0.5; x <= 0.5; x++) {
-        for (double z = -0.5; z <= 0.5; z++) {
-            for (double y = 0; y <= 2; y++) {
-                glm::vec3 rayOrigin = m_position + glm::vec3(x, y, z);
-                glm::vec3 blockHit;
+    // The blocks around everywhere the player could end up this tick
+    AABB box {m_position - glm::vec3(0.5f, 0.f, 0.5f), m_position + glm::vec3(0.5f, PLAYER_HEIGHT, 0.5f)};
+    glm::vec3 reach = glm::abs(finalMovement) + glm::vec3(0.f, PLAYER_STEP_HEIGHT, 0.f);
+    m_neighborhood.gather(terrain, glm::ivec3(glm::floor(box.min - reach)) - 1, glm::ivec3(glm::ceil(box.max + reach)) + 1);
 
-                for (int i = 0; i <= 2; i ++){
-                    float dist;
-                    glm::vec3 blockHit;
-                    glm::vec3 rayDirection = glm::vec3();
-                    BlockType blockType;
-                    rayDirection[i] = glm::sign(finalMovement[i]);
-                    if (gridMarch(rayOrigin, rayDirection, terrain, &dist, &blockHit, &blockType)) {
-                        // Player collided with terrain, move to the block hit point
-                        if (blockType == WATER || blockType == LAVA){
-                            if (glm::length(m_velocity) > 7) {
-                                m_velocity = glm::normalize(m_velocity);
-                                m_velocity *= 7;
-                                finalMovement = m_velocity *dT;
-                            } if (blockType == WATER) {
-                                waterMode = true;
-                                swimming->play();
-                            }
-                        } else if (!flightMode){
-                            waterMode = false;
-                            if (dist < 0.02){
-                                finalMovement[i] = 0;
-                                m_velocity[i] = 0;
-                            } else {
-                                finalMovement[i] = glm::min(glm::abs(finalMovement[i]), glm::abs(dist)) - 0.02;
-                                finalMovement[i] *= glm::sign(rayDirection)[i];
-                            }
-                        }
-                    }
-                }
-            }
+    AABB swept {glm::min(box.min, box.min + finalMovement), glm::max(box.max, box.max + finalMovement)};
+    bool inWater = overlapsBlock(m_neighborhood, swept, WATER);
+    if (inWater || overlapsBlock(m_neighborhood, swept, LAVA)) {
+        if (glm::length(m_velocity) > 7) {
+            m_velocity = glm::normalize(m_velocity);
+            m_velocity *= 7;
+            finalMovement = m_velocity *dT;
         }
     }
-    moveAlongVector(finalMovement);
-    // ALWAYS CALL MOVE ALONG VECTOR SO EVERYTHING IS SYNCED
-}
-
-
-
-bool Player::gridMarch(glm::vec3 rayOrigin, glm::vec3 rayDirection, const Terrain &terrain, float *out_dist, glm::vec3 *out_blockHit, BlockType *out_blockType) {
-    float maxLen = glm::length(rayDirection); // Farthest we search
-    glm::vec3 currCell = glm::vec3(glm::floor(rayOrigin));
-    rayDirection = glm::normalize(rayDirection); // Now all t values represent world dist.
+    if (inWater && !waterMode) {
+        swimming->play();
+    }
+    waterMode = inWater;
 
-    float curr_t = 0.f;
-    while(curr_t < maxLen) {
-        float min_t = glm::sqrt(3.f);
-        float interfaceAxis = -1; // Track axis for which t is smallest
-        for(int i = 0; i < 3; ++i) { // Iterate over the three axes
-            if(rayDirection[i] != 0) { // Is ray parallel to axis i?
-                float offset = glm::max(0.f, glm::sign(rayDirection[i])); // See slide 5
-                // If the player is *exactly* on an interface then
-                // they'll never move if they're looking in a negative direction
-                if(currCell[i] == rayOrigin[i] && offset == 0.f) {
-                    offset = -1.f;
-                }
-                int nextIntercept = currCell[i] + offset;
-                float axis_t = (nextIntercept - rayOrigin[i]) / rayDirection[i];
-                axis_t = glm::min(axis_t, maxLen); // Clamp to max len to avoid super out of bounds errors
-                if(axis_t < min_t) {
-                    min_t = axis_t;
-                    interfaceAxis = i;
-                }
+    if (!flightMode) {
+        SweepResult result = sweepAABB(m_neighborhood, box, finalMovement, PLAYER_STEP_HEIGHT);
+        for (int i = 0; i < 3; i++) {
+            if (result.blocked[i]) {
+                m_velocity[i] = 0;
             }
         }
-        if(interfaceAxis == -1) {
-            throw std::out_of_range("interfaceAxis was -1 after the for loop in gridMarch!");
-        }
-        curr_t += min_t; // min_t is declared in slide 7 algorithm
-        rayOrigin += rayDirection * min_t;
-        glm::vec3 offset = glm::vec3(0,0,0);
-        // Sets it to 0 if sign is +, -1 if sign is -
-        offset[interfaceAxis] = glm::min(0.f, glm::sign(rayDirection[interfaceAxis]));
-        currCell = glm::vec3(glm::floor(rayOrigin)) + offset;
-        // If currCell contains something other than EMPTY, return
-        // curr_t
-        BlockType cellType = terrain.getBlockAt(currCell.x, currCell.y, currCell.z);
-        if(cellType != EMPTY) {
-            *out_blockHit = currCell;
-            *out_dist = glm::min(maxLen, curr_t);
-            *out_blockType = cellType;
-            return true;
-        }
+        finalMovement = result.movement;
     }
-    *out_dist = glm::min(maxLen, curr_t);
-    return false;
+    moveAlongVector(finalMovement);
+    // ALWAYS CALL MOVE ALONG VECTOR SO EVERYTHING IS SYNCED
 }
 
-bool Player::gridMarchBlockBefore(glm::vec3 rayOrigin, glm::vec3 rayDirection, const Terrain &terrain, float *out_dist, glm::vec3 *out_blockHit) {
-    float maxLen = glm::length(rayDirection); // Farthest we search
-    glm::vec3 currCell = glm::vec3(glm::floor(rayOrigin));
-    rayDirection = glm::normalize(rayDirection); // Now all t values represent world dist.
 
-    float curr_t = 0.f;
-    while(curr_t < maxLen) {
-        float min_t = glm::sqrt(3.f);
-        float interfaceAxis = -1; // Track axis for which t is smallest
-        for(int i = 0; i < 3; ++i) { // Iterate over the three axes
-            if(rayDirection[i] != 0) { // Is ray parallel to axis i?
-                float offset = glm::max(0.f, glm::sign(rayDirection[i])); // See slide 5
-                // If the player is *exactly* on an interface then
-                // they'll never move if they're looking in a negative direction
-                if(currCell[i] == rayOrigin[i] && offset == 0.f) {
-                    offset = -1.f;
-                }
-                int nextIntercept = currCell[i] + offset;
-                float axis_t = (nextIntercept - rayOrigin[i]) / rayDirection[i];
-                axis_t = glm::min(axis_t, maxLen); // Clamp to max len to avoid super out of bounds errors
-                if(axis_t < min_t) {
-                    min_t = axis_t;
-                    interfaceAxis = i;
-                }
-            }
-        }
-        if(interfaceAxis == -1) {
-            throw std::out_of_range("interfaceAxis was -1 after the for loop in gridMarch!");
-        }
-        curr_t += min_t; // min_t is declared in slide 7 algorithm
-        rayOrigin += rayDirection * min_t;
-        glm::vec3 offset = glm::vec3(0,0,0);
-        // Sets it to 0 if sign is +, -1 if sign is -
-        offset[interfaceAxis] = glm::min(0.f, glm::sign(rayDirection[interfaceAxis]));
-        glm::vec3 nextCell = glm::vec3(glm::floor(rayOrigin)) + offset;
-        // If currCell contains something other than EMPTY, return
-        // curr_t
-        BlockType cellType = terrain.getBlockAt(nextCell.x, nextCell.y, nextCell.z);
-        if(cellType != EMPTY) {
-            *out_blockHit = currCell;
-            *out_dist = glm::min(maxLen, curr_t);
-            return true;
-        }
-        currCell = nextCell;
-    }
-    *out_dist = glm::min(maxLen, curr_t);
-    return false;
-}
 
 void Player::setCameraWidthHeight(unsigned int w, unsigned int h) {
     m_camera.setWidthHeight(w, h);
@@ -352,6 +273,12 @@ void Player::rotateOnUpGlobal(float degrees) {
     Entity::rotateOnUpGlobal(degrees);
     m_camera.rotateOnUpGlobal(degrees);
 }
+void Player::setPose(glm::vec3 pos, glm::vec3 forward) {
+    Entity::setPose(pos, forward);
+    // A jump, not a movement to draw frames along
+    m_previousPosition = pos;
+    m_camera.setPose(pos + glm::vec3(0, 1.5f, 0), forward);
+}
 
 QString Player::posAsQString() const {
     std::string str("( " + std::to_string(m_position.x) + ", " + std::to_string(m_position.y) + ", " + std::to_string(m_position.z) + ")");
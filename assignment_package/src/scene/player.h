@@ -2,18 +2,42 @@
 #include "entity.h"
 #include "camera.h"
 #include "terrain.h"
+#include "voxelcollision.h"
 #include <QObject>
 #include <QtMultimedia>
 
+// Height of the player's box, which is a block wide and stands on its position
+#define PLAYER_HEIGHT 2.f
+// Highest ledge the player walks up without jumping. Under a block, so
+// climbing onto a full block still takes a jump.
+#define PLAYER_STEP_HEIGHT 0.5f
+// Steps per second the jump push and velocity damping were tuned at. Both
+// are scaled from it, so the player moves the same at any --sim-hz.
+#define PLAYER_TUNED_HZ 60.f
+
+// What one editBlock() did to the world, so it can be done again without
+// aiming. removed is the block the ray hit and placed is what the caller
+// asked for, whichever kind of edit it turned out to be.
+struct BlockEdit {
+    enum Kind : unsigned char {
+        PLACE, REMOVE, TOGGLE_LEVER
+    };
+    Kind kind;
+    glm::ivec3 pos;
+    BlockType placed, removed;
+};
+
 class Player : public Entity {
 private:
     glm::vec3 m_velocity, m_acceleration;
+    glm::vec3 m_previousPosition; // Where the last tick() started
+    VoxelNeighborhood m_neighborhood; // Blocks around the player, gathered every tick
 
     Camera m_camera;
     const Terrain &mcr_terrain;
     const double m_maxSpeed = 20;
 
-    void processInputs(InputBundle &inputs);
+    void processInputs(float dT, InputBundle &inputs);
     void computePhysics(float dT, const Terrain &terrain);
 
 public:
@@ -33,6 +57,9 @@ public:
     void setCameraWidthHeight(unsigned int w, unsigned int h);
 
     void tick(float dT, InputBundle &input) override;
+    // The camera as it would be alpha of the way through the last tick(),
+    // for drawing frames that land between ticks
+    Camera interpolatedCamera(float alpha) const;
 
     // Player overrides all of Entity's movement
     // functions so that it transforms its camera
@@ -50,6 +77,7 @@ public:
     void rotateOnForwardGlobal(float degrees) override;
     void rotateOnRightGlobal(float degrees) override;
     void rotateOnUpGlobal(float degrees) override;
+    void setPose(glm::vec3 pos, glm::vec3 forward) override;
 
     // For sending the Player's data to the GUI
     // for display
@@ -59,10 +87,15 @@ public:
     QString lookAsQString() const;
 
     void collideWithTerrain(glm::vec3& playerPos, glm::vec3 velocity, const Terrain& terrain);
-    bool gridMarch(glm::vec3 rayOrigin, glm::vec3 rayDirection, const Terrain &terrain, float *out_dist, glm::vec3 *out_blockHit, BlockType *out_blocktype);
-    bool gridMarchBlockBefore(glm::vec3 rayOrigin, glm::vec3 rayDirection, const Terrain &terrain, float *out_dist, glm::vec3 *out_blockHit);
 
-    void editBlock(InputBundle &inputs, Terrain &terrain, bool mode, BlockType b, int& m_grass, int& m_dirt, int& m_stone, int& m_water, int& m_snow,int& m_lava);
+    // Adds (mode true) or removes the block the camera is looking at.
+    // Returns false if it is looking at nothing in reach; otherwise
+    // out_edit, if given, is set to what was done.
+    bool editBlock(InputBundle &inputs, Terrain &terrain, bool mode, BlockType b, int& m_grass, int& m_dirt, int& m_stone, int& m_water, int& m_snow,int& m_lava,
+                   BlockEdit *out_edit = nullptr);
+    // The part of editBlock() after aiming. Does nothing if the edit's
+    // chunk doesn't exist.
+    void applyEdit(const BlockEdit &edit, Terrain &terrain, int& m_grass, int& m_dirt, int& m_stone, int& m_water, int& m_snow,int& m_lava);
 
 
 };
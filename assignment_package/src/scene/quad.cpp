@@ -22,17 +22,17 @@ void Quad::createVBOdata()
     generateIdx();
     // Tell OpenGL that we want to perform subsequent operations on the VBO referred to by bufIdx
     // and that it will be treated as an element array buffer (since it will contain triangle indices)
-    mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufIdx);
+    mp_context->bindIndexBuffer(m_bufIdx);
     // Pass the data stored in cyl_idx into the bound buffer, reading a number of bytes equal to
     // CYL_IDX_COUNT multiplied by the size of a GLuint. This data is sent to the GPU to be read by shader programs.
-    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, 6 * sizeof(GLuint), idx, GL_STATIC_DRAW);
+    mp_context->bufferDataTracked(GL_ELEMENT_ARRAY_BUFFER, m_bufIdx, 6 * sizeof(GLuint), idx, GL_STATIC_DRAW);
 
     // The next few sets of function calls are basically the same as above, except bufPos and bufNor are
     // array buffers rather than element array buffers, as they store vertex attributes like position.
     generatePos();
     mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufPos);
-    mp_context->glBufferData(GL_ARRAY_BUFFER, 4 * sizeof(glm::vec4), vert_pos, GL_STATIC_DRAW);
+    mp_context->bufferDataTracked(GL_ARRAY_BUFFER, m_bufPos, 4 * sizeof(glm::vec4), vert_pos, GL_STATIC_DRAW);
     generateUV();
     mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufUV);
-    mp_context->glBufferData(GL_ARRAY_BUFFER, 4 * sizeof(glm::vec2), vert_UV, GL_STATIC_DRAW);
+    mp_context->bufferDataTracked(GL_ARRAY_BUFFER, m_bufUV, 4 * sizeof(glm::vec2), vert_UV, GL_STATIC_DRAW);
 }
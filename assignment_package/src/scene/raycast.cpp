@@ -0,0 +1,82 @@
+#include "raycast.h"
+#include <limits>
+
+// Index into ChunkData::blocks() of chunk-space p
+static inline int blockIndex(glm::ivec3 p) {
+    return p.x + 16 * p.y + 16 * 256 * p.z;
+}
+
+bool raycastFrom(const ChunkData *chunk, glm::vec3 origin, glm::vec3 direction, float maxDistance, RayHit *out_hit) {
+    out_hit->type = EMPTY;
+    float length = glm::length(direction);
+    if (chunk == nullptr || length == 0.f) {
+        return false;
+    }
+    direction /= length;
+
+    glm::ivec3 cell(glm::floor(origin));
+    glm::ivec3 step(glm::sign(direction));
+    // Distance along the ray to the next cell boundary on each axis, and
+    // between boundaries on each axis
+    const float never = std::numeric_limits<float>::infinity();
+    glm::vec3 tMax(never), tDelta(never);
+    for (int axis = 0; axis < 3; axis++) {
+        if (step[axis] != 0) {
+            tDelta[axis] = 1.f / glm::abs(direction[axis]);
+            float boundary = step[axis] > 0 ? cell[axis] + 1.f : static_cast<float>(cell[axis]);
+            tMax[axis] = (boundary - origin[axis]) / direction[axis];
+        }
+    }
+
+    // Where the cell is within the chunk, and its index into the blocks.
+    // The index keeps stepping while the ray is above or below the world,
+    // but is only read inside it.
+    glm::ivec2 corner = chunk->getCoords();
+    glm::ivec3 local(cell.x - corner.x, cell.y, cell.z - corner.y);
+    const glm::ivec3 stride(1, 16, 16 * 256);
+    const BlockType *blocks = chunk->blocks().data();
+    int index = blockIndex(local);
+
+    while (true) {
+        int axis = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+        float t = tMax[axis];
+        if (t > maxDistance) {
+            return false;
+        }
+        glm::ivec3 previous = cell;
+        cell[axis] += step[axis];
+        local[axis] += step[axis];
+        index += step[axis] * stride[axis];
+        tMax[axis] += tDelta[axis];
+
+        if (axis == 1) {
+            // Nothing out there to hit, and no coming back
+            if ((cell.y < 0 && step.y < 0) || (cell.y >= 256 && step.y > 0)) {
+                return false;
+            }
+        } else if (local[axis] < 0 || local[axis] >= 16) {
+            Direction dir = axis == 0 ? (step.x > 0 ? XPOS : XNEG) : (step.z > 0 ? ZPOS : ZNEG);
+            chunk = chunk->neighbor(dir);
+            if (chunk == nullptr) {
+                return false;
+            }
+            local[axis] -= 16 * step[axis];
+            blocks = chunk->blocks().data();
+            index = blockIndex(local);
+        }
+        if (cell.y < 0 || cell.y >= 256) {
+            continue;
+        }
+
+        BlockType type = blocks[index];
+        if (type != EMPTY) {
+            out_hit->type = type;
+            out_hit->cell = cell;
+            out_hit->normal = glm::ivec3(0);
+            out_hit->normal[axis] = -step[axis];
+            out_hit->previous = previous;
+            out_hit->distance = t;
+            return true;
+        }
+    }
+}
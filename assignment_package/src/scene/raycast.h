@@ -0,0 +1,58 @@
+#pragma once
+#include "chunkdata.h"
+#include <vector>
+
+// A ray for raycastBatch(). direction needn't be normalized; maxDistance
+// is in blocks either way.
+struct Ray {
+    glm::vec3 origin, direction;
+    float maxDistance;
+};
+
+struct RayHit {
+    BlockType type; // EMPTY if the ray hit nothing
+    glm::ivec3 cell; // The block hit
+    glm::ivec3 normal; // Outward normal of the face the ray entered it through
+    glm::ivec3 previous; // The cell before it, where a block placed on that face goes
+    float distance; // Along the ray to that face
+};
+
+// Steps from cell to cell along the ray with integer DDA until it enters a
+// block that isn't EMPTY, or goes further than maxDistance. The cell the
+// ray starts in never counts. Blocks are read by index within the current
+// chunk, which is only changed, through its neighbour links, when the ray
+// crosses into another. Reaching a chunk that isn't loaded, or leaving the
+// world through its top or bottom, is a miss.
+// chunk is the chunk containing origin, or nullptr for a miss.
+bool raycastFrom(const ChunkData *chunk, glm::vec3 origin, glm::vec3 direction, float maxDistance, RayHit *out_hit);
+
+// The same, finding the starting chunk in world. World is anything with
+// hasChunkAt(x, z) and getChunkAt(x, z) in world coordinates, such as Terrain.
+template <typename World>
+bool raycast(const World &world, glm::vec3 origin, glm::vec3 direction, float maxDistance, RayHit *out_hit) {
+    glm::ivec3 cell(glm::floor(origin));
+    const ChunkData *chunk = world.hasChunkAt(cell.x, cell.z) ? &*world.getChunkAt(cell.x, cell.z) : nullptr;
+    return raycastFrom(chunk, origin, direction, maxDistance, out_hit);
+}
+
+// Casts every ray, for callers with many at once (AI line of sight,
+// particles, visibility). out_hits gets one entry per ray, in order, with
+// type EMPTY for misses. Runs of rays starting in the same chunk look it up
+// once. Returns the number of hits.
+template <typename World>
+int raycastBatch(const World &world, const std::vector<Ray> &rays, std::vector<RayHit> *out_hits) {
+    out_hits->resize(rays.size());
+    int hits = 0;
+    const ChunkData *chunk = nullptr;
+    glm::ivec2 chunkCoords;
+    for (size_t i = 0; i < rays.size(); i++) {
+        glm::ivec3 cell(glm::floor(rays[i].origin));
+        glm::ivec2 coords = 16 * glm::ivec2(glm::floor(glm::vec2(cell.x, cell.z) / 16.f));
+        if (i == 0 || coords != chunkCoords) {
+            chunk = world.hasChunkAt(cell.x, cell.z) ? &*world.getChunkAt(cell.x, cell.z) : nullptr;
+            chunkCoords = coords;
+        }
+        hits += raycastFrom(chunk, rays[i].origin, rays[i].direction, rays[i].maxDistance, &(*out_hits)[i]);
+    }
+    return hits;
+}
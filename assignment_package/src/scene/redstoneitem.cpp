@@ -1,6 +1,11 @@
 #include "redstoneitem.h"
 #include <iostream>
 
+RedstoneItem::RedstoneItem()
+    : pos(), currentState(false), stateChanged(false), updatedThisCycle(false), neighbors{},
+      trackedBytes(MEM_REDSTONE, sizeof(RedstoneItem))
+{}
+
 bool RedstoneItem::getState() {
     return currentState;
 }
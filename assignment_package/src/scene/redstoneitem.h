@@ -2,6 +2,7 @@
 
 #include "glm/glm.hpp"
 #include "scene/chunkhelpers.h"
+#include "memorystats.h"
 
 class RedstoneItem {
 protected:
@@ -10,7 +11,9 @@ protected:
     bool stateChanged;
     bool updatedThisCycle;
     std::array<RedstoneItem*, 6> neighbors;
+    TrackedBytes trackedBytes;
 
+    RedstoneItem();
     void setupBaseClassMembers(glm::ivec3 pos, bool currentState);
 
 public:
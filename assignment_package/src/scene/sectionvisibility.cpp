@@ -0,0 +1,137 @@
+#include "sectionvisibility.h"
+#include <vector>
+
+// Set on sections with no see-through blocks at all
+#define SECTION_SOLID_BIT (1 << 15)
+
+SectionVisibility::SectionVisibility()
+    : m_mask(0)
+{}
+
+SectionVisibility::SectionVisibility(uint16_t mask)
+    : m_mask(mask)
+{}
+
+SectionVisibility SectionVisibility::allOpen() {
+    return SectionVisibility(0x7fff);
+}
+
+// Maps an unordered pair of distinct faces onto bits 0 - 14
+int SectionVisibility::pairBit(Direction a, Direction b) {
+    int lo = a < b ? a : b;
+    int hi = a < b ? b : a;
+    return lo * (11 - lo) / 2 + (hi - lo - 1);
+}
+
+void SectionVisibility::connect(Direction a, Direction b) {
+    if (a != b) {
+        m_mask |= (1 << pairBit(a, b));
+    }
+}
+
+bool SectionVisibility::canSeeThrough(Direction a, Direction b) const {
+    if (a == b) {
+        return (m_mask & ~SECTION_SOLID_BIT) != 0;
+    }
+    return m_mask & (1 << pairBit(a, b));
+}
+
+bool SectionVisibility::isSolid() const {
+    return m_mask & SECTION_SOLID_BIT;
+}
+
+uint16_t SectionVisibility::mask() const {
+    return m_mask;
+}
+
+SectionVisibility SectionVisibility::compute(const std::array<BlockType, 65536> &blocks, int section) {
+    constexpr int N = SECTION_SIZE;
+    constexpr int CELLS = N * N * N;
+    int yBase = section * N;
+
+    // Local cell index is x + 16 * y + 256 * z, the same layout Chunk uses
+    std::array<bool, CELLS> visited {};
+    int numOpen = 0;
+    for (int z = 0; z < N; z++) {
+        for (int y = 0; y < N; y++) {
+            for (int x = 0; x < N; x++) {
+                bool opaque = occludesView(blocks[x + 16 * (yBase + y) + 16 * 256 * z]);
+                visited[x + N * y + N * N * z] = opaque;
+                numOpen += !opaque;
+            }
+        }
+    }
+
+    // Solid stone and open sky are by far the most common cases
+    if (numOpen == 0) {
+        return SectionVisibility(SECTION_SOLID_BIT);
+    }
+    if (numOpen == CELLS) {
+        return allOpen();
+    }
+
+    SectionVisibility result;
+    std::vector<uint16_t> stack;
+    stack.reserve(CELLS);
+
+    for (int start = 0; start < CELLS; start++) {
+        if (visited[start]) {
+            continue;
+        }
+
+        // Flood fill one connected pocket of see-through blocks
+        uint8_t facesTouched = 0;
+        visited[start] = true;
+        stack.push_back(start);
+        while (!stack.empty()) {
+            int idx = stack.back();
+            stack.pop_back();
+            int x = idx % N;
+            int y = (idx / N) % N;
+            int z = idx / (N * N);
+
+            if (x == 0)     facesTouched |= (1 << XNEG);
+            if (x == N - 1) facesTouched |= (1 << XPOS);
+            if (y == 0)     facesTouched |= (1 << YNEG);
+            if (y == N - 1) facesTouched |= (1 << YPOS);
+            if (z == 0)     facesTouched |= (1 << ZNEG);
+            if (z == N - 1) facesTouched |= (1 << ZPOS);
+
+            const int neighbors[6] = {
+                x > 0     ? idx - 1     : -1,
+                x < N - 1 ? idx + 1     : -1,
+                y > 0     ? idx - N     : -1,
+                y < N - 1 ? idx + N     : -1,
+                z > 0     ? idx - N * N : -1,
+                z < N - 1 ? idx + N * N : -1
+            };
+            for (int n : neighbors) {
+                if (n >= 0 && !visited[n]) {
+                    visited[n] = true;
+                    stack.push_back(n);
+                }
+            }
+        }
+
+        for (int a = 0; a < 6; a++) {
+            for (int b = a + 1; b < 6; b++) {
+                if ((facesTouched & (1 << a)) && (facesTouched & (1 << b))) {
+                    result.connect(static_cast<Direction>(a), static_cast<Direction>(b));
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+Direction oppositeOf(Direction dir) {
+    switch (dir) {
+    case XPOS: return XNEG;
+    case XNEG: return XPOS;
+    case YPOS: return YNEG;
+    case YNEG: return YPOS;
+    case ZPOS: return ZNEG;
+    default:   return ZPOS;
+    }
+}
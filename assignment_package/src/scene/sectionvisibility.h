@@ -0,0 +1,41 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include "chunkhelpers.h"
+
+// Every Chunk is split vertically into sixteen 16 x 16 x 16 sections.
+// Sections are the unit of cave culling: the mesh worker records which
+// faces of a section can see each other, and Terrain::draw walks that
+// graph outward from the camera to skip sections that are sealed off.
+#define SECTION_SIZE 16
+#define SECTIONS_PER_CHUNK 16
+
+// A bitmask over the 15 unordered pairs of a section's six faces.
+// Bit (a, b) is set when some path of non-opaque blocks inside the
+// section touches both face a and face b. The top bit marks sections
+// made entirely of opaque blocks, which can be used as occluders.
+class SectionVisibility {
+private:
+    uint16_t m_mask;
+
+    static int pairBit(Direction a, Direction b);
+
+public:
+    SectionVisibility();
+    explicit SectionVisibility(uint16_t mask);
+
+    // Every face sees every other face, e.g. a section full of air.
+    static SectionVisibility allOpen();
+
+    // Flood fills the given section of a chunk's block array through
+    // non-opaque blocks and records which faces each pocket touches.
+    static SectionVisibility compute(const std::array<BlockType, 65536> &blocks, int section);
+
+    void connect(Direction a, Direction b);
+    bool canSeeThrough(Direction a, Direction b) const;
+    bool isSolid() const;
+    uint16_t mask() const;
+};
+
+// The face on the other side of the boundary crossed when moving in dir
+Direction oppositeOf(Direction dir);
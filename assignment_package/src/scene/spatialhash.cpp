@@ -0,0 +1,29 @@
+#include "spatialhash.h"
+
+ChunkSpatialHash::ChunkSpatialHash(int cellSize)
+    : m_cellSize(cellSize), m_cells(), m_entries(), m_keys()
+{}
+
+void ChunkSpatialHash::rebuild(const std::vector<glm::vec3> &positions) {
+    m_cells.clear();
+    m_keys.resize(positions.size());
+    float size = static_cast<float>(m_cellSize);
+    for (size_t i = 0; i < positions.size(); i++) {
+        int x = m_cellSize * static_cast<int>(glm::floor(positions[i].x / size));
+        int z = m_cellSize * static_cast<int>(glm::floor(positions[i].z / size));
+        m_keys[i] = toKey(x, z);
+        m_cells[m_keys[i]].second++;
+    }
+    int start = 0;
+    for (auto &cell : m_cells) {
+        cell.second.first = start;
+        start += cell.second.second;
+        // Counts back up again as the run is filled in
+        cell.second.second = 0;
+    }
+    m_entries.resize(positions.size());
+    for (size_t i = 0; i < positions.size(); i++) {
+        std::pair<int, int> &cell = m_cells[m_keys[i]];
+        m_entries[cell.first + cell.second++] = static_cast<int>(i);
+    }
+}
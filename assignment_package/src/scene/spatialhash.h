@@ -0,0 +1,49 @@
+#pragma once
+#include "chunkdata.h"
+#include <unordered_map>
+#include <vector>
+
+// Points bucketed by square columns of the world, for finding the ones
+// near a spot without looking at all of them. The columns' width divides
+// a chunk's, so no column straddles two chunks. Rebuilt from scratch
+// rather than updated as things move: a counting sort by column leaves
+// each column's points in one contiguous run.
+class ChunkSpatialHash {
+private:
+    int m_cellSize;
+    // Where each column's run starts in m_entries, and its length, by the
+    // column's corner
+    std::unordered_map<int64_t, std::pair<int, int>> m_cells;
+    std::vector<int> m_entries; // Indices into the positions last given to rebuild()
+    std::vector<int64_t> m_keys; // Scratch, one per position
+
+public:
+    // cellSize must divide 16
+    explicit ChunkSpatialHash(int cellSize = 16);
+
+    void rebuild(const std::vector<glm::vec3> &positions);
+
+    // Calls fn(i) for the index of every position in the columns that the
+    // square of the given radius around center overlaps. Some may be
+    // further away than radius; callers check the distance themselves.
+    template <typename Fn>
+    void forEachNear(glm::vec3 center, float radius, Fn fn) const;
+};
+
+template <typename Fn>
+void ChunkSpatialHash::forEachNear(glm::vec3 center, float radius, Fn fn) const {
+    float size = static_cast<float>(m_cellSize);
+    int x0 = m_cellSize * static_cast<int>(glm::floor((center.x - radius) / size));
+    int z0 = m_cellSize * static_cast<int>(glm::floor((center.z - radius) / size));
+    for (int x = x0; x <= center.x + radius; x += m_cellSize) {
+        for (int z = z0; z <= center.z + radius; z += m_cellSize) {
+            auto it = m_cells.find(toKey(x, z));
+            if (it == m_cells.end()) {
+                continue;
+            }
+            for (int i = it->second.first; i < it->second.first + it->second.second; i++) {
+                fn(m_entries[i]);
+            }
+        }
+    }
+}
@@ -1,48 +1,29 @@
 #include "terrain.h"
 #include "scene/chunkworkers.h"
+#include "tracer.h"
 #include <stdexcept>
 #include <iostream>
 #include <cmath>
 #include <random>
+#include <deque>
 #include <QtCore/QThreadPool>
 
-// Combine two 32-bit ints into one 64-bit int
-// where the upper 32 bits are X and the lower 32 bits are Z
-int64_t toKey(int x, int z) {
-    int64_t xz = 0xffffffffffffffff;
-    int64_t x64 = x;
-    int64_t z64 = z;
-
-    // Set all lower 32 bits to 1 so we can & with Z later
-    xz = (xz & (x64 << 32)) | 0x00000000ffffffff;
-
-    // Set all upper 32 bits to 1 so we can & with XZ
-    z64 = z64 | 0xffffffff00000000;
-
-    // Combine
-    xz = xz & z64;
-    return xz;
-}
-
-glm::ivec2 toCoords(int64_t k) {
-    // Z is lower 32 bits
-    int64_t z = k & 0x00000000ffffffff;
-    // If the most significant bit of Z is 1, then it's a negative number
-    // so we have to set all the upper 32 bits to 1.
-    // Note the 8    V
-    if(z & 0x0000000080000000) {
-        z = z | 0xffffffff00000000;
-    }
-    int64_t x = (k >> 32);
-
-    return glm::ivec2(x, z);
-}
-
 Terrain::Terrain(OpenGLContext *context)
-    : m_chunks(), m_generatedTerrain(),
+    : m_chunks(), m_generatedTerrain(), m_residentZones(), m_meshCache(),
       m_chunksWithVBOsMutex(), m_chunksWithVBOs{},
       m_chunksWithBlockDataMutex(), m_chunksWithBlockData{},
+      m_chunksWithSortsMutex(), m_chunksWithSorts{},
+      m_sortEye(0.f), m_sortCell(transparencySortCell(m_sortEye)), m_sortsUploaded(0),
+      m_drawRadius(TERRAIN_DRAW_RADIUS), m_createRadius(TERRAIN_CREATE_RADIUS),
+      m_zoneShape(ZoneShape::SQUARE), m_meshesInFlight(0),
+      m_farTerrain(context), m_farTerrainCenter(0, 0), m_farTerrainRadius(0),
+      m_lodEnabled(true),
       redstoneItems{}, redstoneSources{},
+      m_decorationMeshes{},
+      m_sectionCulling(true),
+      m_occlusionCulling(true), m_occlusionCuller(), m_fluids(), m_counters{0, 0, 0, 0}, mp_profiler(nullptr),
+      m_sectionsConsidered(0), m_sectionsOccluded(0), m_sectionsDrawn(0),
+      m_chunksConsidered(0), m_chunksOccluded(0),
       mp_context(context)
 {}
 
@@ -50,6 +31,11 @@ Terrain::~Terrain() {
     for (auto &chunk : m_chunks) {
         chunk.second->destroyVBOdata();
     }
+    for (uPtr<DecorationMesh> &mesh : m_decorationMeshes) {
+        if (mesh != nullptr) {
+            mesh->destroyVBOdata();
+        }
+    }
 }
 
 // Surround calls to this with try-catch if you don't know whether
@@ -129,6 +115,22 @@ void Terrain::setBlockAt(int x, int y, int z, BlockType t)
     }
 }
 
+void Terrain::setDecorationAt(int x, int y, int z, BlockType t) {
+    uPtr<Chunk> &c = getChunkAt(x, z);
+    glm::ivec2 local = glm::ivec2(x, z) - c->getCoords();
+    if (!c->updateDecoration(local.x, y, local.y, t)) {
+        setBlockAt(x, y, z, t);
+        updateChunk(c.get());
+    }
+}
+
+void Terrain::createDecorationMeshes() {
+    for (int s = 0; s < DECORATION_SHAPE_COUNT; s++) {
+        m_decorationMeshes[s] = mkU<DecorationMesh>(mp_context, static_cast<DecorationShape>(s));
+        m_decorationMeshes[s]->createVBOdata();
+    }
+}
+
 void Terrain::redrawZoneEdgeChunks(Chunk *c) {
     int64_t id = toKey(floor(c->chunkX / 64.f) * 64,
                        floor(c->chunkZ / 64.f) * 64);
@@ -147,41 +149,50 @@ Chunk* Terrain::instantiateChunkAt(int x, int z) {
     // Set the neighbor pointers of itself and its neighbors
     if(hasChunkAt(x, z + 16)) {
         auto &chunkNorth = m_chunks[toKey(x, z + 16)];
-        cPtr->linkNeighbor(chunkNorth, ZPOS);
+        cPtr->linkNeighbor(chunkNorth.get(), ZPOS);
         redrawZoneEdgeChunks(chunkNorth.get());
     }
     if(hasChunkAt(x, z - 16)) {
         auto &chunkSouth = m_chunks[toKey(x, z - 16)];
-        cPtr->linkNeighbor(chunkSouth, ZNEG);
+        cPtr->linkNeighbor(chunkSouth.get(), ZNEG);
         redrawZoneEdgeChunks(chunkSouth.get());
     }
     if(hasChunkAt(x + 16, z)) {
         auto &chunkEast = m_chunks[toKey(x + 16, z)];
-        cPtr->linkNeighbor(chunkEast, XPOS);
+        cPtr->linkNeighbor(chunkEast.get(), XPOS);
         redrawZoneEdgeChunks(chunkEast.get());
     }
     if(hasChunkAt(x - 16, z)) {
         auto &chunkWest = m_chunks[toKey(x - 16, z)];
-        cPtr->linkNeighbor(chunkWest, XNEG);
+        cPtr->linkNeighbor(chunkWest.get(), XNEG);
         redrawZoneEdgeChunks(chunkWest.get());
     }
     return cPtr;
 }
 
-class ChunkDistanceFromPlayerChunk {
-private:
-    const glm::vec2 chunkPos;
-
-public:
-    ChunkDistanceFromPlayerChunk(const glm::vec3 &playerPos)
-        : chunkPos({glm::floor(playerPos.x / 16.f) * 16.f,
-                    glm::floor(playerPos.z / 16.f) * 16.f})
-    {}
-
-    bool operator() (Chunk *a, Chunk *b) {
-        return glm::distance(glm::vec2(a->getCoords()), chunkPos) > glm::distance(glm::vec2(b->getCoords()), chunkPos);
+// Merges runs of consecutive visible sections into single
+// (first index, index count) ranges, dropping empty ones
+static std::vector<glm::ivec2> sectionRanges(const std::array<unsigned int, SECTIONS_PER_CHUNK + 1> &offsets,
+                                             uint16_t visibleSections) {
+    std::vector<glm::ivec2> ranges;
+    int s = 0;
+    while (s < SECTIONS_PER_CHUNK) {
+        if (!(visibleSections & (1 << s))) {
+            s++;
+            continue;
+        }
+        int end = s;
+        while (end + 1 < SECTIONS_PER_CHUNK && (visibleSections & (1 << (end + 1)))) {
+            end++;
+        }
+        int count = offsets[end + 1] - offsets[s];
+        if (count > 0) {
+            ranges.push_back(glm::ivec2(offsets[s], count));
+        }
+        s = end + 1;
     }
-};
+    return ranges;
+}
 
 // TODO: When you make Chunk inherit from Drawable, change this code so
 // it draws each Chunk with the given ShaderProgram, remembering to set the
@@ -195,55 +206,425 @@ public:
 // create blocks for any zones w/o vbo data but has block type data
 // only call initial create the first time you join
 // expand only every 10 ticks
-void Terrain::draw(const glm::vec3 &playerPos, ShaderProgram *shaderProgram) {
+void Terrain::draw(const glm::vec3 &playerPos, const glm::vec3 &cameraPos, const glm::mat4 &viewProj,
+                   ShaderProgram *shaderProgram, ShaderProgram *decorationProgram) {
+    // Gathering and culling chunks counts towards the opaque half
+    ScopedStageTimer opaqueTimer(mp_profiler, STAGE_DRAW_OPAQUE);
     glm::ivec2 currZone { 64.f * glm::floor(playerPos.x / 64.f), 64.f * glm::floor(playerPos.z / 64.f) };
-    QSet<int64_t> terrainZonesToDraw = terrainZonesBorderingZone(currZone, TERRAIN_DRAW_RADIUS, false);
+    QSet<int64_t> terrainZonesToDraw = terrainZonesBorderingZone(currZone, m_drawRadius, false);
 
+    std::vector<Chunk*> chunksToDraw {};
     for (int64_t id : terrainZonesToDraw) {
         glm::ivec2 coord = toCoords(id);
         for (int x = coord.x; x < coord.x + 64; x += 16) {
             for (int z = coord.y; z < coord.y + 64; z += 16) {
                 if (hasChunkAt(x, z)) {
-                    uPtr<Chunk> &c = getChunkAt(x, z);
-                    shaderProgram->setModelMatrix(glm::mat4(1.0));
-                    shaderProgram->drawOpaque(*(c.get()));
+                    chunksToDraw.push_back(getChunkAt(x, z).get());
                 }
             }
         }
     }
 
-    std::vector<Chunk*> chunkTransparentToDraw {};
+    std::unordered_set<Chunk*> chunksChangingLOD;
+    for (Chunk *c : chunksToDraw) {
+        if (updateChunkLOD(c, playerPos)) {
+            chunksChangingLOD.insert(c);
+        }
+    }
+    if (!chunksChangingLOD.empty()) {
+        // Spawned alongside edited chunks in checkThreadResults
+        m_chunksWithBlockDataMutex.lock();
+        m_chunksWithBlockData.insert(chunksChangingLOD.begin(), chunksChangingLOD.end());
+        m_chunksWithBlockDataMutex.unlock();
+    }
+
+    std::unordered_map<Chunk*, uint16_t> visibleSections;
+    if (m_sectionCulling) {
+        visibleSections = findVisibleSections(cameraPos, std::unordered_set<Chunk*>(chunksToDraw.begin(), chunksToDraw.end()));
+    } else {
+        for (Chunk *c : chunksToDraw) {
+            visibleSections[c] = 0xffff;
+        }
+    }
+
+    m_sectionsConsidered = m_sectionsOccluded = m_sectionsDrawn = 0;
+    m_chunksConsidered = m_chunksOccluded = 0;
+    if (m_occlusionCulling) {
+        occlusionCull(cameraPos, viewProj, chunksToDraw, visibleSections);
+    }
+
+    for (Chunk *c : chunksToDraw) {
+        m_meshCache.touch(c);
+        auto vis = visibleSections.find(c);
+        if (vis == visibleSections.end()) {
+            continue;
+        }
+        for (int s = 0; s < SECTIONS_PER_CHUNK; s++) {
+            m_sectionsDrawn += (vis->second >> s) & 1;
+        }
+        std::vector<glm::ivec2> ranges = sectionRanges(c->m_sectionIdxOpq, vis->second);
+        if (!ranges.empty()) {
+            shaderProgram->setChunkOrigin(glm::vec3(c->chunkX, 0.f, c->chunkZ));
+            shaderProgram->drawOpaque(*c, ranges);
+        }
+    }
+
+    // Decorations are cut out rather than blended, so they can go with the
+    // opaque geometry. Every chunk draws its instances of each shape at once.
+    for (Chunk *c : chunksToDraw) {
+        if (!visibleSections.count(c) || !c->m_decorationsGenerated) {
+            continue;
+        }
+        for (int s = 0; s < DECORATION_SHAPE_COUNT; s++) {
+            int count = c->m_decorationOffsets[s + 1] - c->m_decorationOffsets[s];
+            if (count > 0) {
+                decorationProgram->setChunkOrigin(glm::vec3(c->chunkX, 0.f, c->chunkZ));
+                decorationProgram->drawInstanced(*m_decorationMeshes[s], c->m_bufDecorations,
+                                                 c->m_decorationOffsets[s], count);
+            }
+        }
+    }
+
+    // Zones drawn as chunks don't need their far tiles any more
+    std::unordered_set<int64_t> coveredZones;
     for (int64_t id : terrainZonesToDraw) {
-        glm::ivec2 coord = toCoords(id);
-        for (int x = coord.x; x < coord.x + 64; x += 16) {
-            for (int z = coord.y; z < coord.y + 64; z += 16) {
-                if (hasChunkAt(x, z)) {
-                    uPtr<Chunk> &c = getChunkAt(x, z);
-                    chunkTransparentToDraw.push_back(c.get());
-                }
+        if (isZoneMeshed(id)) {
+            coveredZones.insert(id);
+        }
+    }
+    auto isCovered = [&coveredZones](int64_t zone) { return coveredZones.count(zone) > 0; };
+    m_farTerrain.drawOpaque(shaderProgram, isCovered);
+    opaqueTimer.finish();
+
+    ScopedStageTimer transparentTimer(mp_profiler, STAGE_DRAW_TRANSPARENT);
+    // Far water is always behind the chunks' water, so it goes first
+    m_farTerrain.drawTransparent(shaderProgram, isCovered);
+
+    // Faces within each section were sorted back to front on a worker
+    // thread; all that's left here is ordering the chunks and sections.
+    // Sorting only starts over once the camera moves into another cell.
+    glm::ivec3 sortCell = transparencySortCell(cameraPos);
+    if (sortCell != m_sortCell) {
+        m_sortCell = sortCell;
+        m_sortEye = cameraPos;
+    }
+    std::vector<std::pair<float, Chunk*>> chunkTransparentToDraw {};
+    for (Chunk *c : chunksToDraw) {
+        if (!visibleSections.count(c) || c->m_countTra == 0) {
+            continue;
+        }
+        if (c->m_hasMesh && !c->m_sortPending && c->m_sortCell != m_sortCell) {
+            spawnTransparencySortWorker(c);
+        }
+        glm::vec2 d = glm::vec2(c->chunkX + 8.f, c->chunkZ + 8.f) - glm::vec2(cameraPos.x, cameraPos.z);
+        chunkTransparentToDraw.push_back({glm::dot(d, d), c});
+    }
+    std::sort(chunkTransparentToDraw.begin(), chunkTransparentToDraw.end(),
+              [](const std::pair<float, Chunk*> &a, const std::pair<float, Chunk*> &b) { return a.first > b.first; });
+    for (const auto &entry : chunkTransparentToDraw) {
+        Chunk *c = entry.second;
+        // One range per section, the ones farthest above or below the camera first
+        std::vector<std::pair<float, glm::ivec2>> sections;
+        for (int s = 0; s < SECTIONS_PER_CHUNK; s++) {
+            int count = c->m_sectionIdxTra[s + 1] - c->m_sectionIdxTra[s];
+            if ((visibleSections[c] & (1 << s)) && count > 0) {
+                float dy = glm::abs((s + 0.5f) * SECTION_SIZE - cameraPos.y);
+                sections.push_back({dy, glm::ivec2(c->m_sectionIdxTra[s], count)});
             }
         }
+        std::sort(sections.begin(), sections.end(),
+                  [](const std::pair<float, glm::ivec2> &a, const std::pair<float, glm::ivec2> &b) { return a.first > b.first; });
+        std::vector<glm::ivec2> ranges;
+        for (const auto &section : sections) {
+            ranges.push_back(section.second);
+        }
+        if (!ranges.empty()) {
+            shaderProgram->setChunkOrigin(glm::vec3(c->chunkX, 0.f, c->chunkZ));
+            shaderProgram->drawTransparent(*c, ranges);
+        }
     }
-    ChunkDistanceFromPlayerChunk comparator = ChunkDistanceFromPlayerChunk(playerPos);
-    std::sort(chunkTransparentToDraw.begin(), chunkTransparentToDraw.end(), comparator);
-    for (Chunk *c : chunkTransparentToDraw) {
-        shaderProgram->setModelMatrix(glm::mat4(1.));
-        shaderProgram->drawTransparent(*c);
+}
+
+std::unordered_map<Chunk*, uint16_t> Terrain::findVisibleSections(const glm::vec3 &cameraPos,
+                                                                  const std::unordered_set<Chunk*> &candidates) const {
+    std::unordered_map<Chunk*, uint16_t> visible;
+
+    int camX = static_cast<int>(glm::floor(cameraPos.x));
+    int camZ = static_cast<int>(glm::floor(cameraPos.z));
+    Chunk *start = hasChunkAt(camX, camZ) ? getChunkAt(camX, camZ).get() : nullptr;
+    if (start == nullptr || !candidates.count(start)) {
+        // Nothing to search from, so assume everything can be seen
+        for (Chunk *c : candidates) {
+            visible[c] = 0xffff;
+        }
+        return visible;
     }
-    /*
-    for (int64_t id : terrainZonesToDraw) {
-        glm::ivec2 coord = toCoords(id);
-        for (int x = coord.x; x < coord.x + 64; x += 16) {
-            for (int z = coord.y; z < coord.y + 64; z += 16) {
-                if (hasChunkAt(x, z)) {
-                    uPtr<Chunk> &c = getChunkAt(x, z);
-                    shaderProgram->setModelMatrix(glm::mat4(1.0));
-                    shaderProgram->drawTransparent(*(c.get()));
+
+    struct SectionVisit {
+        Chunk *c;
+        int section;
+        int enteredFrom; // Face we came in through, or -1 for the camera's own section
+        uint8_t travelled; // Every direction stepped in on the way here
+    };
+
+    int startSection = glm::clamp(static_cast<int>(glm::floor(cameraPos.y / SECTION_SIZE)), 0, SECTIONS_PER_CHUNK - 1);
+    std::deque<SectionVisit> queue;
+    queue.push_back({start, startSection, -1, 0});
+    visible[start] = (1 << startSection);
+
+    while (!queue.empty()) {
+        SectionVisit curr = queue.front();
+        queue.pop_front();
+
+        for (int d = 0; d < 6; d++) {
+            Direction dir = static_cast<Direction>(d);
+            Direction back = oppositeOf(dir);
+            // Sections behind us can't be seen by looking through this one
+            if (curr.travelled & (1 << back)) {
+                continue;
+            }
+            if (curr.enteredFrom >= 0 &&
+                !curr.c->m_sectionVisibility[curr.section].canSeeThrough(static_cast<Direction>(curr.enteredFrom), dir)) {
+                continue;
+            }
+
+            Chunk *next = curr.c;
+            int nextSection = curr.section;
+            if (dir == YPOS || dir == YNEG) {
+                nextSection += (dir == YPOS) ? 1 : -1;
+                if (nextSection < 0 || nextSection >= SECTIONS_PER_CHUNK) {
+                    continue;
+                }
+            } else {
+                next = static_cast<Chunk*>(curr.c->neighbor(dir));
+                if (next == nullptr || !candidates.count(next)) {
+                    continue;
                 }
             }
+
+            uint16_t &nextMask = visible[next];
+            if (nextMask & (1 << nextSection)) {
+                continue;
+            }
+            nextMask |= (1 << nextSection);
+            queue.push_back({next, nextSection, back, static_cast<uint8_t>(curr.travelled | (1 << dir))});
         }
     }
-    */
+
+    return visible;
+}
+
+void Terrain::occlusionCull(const glm::vec3 &cameraPos, const glm::mat4 &viewProj,
+                            const std::vector<Chunk*> &chunks,
+                            std::unordered_map<Chunk*, uint16_t> &visibleSections) {
+    m_occlusionCuller.beginFrame(viewProj);
+
+    // The nearest chunks cover the most screen, so they make the best occluders
+    glm::vec2 camXZ(cameraPos.x, cameraPos.z);
+    std::vector<Chunk*> occluderChunks = chunks;
+    auto distanceTo = [&camXZ](Chunk *c) {
+        return glm::distance(glm::vec2(c->getCoords()) + glm::vec2(8.f), camXZ);
+    };
+    std::sort(occluderChunks.begin(), occluderChunks.end(), [&distanceTo](Chunk *a, Chunk *b) {
+        return distanceTo(a) < distanceTo(b);
+    });
+    if (occluderChunks.size() > OCCLUSION_OCCLUDER_CHUNKS) {
+        occluderChunks.resize(OCCLUSION_OCCLUDER_CHUNKS);
+    }
+
+    // Stack vertical runs of solid sections into one box per run
+    for (Chunk *c : occluderChunks) {
+        glm::vec3 origin(c->chunkX, 0.f, c->chunkZ);
+        int s = 0;
+        while (s < SECTIONS_PER_CHUNK) {
+            if (!c->m_sectionVisibility[s].isSolid()) {
+                s++;
+                continue;
+            }
+            int end = s;
+            while (end + 1 < SECTIONS_PER_CHUNK && c->m_sectionVisibility[end + 1].isSolid()) {
+                end++;
+            }
+            m_occlusionCuller.addOccluder(origin + glm::vec3(0.f, s * SECTION_SIZE, 0.f),
+                                          origin + glm::vec3(16.f, (end + 1) * SECTION_SIZE, 16.f));
+            s = end + 1;
+        }
+    }
+
+    for (Chunk *c : chunks) {
+        auto vis = visibleSections.find(c);
+        if (vis == visibleSections.end()) {
+            continue;
+        }
+        uint16_t mask = vis->second;
+        int lowest = SECTIONS_PER_CHUNK, highest = -1, count = 0;
+        for (int s = 0; s < SECTIONS_PER_CHUNK; s++) {
+            if (mask & (1 << s)) {
+                lowest = std::min(lowest, s);
+                highest = s;
+                count++;
+            }
+        }
+        m_chunksConsidered++;
+        m_sectionsConsidered += count;
+
+        glm::vec3 origin(c->chunkX, 0.f, c->chunkZ);
+        // Test the whole chunk first; only if part of it shows do we test its sections
+        if (!m_occlusionCuller.isVisible(origin + glm::vec3(0.f, lowest * SECTION_SIZE, 0.f),
+                                         origin + glm::vec3(16.f, (highest + 1) * SECTION_SIZE, 16.f))) {
+            m_chunksOccluded++;
+            m_sectionsOccluded += count;
+            visibleSections.erase(vis);
+            continue;
+        }
+        for (int s = lowest; s <= highest; s++) {
+            if ((mask & (1 << s)) &&
+                !m_occlusionCuller.isVisible(origin + glm::vec3(0.f, s * SECTION_SIZE, 0.f),
+                                             origin + glm::vec3(16.f, (s + 1) * SECTION_SIZE, 16.f))) {
+                mask &= ~(1 << s);
+                m_sectionsOccluded++;
+            }
+        }
+        vis->second = mask;
+    }
+}
+
+void Terrain::setOcclusionCulling(bool enabled) {
+    m_occlusionCulling = enabled;
+}
+
+bool Terrain::occlusionCulling() const {
+    return m_occlusionCulling;
+}
+
+bool Terrain::dumpOcclusionBuffer(const std::string &path) const {
+    return m_occlusionCuller.dumpDepthBuffer(path);
+}
+
+QString Terrain::renderStatsAsQString() const {
+    int percent = m_sectionsConsidered > 0 ? (100 * m_sectionsOccluded) / m_sectionsConsidered : 0;
+    std::string str("Sections: " + std::to_string(m_sectionsDrawn) +
+                    ", occluded: " + std::to_string(percent) + "% (" +
+                    std::to_string(m_chunksOccluded) + "/" + std::to_string(m_chunksConsidered) + " chunks)" +
+                    ", meshes: " + std::to_string(m_meshCache.size()) + " / " +
+                    std::to_string(m_meshCache.usedBytes() >> 20) + " MB" +
+                    ", radius: " + std::to_string(m_drawRadius) + "/" + std::to_string(m_createRadius) +
+                    (m_zoneShape == ZoneShape::CIRCLE ? " circle" : " square") +
+                    ", far tiles: " + std::to_string(m_farTerrain.tileCount()) +
+                    ", re-sorts: " + std::to_string(m_sortsUploaded));
+    return QString::fromStdString(str);
+}
+
+const TerrainCounters &Terrain::counters() const {
+    return m_counters;
+}
+
+void Terrain::setProfiler(FrameProfiler *profiler) {
+    mp_profiler = profiler;
+}
+
+void Terrain::setDrawRadius(unsigned int radius) {
+    m_drawRadius = glm::clamp(radius, 1u, static_cast<unsigned int>(TERRAIN_MAX_DRAW_RADIUS));
+    m_createRadius = glm::max(m_createRadius, m_drawRadius + 1);
+}
+
+unsigned int Terrain::drawRadius() const {
+    return m_drawRadius;
+}
+
+void Terrain::setCreateRadius(unsigned int radius) {
+    m_createRadius = glm::max(radius, m_drawRadius + 1);
+}
+
+unsigned int Terrain::createRadius() const {
+    return m_createRadius;
+}
+
+void Terrain::setZoneShape(ZoneShape shape) {
+    m_zoneShape = shape;
+}
+
+ZoneShape Terrain::zoneShape() const {
+    return m_zoneShape;
+}
+
+float Terrain::visibleDistance() const {
+    unsigned int radius = m_drawRadius;
+    if (m_farTerrain.enabled()) {
+        radius += FAR_TERRAIN_RADIUS;
+    }
+    // The player's own zone reaches half a zone past them on average
+    return (radius + 0.5f) * 64.f;
+}
+
+int Terrain::pendingMeshCount() {
+    m_chunksWithBlockDataMutex.lock();
+    int waiting = m_chunksWithBlockData.size();
+    m_chunksWithBlockDataMutex.unlock();
+    return waiting + m_meshesInFlight;
+}
+
+int Terrain::lodForDistance(float distance) const {
+    if (!m_lodEnabled) {
+        return 0;
+    }
+    int lod = 0;
+    for (float limit = TERRAIN_LOD_BASE_DISTANCE; distance >= limit && lod < CHUNK_LOD_LEVELS - 1; limit *= 2.f) {
+        lod++;
+    }
+    return lod;
+}
+
+bool Terrain::updateChunkLOD(Chunk *c, const glm::vec3 &playerPos) {
+    glm::vec2 center = glm::vec2(c->getCoords()) + glm::vec2(8.f);
+    float distance = glm::length(center - glm::vec2(playerPos.x, playerPos.z));
+    int lod = lodForDistance(distance);
+    int current = c->lod();
+    // Only switch once the chunk is clearly across the boundary
+    if ((lod > current && lodForDistance(distance - TERRAIN_LOD_HYSTERESIS) > current) ||
+        (lod < current && lodForDistance(distance + TERRAIN_LOD_HYSTERESIS) < current)) {
+        c->setLOD(lod);
+        return true;
+    }
+    return false;
+}
+
+bool Terrain::isZoneMeshed(int64_t zone) const {
+    glm::ivec2 coord = toCoords(zone);
+    for (int x = coord.x; x < coord.x + 64; x += 16) {
+        for (int z = coord.y; z < coord.y + 64; z += 16) {
+            if (!hasChunkAt(x, z) || !getChunkAt(x, z)->m_hasMesh) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void Terrain::setFarTerrainEnabled(bool enabled) {
+    m_farTerrain.setEnabled(enabled);
+    // Request the tiles again next expandTerrain()
+    m_farTerrainRadius = 0;
+}
+
+bool Terrain::farTerrainEnabled() const {
+    return m_farTerrain.enabled();
+}
+
+void Terrain::setLODEnabled(bool enabled) {
+    m_lodEnabled = enabled;
+}
+
+bool Terrain::lodEnabled() const {
+    return m_lodEnabled;
+}
+
+void Terrain::setSectionCulling(bool enabled) {
+    m_sectionCulling = enabled;
+}
+
+bool Terrain::sectionCulling() const {
+    return m_sectionCulling;
 }
 
 void Terrain::updateChunk(Chunk *c) {
@@ -258,7 +639,14 @@ void Terrain::updateChunk(Chunk *c) {
 }
 
 void Terrain::spawnVBOWorker(Chunk *c) {
-    VBOWorker *worker = new VBOWorker(c, &m_chunksWithVBOs, &m_chunksWithVBOsMutex);
+    m_meshesInFlight++;
+    VBOWorker *worker = new VBOWorker(c, m_sortEye, &m_chunksWithVBOs, &m_chunksWithVBOsMutex);
+    QThreadPool::globalInstance()->start(worker);
+}
+
+void Terrain::spawnTransparencySortWorker(Chunk *c) {
+    c->m_sortPending = true;
+    TransparencySortWorker *worker = new TransparencySortWorker(c, m_sortEye, &m_chunksWithSorts, &m_chunksWithSortsMutex);
     QThreadPool::globalInstance()->start(worker);
 }
 
@@ -281,6 +669,7 @@ void Terrain::spawnFBMWorker(int64_t zoneToGenerate) {
             chunksForWorker.push_back(c);
         }
     }
+    m_counters.chunksGenerated += chunksForWorker.size();
     FBMWorker *worker = new FBMWorker(coords.x,
                                       coords.y,
                                       chunksForWorker,
@@ -295,26 +684,35 @@ void Terrain::spawnFBMWorkers(std::unordered_set<int64_t> &zonesToGenerate) {
     }
 }
 
-QSet<int64_t> Terrain::terrainZonesBorderingZone(glm::ivec2 zoneCoords, unsigned int radius, bool onlyCircumference) {
-    int radiusInZoneScale = static_cast<int>(radius) * 64;
+QSet<int64_t> Terrain::terrainZonesBorderingZone(glm::ivec2 zoneCoords, unsigned int radius, bool onlyCircumference) const {
+    int r = static_cast<int>(radius);
     QSet<int64_t> result {};
-    if (onlyCircumference) {
-        for (int i = -radiusInZoneScale; i <= radiusInZoneScale; i += 64) {
-            result.insert(toKey(zoneCoords.x + radiusInZoneScale, zoneCoords.y + i));
-            result.insert(toKey(zoneCoords.x - radiusInZoneScale, zoneCoords.y + i));
-            result.insert(toKey(zoneCoords.x + i, zoneCoords.y + radiusInZoneScale));
-            result.insert(toKey(zoneCoords.x + i, zoneCoords.y - radiusInZoneScale));
-        }
-    } else {
-        for (int i = -radiusInZoneScale; i <= radiusInZoneScale; i += 64) {
-            for (int j = -radiusInZoneScale; j <= radiusInZoneScale; j += 64) {
-                result.insert(toKey(zoneCoords.x + i, zoneCoords.y + j));
+    for (int i = -r; i <= r; i++) {
+        for (int j = -r; j <= r; j++) {
+            glm::ivec2 zone = zoneCoords + 64 * glm::ivec2(i, j);
+            float dist = zoneDistance(zoneCoords, zone);
+            // Zones whose centers round to the radius belong to it, which
+            // gives circles without a lone zone poking out of each side
+            if (dist > r + 0.5f) {
+                continue;
             }
+            if (onlyCircumference && dist <= r - 0.5f) {
+                continue;
+            }
+            result.insert(toKey(zone.x, zone.y));
         }
     }
     return result;
 }
 
+float Terrain::zoneDistance(glm::ivec2 zoneA, glm::ivec2 zoneB) const {
+    glm::vec2 offset = glm::abs(glm::vec2(zoneB - zoneA) / 64.f);
+    if (m_zoneShape == ZoneShape::CIRCLE) {
+        return glm::length(offset);
+    }
+    return glm::max(offset.x, offset.y);
+}
+
 void Terrain::checkThreadResults() {
     m_chunksWithBlockDataMutex.lock();
     spawnVBOWorkers(m_chunksWithBlockData);
@@ -323,47 +721,110 @@ void Terrain::checkThreadResults() {
 
     m_chunksWithVBOsMutex.lock();
     for (ChunkVBOData &cd : m_chunksWithVBOs) {
-        cd.c->createVBOdata(cd.vboDataOpaque, cd.idxDataOpaque, cd.vboDataTransparent, cd.idxDataTransparent);
+        m_meshesInFlight--;
+        // The chunk changed level again while this was being built;
+        // the mesh for the newer level is already on its way
+        if (cd.lod != cd.c->lod()) {
+            continue;
+        }
+        TraceScope trace("upload mesh", cd.c->getCoords());
+        cd.c->createVBOdata(cd);
+        m_meshCache.insert(cd.c, cd.byteSize());
+        m_counters.meshesBuilt++;
+        m_counters.uploadBytes += cd.byteSize();
     }
     m_chunksWithVBOs.clear();
     m_chunksWithVBOsMutex.unlock();
+
+    m_sortsUploaded = 0;
+    m_chunksWithSortsMutex.lock();
+    for (ChunkSortData &sd : m_chunksWithSorts) {
+        sd.c->m_sortPending = false;
+        // The mesh was replaced or evicted since the sort started; a new
+        // mesh comes sorted already, and the next draw() catches up if not
+        if (sd.meshUpload != sd.c->m_meshUploads) {
+            continue;
+        }
+        sd.c->updateTransparentIndices(sd);
+        m_sortsUploaded++;
+        m_counters.uploadBytes += sd.idxDataTransparent.size() * sizeof(GLuint);
+    }
+    m_chunksWithSorts.clear();
+    m_chunksWithSortsMutex.unlock();
+
+    m_farTerrain.checkThreadResults();
+
+    // GL deletions happen here, next to the uploads, rather than
+    // whenever a zone happens to leave the create radius
+    evictMeshes();
 }
 
-void Terrain::expandTerrain(const glm::vec3 &playerPos, const glm::vec3 &playerPosPrev) {
+void Terrain::expandTerrain(const glm::vec3 &playerPos) {
     glm::ivec2 currZone { 64.f * glm::floor(playerPos.x / 64.f), 64.f * glm::floor(playerPos.z / 64.f) };
-    glm::ivec2 prevZone { 64.f * glm::floor(playerPosPrev.x / 64.f), 64.f * glm::floor(playerPosPrev.z / 64.f) };
-
-    QSet<int64_t> terrainZonesBorderingCurrPos = terrainZonesBorderingZone(currZone, TERRAIN_CREATE_RADIUS, false);
-    QSet<int64_t> terrainZonesBorderingPrevPos = terrainZonesBorderingZone(prevZone, TERRAIN_CREATE_RADIUS, false);
 
-    for (const int64_t &id : terrainZonesBorderingPrevPos) {
-        if (!terrainZonesBorderingCurrPos.contains(id)) {
+    for (int64_t id : terrainZonesBorderingZone(currZone, m_createRadius, false)) {
+        if (m_residentZones.count(id)) {
+            continue;
+        }
+        m_residentZones.insert(id);
+        if (m_generatedTerrain.count(id)) {
+            glm::ivec2 coord = toCoords(id);
+            for (int x = coord.x; x < coord.x + 64; x += 16) {
+                for (int z = coord.y; z < coord.y + 64; z += 16) {
+                    Chunk *c = getChunkAt(x, z).get();
+                    updateChunkLOD(c, playerPos);
+                    // A cached mesh built from the same blocks is as good as a new one
+                    if (!c->hasCurrentMesh()) {
+                        spawnVBOWorker(c);
+                    }
+                }
+            }
+        } else {
+            spawnFBMWorker(id);
+            // The chunks get meshed once the worker has filled them in
             glm::ivec2 coord = toCoords(id);
             for (int x = coord.x; x < coord.x + 64; x += 16) {
                 for (int z = coord.y; z < coord.y + 64; z += 16) {
-                    auto &chunk = getChunkAt(x, z);
-                    chunk->destroyVBOdata();
+                    updateChunkLOD(getChunkAt(x, z).get(), playerPos);
                 }
             }
         }
     }
 
-    for (const int64_t &id : terrainZonesBorderingCurrPos) {
-        if (m_generatedTerrain.count(id)) {
-            if (!terrainZonesBorderingPrevPos.contains(id)) {
-                glm::ivec2 coord = toCoords(id);
-                for (int x = coord.x; x < coord.x + 64; x += 16) {
-                    for (int z = coord.y; z < coord.y + 64; z += 16) {
-                        spawnVBOWorker(getChunkAt(x, z).get());
-                    }
-                }
-            }
+    unsigned int farRadius = m_drawRadius + FAR_TERRAIN_RADIUS;
+    if (currZone != m_farTerrainCenter || farRadius != m_farTerrainRadius) {
+        m_farTerrain.update(terrainZonesBorderingZone(currZone, farRadius, false),
+                            terrainZonesBorderingZone(currZone, farRadius + FAR_TERRAIN_UNLOAD_MARGIN, false));
+        m_farTerrainCenter = currZone;
+        m_farTerrainRadius = farRadius;
+    }
+
+    // Hysteresis: only let go of zones well outside the create radius
+    float unloadDistance = m_createRadius + TERRAIN_UNLOAD_MARGIN + 0.5f;
+    for (auto it = m_residentZones.begin(); it != m_residentZones.end();) {
+        if (zoneDistance(currZone, toCoords(*it)) > unloadDistance) {
+            it = m_residentZones.erase(it);
         } else {
-            spawnFBMWorker(id);
+            ++it;
         }
     }
 }
 
+bool Terrain::isChunkResident(Chunk *c) const {
+    glm::ivec2 coords = c->getCoords();
+    return m_residentZones.count(toKey(64.f * glm::floor(coords.x / 64.f), 64.f * glm::floor(coords.y / 64.f)));
+}
+
+void Terrain::evictMeshes() {
+    for (Chunk *c : m_meshCache.evict([this](Chunk *c) { return isChunkResident(c); })) {
+        c->destroyVBOdata();
+    }
+}
+
+void Terrain::setMeshCacheBudget(size_t bytes) {
+    m_meshCache.setBudget(bytes);
+}
+
 void Terrain::updateRedstone() {
     for (RedstoneItem *i : redstoneSources) {
         if (RedstoneTorch *r = dynamic_cast<RedstoneTorch*>(i); r != nullptr) {
@@ -390,11 +851,9 @@ void Terrain::updateRedstone() {
     for (uPtr<RedstoneItem> &i : redstoneItems) {
         if (i->stateHasChanged()) {
             if (RedstoneTorch *r = dynamic_cast<RedstoneTorch*>(i.get()); r != nullptr) {
-                if (i->getState()) {
-                    setBlockAt(i->getXPos(), i->getYPos(), i->getZPos(), REDSTONE_TORCH_ON);
-                } else {
-                    setBlockAt(i->getXPos(), i->getYPos(), i->getZPos(), REDSTONE_TORCH_OFF);
-                }
+                setDecorationAt(i->getXPos(), i->getYPos(), i->getZPos(),
+                                i->getState() ? REDSTONE_TORCH_ON : REDSTONE_TORCH_OFF);
+                continue;
             }
 
             if (RedstoneLamp *r = dynamic_cast<RedstoneLamp*>(i.get()); r != nullptr) {
@@ -414,11 +873,9 @@ void Terrain::updateRedstone() {
             }
 
             if (RedstoneLever *r = dynamic_cast<RedstoneLever*>(i.get()); r != nullptr) {
-                if (i->getState()) {
-                    setBlockAt(i->getXPos(), i->getYPos(), i->getZPos(), REDSTONE_LEVER_ON);
-                } else {
-                    setBlockAt(i->getXPos(), i->getYPos(), i->getZPos(), REDSTONE_LEVER_OFF);
-                }
+                setDecorationAt(i->getXPos(), i->getYPos(), i->getZPos(),
+                                i->getState() ? REDSTONE_LEVER_ON : REDSTONE_LEVER_OFF);
+                continue;
             }
 
             changedChunks.insert(toKey(i->getXPos(), i->getZPos()));
@@ -430,6 +887,22 @@ void Terrain::updateRedstone() {
     }
 }
 
+void Terrain::updateFluids() {
+    std::vector<glm::ivec3> changed;
+    m_counters.fluidCellsUpdated += m_fluids.step(this, &changed);
+    std::unordered_set<Chunk*> changedChunks;
+    for (const glm::ivec3 &p : changed) {
+        changedChunks.insert(getChunkAt(p.x, p.z).get());
+    }
+    for (Chunk *c : changedChunks) {
+        updateChunk(c);
+    }
+}
+
+void Terrain::wakeFluidsAt(int x, int y, int z) {
+    m_fluids.blockChanged(glm::ivec3(x, y, z));
+}
+
 bool Terrain::hasRedstoneItemAt(int x, int y, int z) {
     if (hasChunkAt(x, z))
         return redstoneBlocks.count(getBlockAt(x, y, z));
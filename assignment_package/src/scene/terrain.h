@@ -4,21 +4,54 @@
 #include "scene/redstoneitem.h"
 #include "smartpointerhelp.h"
 #include "chunk.h"
+#include "decorationmesh.h"
+#include "occlusionculler.h"
+#include "meshcache.h"
+#include "farterrain.h"
+#include "fluidsim.h"
 #include <array>
 #include <unordered_map>
 #include <unordered_set>
 #include "shaderprogram.h"
+#include "frameprofiler.h"
 #include <QtCore/QMutex>
 
 
 //using namespace std;
 
+// Default draw and generation distances, in zones. Both can be changed at runtime.
 #define TERRAIN_DRAW_RADIUS 1
 #define TERRAIN_CREATE_RADIUS 2
+// Upper bound on the runtime draw radius
+#define TERRAIN_MAX_DRAW_RADIUS 8
+// How many zones past the create radius the player must move before
+// a zone's meshes stop being kept resident, so that walking back and forth
+// across a zone border doesn't unload and reload the same zones
+#define TERRAIN_UNLOAD_MARGIN 1
+// Chunks nearer than this many blocks are meshed at full detail; every
+// doubling of the distance past it drops one level of detail
+#define TERRAIN_LOD_BASE_DISTANCE 96.f
+// How far past a LOD boundary a chunk must be before it switches level
+#define TERRAIN_LOD_HYSTERESIS 8.f
+// How many of the chunks nearest the camera contribute occluders each frame
+#define OCCLUSION_OCCLUDER_CHUNKS 24
 
-// Helper functions to convert (x, z) to and from hash map key
-int64_t toKey(int x, int z);
-glm::ivec2 toCoords(int64_t k);
+// Running totals of the work Terrain has done since it was created
+struct TerrainCounters {
+    // Chunks handed to generation workers
+    uint64_t chunksGenerated;
+    // Chunk meshes uploaded, remeshes included
+    uint64_t meshesBuilt;
+    // Bytes of chunk meshes and re-sorted transparent indices sent to the GPU
+    uint64_t uploadBytes;
+    // Blocks the fluid simulation has looked at
+    uint64_t fluidCellsUpdated;
+};
+
+// Outline of the area of zones around the player that is drawn and generated
+enum class ZoneShape : unsigned char {
+    SQUARE, CIRCLE
+};
 
 // The container class for all of the Chunks in the game.
 // Ultimately, while Terrain will always store all Chunks,
@@ -48,21 +81,101 @@ private:
     // in the Terrain will never be deleted until the program is terminated.
     std::unordered_set<int64_t> m_generatedTerrain;
 
+    // Zones whose chunk meshes must stay on the GPU. A zone joins when it
+    // enters the create radius and leaves once it is more than
+    // TERRAIN_UNLOAD_MARGIN zones outside of it.
+    std::unordered_set<int64_t> m_residentZones;
+
+    // Every chunk mesh on the GPU. Meshes of non-resident zones are kept
+    // until the cache goes over budget, so that coming back to an area
+    // whose blocks haven't changed needs no remeshing at all.
+    MeshCache m_meshCache;
+
     QMutex m_chunksWithVBOsMutex;
     std::vector<ChunkVBOData> m_chunksWithVBOs;
 
     QMutex m_chunksWithBlockDataMutex;
     std::unordered_set<Chunk*> m_chunksWithBlockData;
 
+    QMutex m_chunksWithSortsMutex;
+    std::vector<ChunkSortData> m_chunksWithSorts;
+    // Camera position that transparent faces are currently sorted for, and
+    // the sort cell it lies in. Only moves when the camera changes cell.
+    glm::vec3 m_sortEye;
+    glm::ivec3 m_sortCell;
+    // Chunk transparency re-sorts uploaded by the last checkThreadResults()
+    int m_sortsUploaded;
+
     OpenGLContext* mp_context;
 
-    QSet<int64_t> terrainZonesBorderingZone(glm::ivec2 zoneCoords, unsigned int radius, bool onlyCircumference);
+    // Radii in zones, measured from the player's zone. The create radius
+    // always stays at least one zone past the draw radius so that every
+    // drawn chunk has generated neighbours to mesh its borders against.
+    unsigned int m_drawRadius, m_createRadius;
+    ZoneShape m_zoneShape;
+
+    // VBO workers whose results haven't been uploaded yet
+    int m_meshesInFlight;
+
+    // Heightfield tiles drawn past the chunks, out to FAR_TERRAIN_RADIUS
+    // zones beyond the draw radius
+    FarTerrain m_farTerrain;
+    // Player zone and radius the far terrain tiles were last requested for
+    glm::ivec2 m_farTerrainCenter;
+    unsigned int m_farTerrainRadius;
+    // True if every chunk of the zone has a mesh, so its far tile can be hidden
+    bool isZoneMeshed(int64_t zone) const;
+
+    // Whether distant chunks are meshed at lower levels of detail
+    bool m_lodEnabled;
+    // Level of detail for a chunk whose center is distance blocks from the player
+    int lodForDistance(float distance) const;
+    // Picks c's level of detail for the player's position, sticking with
+    // its current one near the boundaries. Returns true if it changed.
+    bool updateChunkLOD(Chunk *c, const glm::vec3 &playerPos);
+
+    // The zones within radius of zoneCoords under m_zoneShape, or only the
+    // outermost ring of them if onlyCircumference is set
+    QSet<int64_t> terrainZonesBorderingZone(glm::ivec2 zoneCoords, unsigned int radius, bool onlyCircumference) const;
+    // Distance between two zones in zones, under m_zoneShape
+    float zoneDistance(glm::ivec2 zoneA, glm::ivec2 zoneB) const;
 
     void redrawZoneEdgeChunks(Chunk *c);
 
+    bool isChunkResident(Chunk *c) const;
+    // Destroys the least recently used non-resident meshes while the
+    // mesh cache is over budget
+    void evictMeshes();
+
     std::list<uPtr<RedstoneItem>> redstoneItems;
     std::unordered_set<RedstoneItem*> redstoneSources;
 
+    // The shared meshes decorations are drawn as instances of, one per
+    // DecorationShape. Created by createDecorationMeshes().
+    std::array<uPtr<DecorationMesh>, DECORATION_SHAPE_COUNT> m_decorationMeshes;
+
+    // Whether draw() skips sections that the camera cannot see into
+    bool m_sectionCulling;
+
+    // Whether draw() tests chunks and sections against a software depth buffer
+    bool m_occlusionCulling;
+    OcclusionCuller m_occlusionCuller;
+
+    FluidSim m_fluids;
+
+    TerrainCounters m_counters;
+    FrameProfiler *mp_profiler; // Times the opaque and transparent halves of draw(), if set
+
+    // Counted by the most recent draw()
+    int m_sectionsConsidered, m_sectionsOccluded, m_sectionsDrawn;
+    int m_chunksConsidered, m_chunksOccluded;
+
+    // Rasterizes the solid sections of the chunks nearest the camera as
+    // occluders, then removes the sections hidden behind them from visibleSections.
+    void occlusionCull(const glm::vec3 &cameraPos, const glm::mat4 &viewProj,
+                       const std::vector<Chunk*> &chunks,
+                       std::unordered_map<Chunk*, uint16_t> &visibleSections);
+
 public:
     Terrain(OpenGLContext *context);
     ~Terrain();
@@ -88,18 +201,74 @@ public:
     // values) set the block at that point in space to the
     // given type.
     void setBlockAt(int x, int y, int z, BlockType t);
+    // Like setBlockAt, for swapping a torch or lever between on and off.
+    // Queues a remesh of the chunk only if it can't be updated in place.
+    void setDecorationAt(int x, int y, int z, BlockType t);
+    // Uploads the shared decoration meshes. Call once GL is set up, before
+    // the first draw(): uploading between draws would bind their element
+    // buffers into whichever chunk VAO was bound last.
+    void createDecorationMeshes();
 
 
     // Draws every Chunk that falls within the bounding box
     // described by the min and max coords, using the provided
-    // ShaderProgram
-    void draw(const glm::vec3 &playerPos, ShaderProgram *shaderProgram);
+    // ShaderProgram. When section culling is on, only the sections
+    // reachable from the camera's section are drawn. Chunks whose
+    // level of detail no longer suits their distance are queued for
+    // remeshing and keep drawing their old mesh until the new one lands.
+    // Torches, levers and plants are drawn with decorationProgram, instanced.
+    void draw(const glm::vec3 &playerPos, const glm::vec3 &cameraPos, const glm::mat4 &viewProj,
+              ShaderProgram *shaderProgram, ShaderProgram *decorationProgram);
+
+    // Breadth-first search over chunk sections starting at the section
+    // containing cameraPos, stepping only through faces that the section
+    // visibility masks say are connected and never doubling back towards
+    // the camera. Returns a bitmask of reachable sections per chunk;
+    // chunks with no reachable sections are left out.
+    std::unordered_map<Chunk*, uint16_t> findVisibleSections(const glm::vec3 &cameraPos,
+                                                             const std::unordered_set<Chunk*> &candidates) const;
+
+    void setSectionCulling(bool enabled);
+    bool sectionCulling() const;
+    void setOcclusionCulling(bool enabled);
+    bool occlusionCulling() const;
+    // Writes the occlusion depth buffer from the last draw() to a PGM image
+    bool dumpOcclusionBuffer(const std::string &path) const;
+    // Culling statistics of the last draw(), for the player info window
+    QString renderStatsAsQString() const;
+    const TerrainCounters &counters() const;
+    void setProfiler(FrameProfiler *profiler);
 
     // Initializes the Chunks that store the 64 x 256 x 64 block scene you
     // see when the base code is run.
     void CreateTestScene();
 
-    void expandTerrain(const glm::vec3 &playerPos, const glm::vec3 &playerPosPrev);
+    // Makes the zones around the player resident, generating or meshing
+    // whatever they are missing, and releases zones left far behind
+    void expandTerrain(const glm::vec3 &playerPos);
+
+    // Bytes of GPU memory chunk meshes may hold, set by --mesh-cache-mb
+    void setMeshCacheBudget(size_t bytes);
+
+    void setFarTerrainEnabled(bool enabled);
+    bool farTerrainEnabled() const;
+
+    void setLODEnabled(bool enabled);
+    bool lodEnabled() const;
+
+    // Raising the draw radius raises the create radius with it if needed
+    void setDrawRadius(unsigned int radius);
+    unsigned int drawRadius() const;
+    // Clamped so it never drops below the draw radius plus one
+    void setCreateRadius(unsigned int radius);
+    unsigned int createRadius() const;
+    void setZoneShape(ZoneShape shape);
+    ZoneShape zoneShape() const;
+    // Blocks from the player to the edge of what gets drawn, far terrain
+    // included, so fog can hide the edge
+    float visibleDistance() const;
+    // Chunks whose meshes are queued or being built on worker threads
+    int pendingMeshCount();
 
     void updateChunk(Chunk *c);
 
@@ -107,12 +276,20 @@ public:
     void spawnFBMWorkers(std::unordered_set<int64_t> &zonesToGenerate);
     void spawnVBOWorker(Chunk *c);
     void spawnVBOWorkers(std::unordered_set<Chunk*> &chunksToGenVBOs);
+    void spawnTransparencySortWorker(Chunk *c);
 
     void checkThreadResults();
 
     // redstone
     void updateRedstone();
 
+    // One tick of flowing water and lava. Queues a remesh of every chunk
+    // they changed, once each.
+    void updateFluids();
+    // Lets the fluids around a block that was just set outside of
+    // updateFluids() react to it
+    void wakeFluidsAt(int x, int y, int z);
+
     bool hasRedstoneItemAt(int x, int y, int z);
     RedstoneItem *getRedstoneItemAt(int x, int y, int z);
     const uPtr<RedstoneItem> &getRedstoneUptrItemAt(int x, int y, int z);
@@ -0,0 +1,53 @@
+#pragma once
+#include "chunkdata.h"
+
+// Terrain generation. Only touches ChunkData, so none of it needs an
+// OpenGL context.
+
+int getGrasslandHeight(int x, int z);
+
+int getMountainHeight(int x, int z);
+
+int getSandHeight(int x, int z);
+
+float perlinNoise(glm::vec2 uv);
+
+float perlinNoise3D(glm::vec3 p);
+
+float surflet(glm::vec2 p, glm::vec2 gridPoint);
+
+float worleyNoise(glm::vec2 uv);
+
+float interpolate(float a);
+
+float randomNoise(int a);
+
+float remap(float a, float b, float c, float d, float e);
+
+// Water fills empty space up to (but not including) this height
+#define SEA_LEVEL 139
+
+// Height of the ground at a world column, i.e. the lowest y above it that
+// fillBlock leaves empty before carving caves or adding water. Also writes
+// how mountainous the column is, from 0 (grassland) to 1 (mountains).
+int getTerrainHeight(int x, int z, float *biome);
+
+// The block fillBlock puts at y = height - 1 for the given biome blend
+BlockType getSurfaceBlock(int height, float biome);
+
+// Fills one column of c, at chunk-space (x, z), with the generated terrain
+void fillBlock(ChunkData *c, int x, int z);
+
+float smoothstep(float a, float b, float t);
+
+//lerp function
+
+float lerp(float a, float b, float t);
+
+//standard perlinNoise function
+
+float PerlinNoise(glm::vec2 uv);
+
+//2D perlin noise
+
+float perlin_noise_2d(float x, float y);
@@ -3,7 +3,8 @@
 #include <QOpenGLWidget>
 
 Texture::Texture(OpenGLContext *context)
-    : context(context), m_textureHandle(-1), m_textureImage(nullptr)
+    : context(context), m_textureHandle(-1), m_textureImage(nullptr),
+      m_trackedImage(MEM_QT_RESOURCES), m_trackedTexture(MEM_GPU_TEXTURES)
 {}
 
 Texture::~Texture()
@@ -17,6 +18,7 @@ void Texture::create(const char *texturePath)
     img.convertToFormat(QImage::Format_ARGB32);
     img = img.mirrored();
     m_textureImage = std::make_shared<QImage>(img);
+    m_trackedImage.set(m_textureImage->sizeInBytes());
     context->glGenTextures(1, &m_textureHandle);
 
     context->printGLErrorLog();
@@ -26,8 +28,7 @@ void Texture::load(int texSlot = 0)
 {
     context->printGLErrorLog();
 
-    context->glActiveTexture(GL_TEXTURE0 + texSlot);
-    context->glBindTexture(GL_TEXTURE_2D, m_textureHandle);
+    context->bindTexture2DCached(texSlot, m_textureHandle);
 
     // These parameters need to be set for EVERY texture you create
     // They don't always have to be set to the values given here, but they do need
@@ -40,12 +41,12 @@ void Texture::load(int texSlot = 0)
     context->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
                           m_textureImage->width(), m_textureImage->height(),
                           0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, m_textureImage->bits());
+    m_trackedTexture.set(int64_t(m_textureImage->width()) * m_textureImage->height() * 4);
     context->printGLErrorLog();
 }
 
 
 void Texture::bind(int texSlot = 0)
 {
-    context->glActiveTexture(GL_TEXTURE0 + texSlot);
-    context->glBindTexture(GL_TEXTURE_2D, m_textureHandle);
+    context->bindTexture2DCached(texSlot, m_textureHandle);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <openglcontext.h>
+#include "memorystats.h"
 #include <memory>
 
 class Texture
@@ -17,4 +18,5 @@ private:
     OpenGLContext* context;
     GLuint m_textureHandle;
     std::shared_ptr<QImage> m_textureImage;
+    TrackedBytes m_trackedImage, m_trackedTexture;
 };
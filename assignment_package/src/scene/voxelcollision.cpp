@@ -0,0 +1,144 @@
+#include "voxelcollision.h"
+#include <array>
+
+bool blocksMovement(BlockType t) {
+    return t != EMPTY && t != WATER && t != LAVA;
+}
+
+VoxelNeighborhood::VoxelNeighborhood()
+    : m_origin(0), m_size(0), m_blocks()
+{}
+
+BlockType VoxelNeighborhood::at(int x, int y, int z) const {
+    glm::ivec3 p = glm::ivec3(x, y, z) - m_origin;
+    if (glm::any(glm::lessThan(p, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(p, m_size))) {
+        return BEDROCK;
+    }
+    return m_blocks[p.x + m_size.x * (p.y + m_size.y * p.z)];
+}
+
+static void shift(AABB *box, int axis, float d) {
+    box->min[axis] += d;
+    box->max[axis] += d;
+}
+
+// How far box can go along axis, up to d, before it overlaps a block that
+// stops it. Only the layers of blocks the move sweeps through are looked at,
+// nearest first; a block the box already overlaps never stops it.
+static float clipAxis(const VoxelNeighborhood &blocks, const AABB &box, int axis, float d) {
+    if (d == 0.f) {
+        return 0.f;
+    }
+    int u = (axis + 1) % 3, v = (axis + 2) % 3;
+    int u0 = static_cast<int>(glm::floor(box.min[u])), u1 = static_cast<int>(glm::ceil(box.max[u])) - 1;
+    int v0 = static_cast<int>(glm::floor(box.min[v])), v1 = static_cast<int>(glm::ceil(box.max[v])) - 1;
+    auto layerBlocks = [&](int layer) {
+        for (int i = u0; i <= u1; i++) {
+            for (int j = v0; j <= v1; j++) {
+                glm::ivec3 p;
+                p[axis] = layer;
+                p[u] = i;
+                p[v] = j;
+                if (blocksMovement(blocks.at(p.x, p.y, p.z))) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+    if (d > 0.f) {
+        int last = static_cast<int>(glm::ceil(box.max[axis] + d)) - 1;
+        for (int layer = static_cast<int>(glm::ceil(box.max[axis])); layer <= last; layer++) {
+            if (layerBlocks(layer)) {
+                return glm::clamp(layer - box.max[axis] - VOXEL_COLLISION_SKIN, 0.f, d);
+            }
+        }
+    } else {
+        int last = static_cast<int>(glm::floor(box.min[axis] + d));
+        for (int layer = static_cast<int>(glm::floor(box.min[axis])) - 1; layer >= last; layer--) {
+            if (layerBlocks(layer)) {
+                return glm::clamp(layer + 1 - box.min[axis] + VOXEL_COLLISION_SKIN, d, 0.f);
+            }
+        }
+    }
+    return d;
+}
+
+// One part of sweepAABB(), short enough not to need splitting. grounded
+// says an earlier part already came down onto something.
+static SweepResult sweepOnce(const VoxelNeighborhood &blocks, const AABB &box, glm::vec3 movement, float stepHeight,
+                             bool grounded) {
+    static const std::array<int, 3> axisOrder {1, 0, 2};
+    SweepResult result {glm::vec3(0.f), glm::bvec3(false), false};
+    AABB moved = box;
+    for (int axis : axisOrder) {
+        float d = clipAxis(blocks, moved, axis, movement[axis]);
+        result.movement[axis] = d;
+        result.blocked[axis] = d != movement[axis];
+        shift(&moved, axis, d);
+    }
+
+    bool onGround = grounded || (movement.y <= 0.f && result.blocked.y);
+    if (stepHeight <= 0.f || !onGround || !(result.blocked.x || result.blocked.z)) {
+        return result;
+    }
+    AABB lifted = box;
+    shift(&lifted, 1, clipAxis(blocks, lifted, 1, stepHeight));
+    glm::bvec3 liftedBlocked(false);
+    for (int axis : {0, 2}) {
+        float d = clipAxis(blocks, lifted, axis, movement[axis]);
+        liftedBlocked[axis] = d != movement[axis];
+        shift(&lifted, axis, d);
+    }
+    // Down onto whatever is below, no further than the plain move went
+    float drop = box.min.y + result.movement.y - lifted.min.y;
+    float dropped = clipAxis(blocks, lifted, 1, drop);
+    liftedBlocked.y = dropped != drop;
+    shift(&lifted, 1, dropped);
+
+    glm::vec3 stepped = lifted.min - box.min;
+    if (stepped.x * stepped.x + stepped.z * stepped.z >
+        result.movement.x * result.movement.x + result.movement.z * result.movement.z) {
+        result.steppedUp = stepped.y > result.movement.y;
+        result.movement = stepped;
+        result.blocked = liftedBlocked;
+    }
+    return result;
+}
+
+SweepResult sweepAABB(const VoxelNeighborhood &blocks, const AABB &box, glm::vec3 movement, float stepHeight) {
+    float longest = glm::max(glm::abs(movement.x), glm::max(glm::abs(movement.y), glm::abs(movement.z)));
+    int parts = glm::max(1, static_cast<int>(glm::ceil(longest / VOXEL_COLLISION_MAX_STEP)));
+    glm::vec3 part = movement / static_cast<float>(parts);
+
+    SweepResult total {glm::vec3(0.f), glm::bvec3(false), false};
+    AABB moved = box;
+    for (int i = 0; i < parts; i++) {
+        SweepResult r = sweepOnce(blocks, moved, part, stepHeight, movement.y <= 0.f && total.blocked.y);
+        for (int axis = 0; axis < 3; axis++) {
+            shift(&moved, axis, r.movement[axis]);
+            total.movement[axis] += r.movement[axis];
+            total.blocked[axis] = total.blocked[axis] || r.blocked[axis];
+            // Whatever stopped this axis would stop the rest of the move too
+            if (r.blocked[axis]) {
+                part[axis] = 0.f;
+            }
+        }
+        total.steppedUp = total.steppedUp || r.steppedUp;
+    }
+    return total;
+}
+
+bool overlapsBlock(const VoxelNeighborhood &blocks, const AABB &box, BlockType t) {
+    glm::ivec3 lo(glm::floor(box.min)), hi(glm::ceil(box.max));
+    for (int x = lo.x; x < hi.x; x++) {
+        for (int y = lo.y; y < hi.y; y++) {
+            for (int z = lo.z; z < hi.z; z++) {
+                if (blocks.at(x, y, z) == t) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
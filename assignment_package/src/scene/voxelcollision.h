@@ -0,0 +1,83 @@
+#pragma once
+#include "chunkhelpers.h"
+#include <vector>
+
+// Gap kept between a moving box and the blocks it runs into, so that it
+// is never counted as inside a block it is only touching
+#define VOXEL_COLLISION_SKIN 0.001f
+// Longest move resolved in one go. Longer ones are split into parts so a
+// fast box can't slide past the corner of a block it should have hit.
+#define VOXEL_COLLISION_MAX_STEP 0.5f
+
+// Axis-aligned box in world space
+struct AABB {
+    glm::vec3 min, max;
+};
+
+// Whether t stops a moving box. Water and lava only slow it down.
+bool blocksMovement(BlockType t);
+
+// A box of blocks copied out of the world once per query, so that
+// resolving a move looks each chunk up once rather than every block on
+// every ray. Keeps its storage between gathers.
+class VoxelNeighborhood {
+private:
+    glm::ivec3 m_origin, m_size;
+    std::vector<BlockType> m_blocks;
+
+public:
+    VoxelNeighborhood();
+
+    // Copies the blocks from min to max inclusive. World is anything with
+    // hasChunkAt(x, z) and a getChunkAt(x, z) whose result has
+    // getBlockAt(x, y, z) in chunk coordinates, such as Terrain. Columns of
+    // missing chunks count as BEDROCK, so nothing walks into unloaded
+    // terrain; anything above or below the world is EMPTY.
+    template <typename World>
+    void gather(const World &world, glm::ivec3 min, glm::ivec3 max);
+
+    // BEDROCK outside of what was gathered
+    BlockType at(int x, int y, int z) const;
+};
+
+struct SweepResult {
+    glm::vec3 movement; // How far the box got
+    glm::bvec3 blocked; // Axes along which it ran into something
+    bool steppedUp; // Whether it climbed a ledge on the way
+};
+
+// Moves box by movement through the solid blocks of blocks, one axis at a
+// time, y first. If a horizontal move is cut short while the box is on the
+// ground and stepHeight is above zero, the move is tried again lifted by
+// up to stepHeight, then lowered back down, and whichever went further is
+// kept. blocks must cover the box, the move and the step.
+SweepResult sweepAABB(const VoxelNeighborhood &blocks, const AABB &box, glm::vec3 movement, float stepHeight);
+
+// Whether any block of type t overlaps box
+bool overlapsBlock(const VoxelNeighborhood &blocks, const AABB &box, BlockType t);
+
+template <typename World>
+void VoxelNeighborhood::gather(const World &world, glm::ivec3 min, glm::ivec3 max) {
+    m_origin = min;
+    m_size = max - min + glm::ivec3(1);
+    m_blocks.assign(m_size.x * m_size.y * m_size.z, BEDROCK);
+    int firstChunkX = 16 * static_cast<int>(glm::floor(min.x / 16.f));
+    int firstChunkZ = 16 * static_cast<int>(glm::floor(min.z / 16.f));
+    for (int cx = firstChunkX; cx <= max.x; cx += 16) {
+        for (int cz = firstChunkZ; cz <= max.z; cz += 16) {
+            if (!world.hasChunkAt(cx, cz)) {
+                continue;
+            }
+            const auto &chunk = world.getChunkAt(cx, cz);
+            for (int x = glm::max(min.x, cx); x <= glm::min(max.x, cx + 15); x++) {
+                for (int z = glm::max(min.z, cz); z <= glm::min(max.z, cz + 15); z++) {
+                    for (int y = min.y; y <= max.y; y++) {
+                        BlockType t = y < 0 || y >= 256 ? EMPTY : chunk->getBlockAt(x - cx, y, z - cz);
+                        glm::ivec3 p = glm::ivec3(x, y, z) - m_origin;
+                        m_blocks[p.x + m_size.x * (p.y + m_size.y * p.z)] = t;
+                    }
+                }
+            }
+        }
+    }
+}
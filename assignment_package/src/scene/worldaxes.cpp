@@ -17,14 +17,13 @@ void WorldAxes::createVBOdata()
     m_count = 6;
 
     generateIdx();
-    mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufIdx);
-    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, 6 * sizeof(GLuint), idx, GL_STATIC_DRAW);
+    mp_context->bufferIndicesTracked(m_bufIdx, 6 * sizeof(GLuint), idx, GL_STATIC_DRAW);
     generatePos();
     mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufPos);
-    mp_context->glBufferData(GL_ARRAY_BUFFER, 6 * sizeof(glm::vec4), pos, GL_STATIC_DRAW);
+    mp_context->bufferDataTracked(GL_ARRAY_BUFFER, m_bufPos, 6 * sizeof(glm::vec4), pos, GL_STATIC_DRAW);
     generateCol();
     mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufCol);
-    mp_context->glBufferData(GL_ARRAY_BUFFER, 6 * sizeof(glm::vec4), col, GL_STATIC_DRAW);
+    mp_context->bufferDataTracked(GL_ARRAY_BUFFER, m_bufCol, 6 * sizeof(glm::vec4), col, GL_STATIC_DRAW);
 }
 
 GLenum WorldAxes::drawMode()
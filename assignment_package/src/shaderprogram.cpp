@@ -1,62 +1,140 @@
 #include "shaderprogram.h"
+#include "frameuniforms.h"
+#include "scene/noisetexture.h"
+#include "scene/decorations.h"
 #include <QFile>
 #include <QStringBuilder>
 #include <QTextStream>
 #include <QDebug>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
 
 ShaderProgram::ShaderProgram(OpenGLContext *context)
     : vertShader(), fragShader(), prog(), textureHandle(),
-      attrPos(-1), attrNor(-1), attrCol(-1),
-      unifModel(-1), unifModelInvTr(-1), unifViewProj(-1), unifColor(-1), unifSampler2D(-1), unifTime(-1),
-      context(context)
+      attrPos(-1), attrNor(-1), attrCol(-1), attrUV(-1), attrPosOffset(-1), attrInstanceData(-1),
+      unifModel(-1), unifModelInvTr(-1), unifColor(-1), unifSampler2D(-1), unifChunkOrigin(-1),
+      context(context),
+      m_cachedModel(), m_cachedColor(), m_cachedChunkOrigin(), m_cachedTextureSlot(-1),
+      m_modelCached(false), m_colorCached(false), m_chunkOriginCached(false),
+      mp_binaryCache(nullptr), m_binaryKey(), m_loadedFromBinary(false)
 {}
 
-void ShaderProgram::create(const char *vertfile, const char *fragfile)
+// 64-bit FNV-1a, for naming cached program binaries
+static uint64_t hashBytes(const QByteArray &bytes, uint64_t hash = 14695981039346656037ull) {
+    const char *data = bytes.constData();
+    for (int i = 0; i < bytes.size(); i++) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ull;
+    }
+    return hash;
+}
+
+void ShaderProgram::create(const char *vertfile, const char *fragfile, const ResourceCache *cache)
+{
+    startCreate(vertfile, fragfile, cache);
+    finishCreate();
+}
+
+void ShaderProgram::startCreate(const char *vertfile, const char *fragfile, const ResourceCache *cache)
 {
     // Allocate space on our GPU for a vertex shader and a fragment shader and a shader program to manage the two
     vertShader = context->glCreateShader(GL_VERTEX_SHADER);
     fragShader = context->glCreateShader(GL_FRAGMENT_SHADER);
     prog = context->glCreateProgram();
     // Get the body of text stored in our two .glsl files
-    QString qVertSource = qTextFileRead(vertfile);
-    QString qFragSource = qTextFileRead(fragfile);
-
-    char* vertSource = new char[qVertSource.size()+1];
-    strcpy(vertSource, qVertSource.toStdString().c_str());
-    char* fragSource = new char[qFragSource.size()+1];
-    strcpy(fragSource, qFragSource.toStdString().c_str());
+    QByteArray vertSource = qTextFileRead(vertfile).toUtf8();
+    QByteArray fragSource = qTextFileRead(fragfile).toUtf8();
 
+    // Tell prog that it manages these particular vertex and fragment shaders
+    context->glAttachShader(prog, vertShader);
+    context->glAttachShader(prog, fragShader);
+    // Fixed locations let meshes share one VAO setup across programs
+    context->glBindAttribLocation(prog, ATTR_LOC_POS, "vs_Pos");
+    context->glBindAttribLocation(prog, ATTR_LOC_NOR, "vs_Nor");
+    context->glBindAttribLocation(prog, ATTR_LOC_UV, "vs_UV");
+    // A new program starts with every uniform at its default
+    m_modelCached = m_colorCached = m_chunkOriginCached = false;
+    m_cachedTextureSlot = -1;
+
+    // Binaries only load back into the same driver, so it is part of the key
+    mp_binaryCache = nullptr;
+    GLint binaryFormats = 0;
+    context->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+    if (cache != nullptr && cache->enabled() && binaryFormats > 0) {
+        mp_binaryCache = cache;
+        uint64_t hash = hashBytes(vertSource);
+        hash = hashBytes(fragSource, hash);
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            hash = hashBytes(QByteArray(reinterpret_cast<const char*>(context->glGetString(name))), hash);
+        }
+        char key[32];
+        std::snprintf(key, sizeof(key), "shader_%016llx", static_cast<unsigned long long>(hash));
+        m_binaryKey = key;
+
+        std::vector<unsigned char> binary;
+        if (cache->load(m_binaryKey, SHADER_BINARY_CACHE_VERSION, &binary) && binary.size() > sizeof(GLenum)) {
+            GLenum format;
+            std::memcpy(&format, binary.data(), sizeof(GLenum));
+            context->glProgramBinary(prog, format, binary.data() + sizeof(GLenum), binary.size() - sizeof(GLenum));
+            GLint linked;
+            context->glGetProgramiv(prog, GL_LINK_STATUS, &linked);
+            // A driver update can reject a binary it wrote itself; compile instead
+            if (linked) {
+                m_loadedFromBinary = true;
+                return;
+            }
+        }
+        context->glProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    m_loadedFromBinary = false;
 
     // Send the shader text to OpenGL and store it in the shaders specified by the handles vertShader and fragShader
-    context->glShaderSource(vertShader, 1, (const char**)&vertSource, 0);
-    context->glShaderSource(fragShader, 1, (const char**)&fragSource, 0);
-    // Tell OpenGL to compile the shader text stored above
+    const char *vertText = vertSource.constData();
+    const char *fragText = fragSource.constData();
+    context->glShaderSource(vertShader, 1, &vertText, 0);
+    context->glShaderSource(fragShader, 1, &fragText, 0);
+    // Tell OpenGL to compile and link. Nothing here asks for the result,
+    // so drivers that compile in the background can get on with it while
+    // the other programs are started.
     context->glCompileShader(vertShader);
     context->glCompileShader(fragShader);
-    // Check if everything compiled OK
-    GLint compiled;
-    context->glGetShaderiv(vertShader, GL_COMPILE_STATUS, &compiled);
-    if (!compiled) {
-        printShaderInfoLog(vertShader);
-    }
-    context->glGetShaderiv(fragShader, GL_COMPILE_STATUS, &compiled);
-    if (!compiled) {
-        printShaderInfoLog(fragShader);
-    }
-
-    // Tell prog that it manages these particular vertex and fragment shaders
-    context->glAttachShader(prog, vertShader);
-    context->glAttachShader(prog, fragShader);
     context->glLinkProgram(prog);
+}
+
+void ShaderProgram::finishCreate()
+{
+    if (!m_loadedFromBinary) {
+        // Check if everything compiled OK
+        GLint compiled;
+        context->glGetShaderiv(vertShader, GL_COMPILE_STATUS, &compiled);
+        if (!compiled) {
+            printShaderInfoLog(vertShader);
+        }
+        context->glGetShaderiv(fragShader, GL_COMPILE_STATUS, &compiled);
+        if (!compiled) {
+            printShaderInfoLog(fragShader);
+        }
 
-    // Check for linking success
-    GLint linked;
-    context->glGetProgramiv(prog, GL_LINK_STATUS, &linked);
-    if (!linked) {
-        printLinkInfoLog(prog);
+        // Check for linking success
+        GLint linked;
+        context->glGetProgramiv(prog, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            printLinkInfoLog(prog);
+        } else if (mp_binaryCache != nullptr) {
+            GLint length = 0;
+            context->glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &length);
+            if (length > 0) {
+                std::vector<unsigned char> binary(sizeof(GLenum) + length);
+                GLenum format;
+                context->glGetProgramBinary(prog, length, &length, &format, binary.data() + sizeof(GLenum));
+                std::memcpy(binary.data(), &format, sizeof(GLenum));
+                binary.resize(sizeof(GLenum) + length);
+                mp_binaryCache->store(m_binaryKey, SHADER_BINARY_CACHE_VERSION, binary);
+            }
+        }
     }
 
     // Get the handles to the variables stored in our shaders
@@ -71,28 +149,56 @@ void ShaderProgram::create(const char *vertfile, const char *fragfile)
       attrUV = context->glGetAttribLocation(prog, "vs_UV");
       if(attrUV == -1) attrUV = context->glGetAttribLocation(prog, "vs_UVInstanced");
     attrPosOffset = context->glGetAttribLocation(prog, "vs_OffsetInstanced");
+    attrInstanceData = context->glGetAttribLocation(prog, "vs_InstanceData");
 
     unifModel      = context->glGetUniformLocation(prog, "u_Model");
     unifModelInvTr = context->glGetUniformLocation(prog, "u_ModelInvTr");
-    unifViewProj   = context->glGetUniformLocation(prog, "u_ViewProj");
     unifColor      = context->glGetUniformLocation(prog, "u_Color");
 
     //adding Unif Handler for Texture
     unifSampler2D  = context->glGetUniformLocation(prog, "u_Texture");
-     //adding Unif Handler for Time
-    unifTime = context->glGetUniformLocation(prog, "u_Time");
+    unifChunkOrigin = context->glGetUniformLocation(prog, "u_ChunkOrigin");
+
+    // Point the shared per-frame block at the buffer FrameUniforms fills
+    GLuint perFrame = context->glGetUniformBlockIndex(prog, "PerFrame");
+    if (perFrame != GL_INVALID_INDEX) {
+        context->glUniformBlockBinding(prog, perFrame, UBO_BINDING_PER_FRAME);
+    }
+
+    // The noise texture never moves off its slot, so this only needs setting once
+    GLint unifNoise = context->glGetUniformLocation(prog, "u_Noise");
+    if (unifNoise != -1) {
+        useMe();
+        context->glUniform1i(unifNoise, NOISE_TEXTURE_SLOT);
+    }
+
+    // Likewise for the decoration shader's block type table
+    GLint unifDecorationTypes = context->glGetUniformLocation(prog, "u_DecorationTypes");
+    if (unifDecorationTypes != -1) {
+        std::array<glm::vec4, DECORATION_TYPE_TABLE_SIZE> table = decorationTypeTable();
+        useMe();
+        context->glUniform4fv(unifDecorationTypes, table.size(), &table[0][0]);
+    }
+}
+
+bool ShaderProgram::loadedFromBinary() const {
+    return m_loadedFromBinary;
 }
 
 void ShaderProgram::useMe()
 {
-    context->glUseProgram(prog);
+    context->useProgramCached(prog);
 }
 
 void ShaderProgram::setTextureSlot(int newTexture = 0)
 {
+    if (newTexture == m_cachedTextureSlot) {
+        context->countSkippedGLCalls(1);
+        return;
+    }
     useMe();
     if (unifSampler2D != -1) context->glUniform1i(unifSampler2D, newTexture);
-
+    m_cachedTextureSlot = newTexture;
 }
 
 void ShaderProgram::bindTexture() {
@@ -101,6 +207,13 @@ void ShaderProgram::bindTexture() {
 
 void ShaderProgram::setModelMatrix(const glm::mat4 &model)
 {
+    // Also saves recomputing the inverse transpose
+    if (m_modelCached && model == m_cachedModel) {
+        context->countSkippedGLCalls(2);
+        return;
+    }
+    m_cachedModel = model;
+    m_modelCached = true;
     useMe();
 
     if (unifModel != -1) {
@@ -129,26 +242,29 @@ void ShaderProgram::setModelMatrix(const glm::mat4 &model)
     }
 }
 
-void ShaderProgram::setViewProjMatrix(const glm::mat4 &vp)
+void ShaderProgram::setChunkOrigin(const glm::vec3 &origin)
 {
-    // Tell OpenGL to use this shader program for subsequent function calls
+    if (m_chunkOriginCached && origin == m_cachedChunkOrigin) {
+        context->countSkippedGLCalls(1);
+        return;
+    }
+    m_cachedChunkOrigin = origin;
+    m_chunkOriginCached = true;
     useMe();
 
-    if(unifViewProj != -1) {
-    // Pass a 4x4 matrix into a uniform variable in our shader
-                    // Handle to the matrix variable on the GPU
-    context->glUniformMatrix4fv(unifViewProj,
-                    // How many matrices to pass
-                       1,
-                    // Transpose the matrix? OpenGL uses column-major, so no.
-                       GL_FALSE,
-                    // Pointer to the first element of the matrix
-                       &vp[0][0]);
+    if (unifChunkOrigin != -1) {
+        context->glUniform3f(unifChunkOrigin, origin.x, origin.y, origin.z);
     }
 }
 
 void ShaderProgram::setGeometryColor(glm::vec4 color)
 {
+    if (m_colorCached && color == m_cachedColor) {
+        context->countSkippedGLCalls(1);
+        return;
+    }
+    m_cachedColor = color;
+    m_colorCached = true;
     useMe();
 
     if(unifColor != -1)
@@ -160,6 +276,8 @@ void ShaderProgram::setGeometryColor(glm::vec4 color)
 void ShaderProgram::draw(Drawable &d, int textureSlot)
 {
     useMe();
+    // Attributes are set up below, on the shared VAO
+    context->bindDefaultVertexArray();
 
     if(d.elemCount() < 0) {
         throw std::out_of_range("Attempting to draw a drawable with m_count of " + std::to_string(d.elemCount()) + "!");
@@ -200,7 +318,7 @@ void ShaderProgram::draw(Drawable &d, int textureSlot)
     // Bind the index buffer and then draw shapes from it.
     // This invokes the shader program, which accesses the vertex buffers.
     d.bindIdx();
-    if (unifSampler2D != -1) context->glUniform1i(unifSampler2D, textureSlot);
+    setTextureSlot(textureSlot);
     context->glDrawElements(d.drawMode(), d.elemCount(), GL_UNSIGNED_INT, 0);
 
     if (attrPos != -1) context->glDisableVertexAttribArray(attrPos);
@@ -215,6 +333,8 @@ void ShaderProgram::draw(Drawable &d, int textureSlot)
 void ShaderProgram::drawInstanced(InstancedDrawable &d)
 {
     useMe();
+    // Attributes are set up below, on the shared VAO
+    context->bindDefaultVertexArray();
 
     if(d.elemCount() < 0) {
         throw std::out_of_range("Attempting to draw a drawable with m_count of " + std::to_string(d.elemCount()) + "!");
@@ -266,8 +386,70 @@ void ShaderProgram::drawInstanced(InstancedDrawable &d)
 
 }
 
+void ShaderProgram::drawInstanced(InstancedDrawable &d, GLuint instanceBuf, int first, int count)
+{
+    useMe();
+    // Attributes are set up below, on the shared VAO
+    context->bindDefaultVertexArray();
+
+    if (d.elemCount() < 0) {
+        throw std::out_of_range("Attempting to draw a drawable with m_count of " + std::to_string(d.elemCount()) + "!");
+    }
+
+    if (d.bindInterleaved()) {
+        if (attrPos != -1) {
+            context->glEnableVertexAttribArray(attrPos);
+            context->glVertexAttribPointer(attrPos, 4, GL_FLOAT, false, 11 * sizeof(float), (void*) 0);
+        }
+        if (attrNor != -1) {
+            context->glEnableVertexAttribArray(attrNor);
+            context->glVertexAttribPointer(attrNor, 4, GL_FLOAT, false, 11 * sizeof(float), (void*) sizeof(glm::vec4));
+        }
+        if (attrUV != -1) {
+            context->glEnableVertexAttribArray(attrUV);
+            context->glVertexAttribPointer(attrUV, 3, GL_FLOAT, false, 11 * sizeof(float), (void*) (2 * sizeof(glm::vec4)));
+        }
+    }
+
+    // Starting the pointers at the first instance stands in for a base instance
+    context->glBindBuffer(GL_ARRAY_BUFFER, instanceBuf);
+    size_t base = first * sizeof(DecorationInstance);
+    if (attrPosOffset != -1) {
+        context->glEnableVertexAttribArray(attrPosOffset);
+        context->glVertexAttribPointer(attrPosOffset, 3, GL_FLOAT, false, sizeof(DecorationInstance),
+                                       (void*) (base + offsetof(DecorationInstance, pos)));
+        context->glVertexAttribDivisor(attrPosOffset, 1);
+    }
+    if (attrInstanceData != -1) {
+        context->glEnableVertexAttribArray(attrInstanceData);
+        context->glVertexAttribPointer(attrInstanceData, 2, GL_FLOAT, false, sizeof(DecorationInstance),
+                                       (void*) (base + offsetof(DecorationInstance, type)));
+        context->glVertexAttribDivisor(attrInstanceData, 1);
+    }
+
+    d.bindIdx();
+    context->glDrawElementsInstanced(d.drawMode(), d.elemCount(), GL_UNSIGNED_INT, 0, count);
+
+    if (attrPos != -1) context->glDisableVertexAttribArray(attrPos);
+    if (attrNor != -1) context->glDisableVertexAttribArray(attrNor);
+    if (attrUV != -1) context->glDisableVertexAttribArray(attrUV);
+    // The shared VAO keeps divisors, and other programs may reuse these locations
+    if (attrPosOffset != -1) {
+        context->glVertexAttribDivisor(attrPosOffset, 0);
+        context->glDisableVertexAttribArray(attrPosOffset);
+    }
+    if (attrInstanceData != -1) {
+        context->glVertexAttribDivisor(attrInstanceData, 0);
+        context->glDisableVertexAttribArray(attrInstanceData);
+    }
+
+    context->printGLErrorLog();
+}
+
 void ShaderProgram::drawInterleaved(Drawable &d) {
     useMe();
+    // Attributes are set up below, on the shared VAO
+    context->bindDefaultVertexArray();
 
     if (d.elemCount() < 0) {
         throw std::out_of_range("Attempting to draw a drawable with m_count of " + std::to_string(d.elemCount()) + "!");
@@ -299,12 +481,31 @@ void ShaderProgram::drawInterleaved(Drawable &d) {
 }
 
 void ShaderProgram::drawOpaque(Drawable &d) {
+    drawOpaque(d, {glm::ivec2(0, d.opqCount())});
+}
+
+void ShaderProgram::drawTransparent(Drawable &d) {
+    drawTransparent(d, {glm::ivec2(0, d.traCount())});
+}
+
+void ShaderProgram::drawOpaque(Drawable &d, const std::vector<glm::ivec2> &ranges) {
     useMe();
 
     if (d.opqCount() < 0) {
         throw std::out_of_range("Attempting to draw a opaque drawable with m_countOpq of " + std::to_string(d.opqCount()) + "!");
     }
 
+    // Meshes with a VAO already carry their buffers and attribute layout
+    if (d.bindVAOOpq()) {
+        for (const glm::ivec2 &r : ranges) {
+            context->glDrawElements(d.drawMode(), r.y, GL_UNSIGNED_INT, (void*) (r.x * sizeof(GLuint)));
+        }
+        // Buffer binds, attribute setup and teardown
+        context->countSkippedGLCalls(11);
+        return;
+    }
+
+    context->bindDefaultVertexArray();
     if (d.bindInterleavedOpq()) {
         if (attrPos != -1) {
             context->glEnableVertexAttribArray(attrPos);
@@ -321,7 +522,9 @@ void ShaderProgram::drawOpaque(Drawable &d) {
     }
 
     d.bindIdxOpq();
-    context->glDrawElements(d.drawMode(), d.opqCount(), GL_UNSIGNED_INT, 0);
+    for (const glm::ivec2 &r : ranges) {
+        context->glDrawElements(d.drawMode(), r.y, GL_UNSIGNED_INT, (void*) (r.x * sizeof(GLuint)));
+    }
 
     if (attrPos != -1) context->glDisableVertexAttribArray(attrPos);
     if (attrNor != -1) context->glDisableVertexAttribArray(attrNor);
@@ -330,13 +533,24 @@ void ShaderProgram::drawOpaque(Drawable &d) {
     context->printGLErrorLog();
 }
 
-void ShaderProgram::drawTransparent(Drawable &d) {
+void ShaderProgram::drawTransparent(Drawable &d, const std::vector<glm::ivec2> &ranges) {
     useMe();
 
     if (d.traCount() < 0) {
         throw std::out_of_range("Attempting to draw a transparent drawable with m_countTra of " + std::to_string(d.traCount()) + "!");
     }
 
+    // Meshes with a VAO already carry their buffers and attribute layout
+    if (d.bindVAOTra()) {
+        for (const glm::ivec2 &r : ranges) {
+            context->glDrawElements(d.drawMode(), r.y, GL_UNSIGNED_INT, (void*) (r.x * sizeof(GLuint)));
+        }
+        // Buffer binds, attribute setup and teardown
+        context->countSkippedGLCalls(11);
+        return;
+    }
+
+    context->bindDefaultVertexArray();
     if (d.bindInterleavedTra()) {
         if (attrPos != -1) {
             context->glEnableVertexAttribArray(attrPos);
@@ -353,8 +567,9 @@ void ShaderProgram::drawTransparent(Drawable &d) {
     }
 
     d.bindIdxTra();
-    context->glDrawElements(d.drawMode(), d.traCount(), GL_UNSIGNED_INT, 0);
-    context->printGLErrorLog();
+    for (const glm::ivec2 &r : ranges) {
+        context->glDrawElements(d.drawMode(), r.y, GL_UNSIGNED_INT, (void*) (r.x * sizeof(GLuint)));
+    }
 
     if (attrPos != -1) context->glDisableVertexAttribArray(attrPos);
     if (attrNor != -1) context->glDisableVertexAttribArray(attrNor);
@@ -398,14 +613,6 @@ QString ShaderProgram::qTextFileRead(const char *fileName)
     return text;
 }
 
-void ShaderProgram::setTime(int t) {
-    useMe();
-    if (unifTime != -1) {
-        context->glUniform1i(unifTime, t);
-    }
-}
-
-
 void ShaderProgram::printShaderInfoLog(int shader)
 {
     int infoLogLen = 0;
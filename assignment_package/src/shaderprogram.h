@@ -6,6 +6,10 @@
 #include <glm/glm.hpp>
 
 #include "drawable.h"
+#include "resourcecache.h"
+
+// Bump to throw away every cached program binary
+#define SHADER_BINARY_CACHE_VERSION 1
 
 
 class ShaderProgram
@@ -21,35 +25,54 @@ public:
     int attrCol; // A handle for the "in" vec4 representing vertex color in the vertex shader
     int attrUV; // MS2: A handle for the "in" vec2 representing vertex UV in vertex shader
     int attrPosOffset; // A handle for a vec3 used only in the instanced rendering shader
+    int attrInstanceData; // A handle for the per-instance vec2 of block type and state in the decoration shader
 
     int unifModel; // A handle for the "uniform" mat4 representing model matrix in the vertex shader
     int unifModelInvTr; // A handle for the "uniform" mat4 representing inverse transpose of the model matrix in the vertex shader
-    int unifViewProj; // A handle for the "uniform" mat4 representing combined projection and view matrices in the vertex shader
     int unifColor; // A handle for the "uniform" vec4 representing color of geometry in the vertex shader
     int unifSampler2D; // MS2: A handle to the "uniform" sampler2D that will be used to read the texture containing the scene render
-    int unifTime; // MS2: A handle for the uniform flaot representing time
+    int unifChunkOrigin; // A handle for the "uniform" vec3 that terrain vertex positions are relative to
 
 public:
     ShaderProgram(OpenGLContext* context);
-    // Sets up the requisite GL data and shaders from the given .glsl files
-    void create(const char *vertfile, const char *fragfile);
-    // Tells our OpenGL context to use this shader to draw things
+    // Sets up the requisite GL data and shaders from the given .glsl files.
+    // If cache is enabled the linked program is loaded from it when an entry
+    // for the same sources and driver exists, and stored in it when not.
+    void create(const char *vertfile, const char *fragfile, const ResourceCache *cache = nullptr);
+    // create() in two halves. startCreate() only issues the compile and link;
+    // finishCreate() waits for them and looks up the attributes and uniforms.
+    // Starting every program before finishing any lets drivers that compile
+    // on several threads build them all at once.
+    void startCreate(const char *vertfile, const char *fragfile, const ResourceCache *cache = nullptr);
+    void finishCreate();
+    // Whether the last create() was served from the binary cache
+    bool loadedFromBinary() const;
+    // Tells our OpenGL context to use this shader to draw things.
+    // Does nothing if it is already in use.
     void useMe();
     // Pass the given model matrix to this shader on the GPU
     void setModelMatrix(const glm::mat4 &model);
-    // Pass the given Projection * View matrix to this shader on the GPU
-    void setViewProjMatrix(const glm::mat4 &vp);
+    // Pass the origin of the chunk or tile about to be drawn to this shader on the GPU.
+    // The view-projection matrix and time come from the PerFrame uniform block instead.
+    void setChunkOrigin(const glm::vec3 &origin);
     // Pass the given color to this shader on the GPU
     void setGeometryColor(glm::vec4 color);
     // Draw the given object to our screen using this ShaderProgram's shaders
     void draw(Drawable &d, int textureSlot);
     // Draw the given object to our screen multiple times using instanced rendering
     void drawInstanced(InstancedDrawable &d);
+    // Draw count instances of the given object's interleaved mesh, reading
+    // each instance's DecorationInstance from instanceBuf starting at first
+    void drawInstanced(InstancedDrawable &d, GLuint instanceBuf, int first, int count);
     // Draw the given object to out screen; for when the object uses interleaved VBOs
     void drawInterleaved(Drawable &d);
 
     void drawOpaque(Drawable &d);
     void drawTransparent(Drawable &d);
+    // Draw only the given (first index, index count) ranges of the object's
+    // opaque or transparent index buffer, binding its VBO just once
+    void drawOpaque(Drawable &d, const std::vector<glm::ivec2> &ranges);
+    void drawTransparent(Drawable &d, const std::vector<glm::ivec2> &ranges);
     // Utility function used in create()
     char* textFileRead(const char*);
     // Utility function that prints any shader compilation errors to the console
@@ -63,9 +86,6 @@ public:
        void setTextureSlot(int texSlot);
        void bindTexture();
 
-    // MS2: adding U_Time
-       void setTime(int t);
-
 
     QString qTextFileRead(const char*);
 
@@ -73,6 +93,19 @@ private:
     OpenGLContext* context;   // Since Qt's OpenGL support is done through classes like QOpenGLFunctions_3_2_Core,
                             // we need to pass our OpenGL context to the Drawable in order to call GL functions
                             // from within this class.
+
+    // The values last uploaded to this program's uniforms, so that setting
+    // one to the value it already has costs no GL calls
+    glm::mat4 m_cachedModel;
+    glm::vec4 m_cachedColor;
+    glm::vec3 m_cachedChunkOrigin;
+    int m_cachedTextureSlot;
+    bool m_modelCached, m_colorCached, m_chunkOriginCached;
+
+    // Where startCreate() found or will store the program binary
+    const ResourceCache *mp_binaryCache;
+    std::string m_binaryKey;
+    bool m_loadedFromBinary;
 };
 
 
@@ -23,7 +23,34 @@ SOURCES += \
     $$PWD/scene/player.cpp \
     $$PWD/scene/camera.cpp \
     $$PWD/playerinfo.cpp \
-    $$PWD/scene/chunk.cpp
+    $$PWD/scene/chunk.cpp \
+    $$PWD/scene/sectionvisibility.cpp \
+    $$PWD/scene/occlusionculler.cpp \
+    $$PWD/scene/meshcache.cpp \
+    $$PWD/scene/farterrain.cpp \
+    $$PWD/drawdistancecontroller.cpp \
+    $$PWD/frameuniforms.cpp \
+    $$PWD/resolutionscalecontroller.cpp \
+    $$PWD/rendergraph.cpp \
+    $$PWD/resourcecache.cpp \
+    $$PWD/scene/noisetexture.cpp \
+    $$PWD/scene/decorations.cpp \
+    $$PWD/benchmark.cpp \
+    $$PWD/scene/chunkdata.cpp \
+    $$PWD/scene/chunkmesher.cpp \
+    $$PWD/scene/terraingen.cpp \
+    $$PWD/scene/decorationmesh.cpp \
+    $$PWD/frameprofiler.cpp \
+    $$PWD/framegraph.cpp \
+    $$PWD/tracer.cpp \
+    $$PWD/memorystats.cpp \
+    $$PWD/inputrecording.cpp \
+    $$PWD/inputreplay.cpp \
+    $$PWD/scene/voxelcollision.cpp \
+    $$PWD/scene/raycast.cpp \
+    $$PWD/scene/spatialhash.cpp \
+    $$PWD/scene/entitysystem.cpp \
+    $$PWD/scene/fluidsim.cpp
 
 HEADERS += \
     $$PWD/framebuffer.h \
@@ -49,6 +76,34 @@ HEADERS += \
     $$PWD/scene/player.h \
     $$PWD/scene/camera.h \
     $$PWD/playerinfo.h \
-    $$PWD/scene/chunk.h
+    $$PWD/scene/chunk.h \
+    $$PWD/scene/sectionvisibility.h \
+    $$PWD/scene/occlusionculler.h \
+    $$PWD/scene/meshcache.h \
+    $$PWD/scene/farterrain.h \
+    $$PWD/drawdistancecontroller.h \
+    $$PWD/frameuniforms.h \
+    $$PWD/resolutionscalecontroller.h \
+    $$PWD/rendergraph.h \
+    $$PWD/resourcecache.h \
+    $$PWD/scene/noisetexture.h \
+    $$PWD/scene/decorations.h \
+    $$PWD/benchmark.h \
+    $$PWD/scene/chunkdata.h \
+    $$PWD/scene/chunkmesher.h \
+    $$PWD/scene/terraingen.h \
+    $$PWD/scene/decorationmesh.h \
+    $$PWD/scene/gridmarch.h \
+    $$PWD/frameprofiler.h \
+    $$PWD/framegraph.h \
+    $$PWD/tracer.h \
+    $$PWD/memorystats.h \
+    $$PWD/inputrecording.h \
+    $$PWD/inputreplay.h \
+    $$PWD/scene/voxelcollision.h \
+    $$PWD/scene/raycast.h \
+    $$PWD/scene/spatialhash.h \
+    $$PWD/scene/entitysystem.h \
+    $$PWD/scene/fluidsim.h
 
 RESOURCES +=
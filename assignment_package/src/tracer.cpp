@@ -0,0 +1,169 @@
+#include "tracer.h"
+#include "smartpointerhelp.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <QMutex>
+#include <vector>
+
+struct ThreadEvents {
+    int tid;
+    std::string name;
+    std::array<TraceEvent, TRACE_EVENTS_PER_THREAD> events;
+    // Events ever recorded; the newest is at (written - 1) % size
+    std::atomic<uint64_t> written;
+    // Whether a live thread records into these. Guarded by threadsMutex.
+    bool inUse;
+
+    ThreadEvents(int tid, const std::string &name)
+        : tid(tid), name(name), events{}, written(0), inUse(true)
+    {}
+};
+
+static std::atomic<bool> tracing(false);
+static std::atomic<uint64_t> lastJobId(0);
+static const std::chrono::steady_clock::time_point traceStart = std::chrono::steady_clock::now();
+
+// Every thread's events, kept after the thread ends. The thread pool
+// retires idle threads and starts new ones, so a ring whose thread has
+// ended is handed to the next new thread, which carries on in the same
+// timeline row; there are never more rings than threads alive at once.
+// The mutex is only taken when a thread starts or stops recording and
+// when dumping.
+static QMutex threadsMutex;
+static std::vector<uPtr<ThreadEvents>> threads;
+
+// Gives the calling thread's ring back when the thread ends
+struct ThreadEventsOwner {
+    ThreadEvents *events = nullptr;
+
+    ~ThreadEventsOwner() {
+        if (events != nullptr) {
+            QMutexLocker lock(&threadsMutex);
+            events->inUse = false;
+        }
+    }
+};
+
+static thread_local ThreadEventsOwner tlsEvents;
+static thread_local const char *tlsThreadName = nullptr;
+
+static ThreadEvents *eventsForThisThread() {
+    if (tlsEvents.events == nullptr) {
+        QMutexLocker lock(&threadsMutex);
+        for (const uPtr<ThreadEvents> &t : threads) {
+            if (!t->inUse) {
+                t->inUse = true;
+                if (tlsThreadName != nullptr) {
+                    t->name = tlsThreadName;
+                }
+                tlsEvents.events = t.get();
+                return tlsEvents.events;
+            }
+        }
+        int tid = static_cast<int>(threads.size());
+        std::string name = tlsThreadName ? tlsThreadName : "thread " + std::to_string(tid);
+        threads.push_back(mkU<ThreadEvents>(tid, name));
+        tlsEvents.events = threads.back().get();
+    }
+    return tlsEvents.events;
+}
+
+void Tracer::setEnabled(bool enabled) {
+    tracing.store(enabled, std::memory_order_relaxed);
+}
+
+bool Tracer::enabled() {
+    return tracing.load(std::memory_order_relaxed);
+}
+
+uint64_t Tracer::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceStart).count();
+}
+
+uint64_t Tracer::nextJobId() {
+    return lastJobId.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void Tracer::setThreadName(const char *name) {
+    tlsThreadName = name;
+    if (tlsEvents.events != nullptr) {
+        QMutexLocker lock(&threadsMutex);
+        tlsEvents.events->name = name;
+    }
+}
+
+void Tracer::record(const TraceEvent &event) {
+    if (!enabled()) {
+        return;
+    }
+    ThreadEvents *t = eventsForThisThread();
+    uint64_t n = t->written.load(std::memory_order_relaxed);
+    t->events[n % TRACE_EVENTS_PER_THREAD] = event;
+    t->written.store(n + 1, std::memory_order_release);
+}
+
+bool Tracer::writeJson(const std::string &path) {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    // Timestamps are in microseconds
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    QMutexLocker lock(&threadsMutex);
+    for (const uPtr<ThreadEvents> &t : threads) {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t->tid
+            << ",\"args\":{\"name\":\"" << t->name << "\"}}";
+        first = false;
+
+        uint64_t written = t->written.load(std::memory_order_acquire);
+        uint64_t oldest = written > TRACE_EVENTS_PER_THREAD ? written - TRACE_EVENTS_PER_THREAD : 0;
+        for (uint64_t i = oldest; i < written; i++) {
+            const TraceEvent &e = t->events[i % TRACE_EVENTS_PER_THREAD];
+            out << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << t->tid
+                << ",\"ts\":" << e.startNs / 1000.0 << ",\"dur\":" << (e.endNs - e.startNs) / 1000.0 << ",\"args\":{";
+            bool firstArg = true;
+            if (e.job != 0) {
+                out << "\"job\":" << e.job << ",\"queue_wait_us\":" << e.queuedNs / 1000.0;
+                firstArg = false;
+            }
+            if (e.hasChunk) {
+                out << (firstArg ? "" : ",") << "\"x\":" << e.chunk.x << ",\"z\":" << e.chunk.y;
+            }
+            out << "}}";
+        }
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+
+TraceScope::TraceScope(const char *name)
+    : m_event{name, 0, 0, 0, 0, glm::ivec2(), false}, m_active(Tracer::enabled())
+{
+    if (m_active) {
+        m_event.startNs = Tracer::now();
+    }
+}
+
+TraceScope::TraceScope(const char *name, const glm::ivec2 &chunk)
+    : TraceScope(name)
+{
+    m_event.chunk = chunk;
+    m_event.hasChunk = true;
+}
+
+TraceScope::TraceScope(const char *name, uint64_t job, uint64_t queuedAtNs, const glm::ivec2 &chunk)
+    : TraceScope(name, chunk)
+{
+    m_event.job = job;
+    m_event.queuedNs = m_event.startNs > queuedAtNs ? m_event.startNs - queuedAtNs : 0;
+}
+
+TraceScope::~TraceScope() {
+    if (m_active) {
+        m_event.endNs = Tracer::now();
+        Tracer::record(m_event);
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "glm_includes.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Events each thread keeps; once full, the oldest are overwritten
+#define TRACE_EVENTS_PER_THREAD 8192
+
+// One span of work on one thread. name must be a string literal, as only
+// the pointer is kept.
+struct TraceEvent {
+    const char *name;
+    uint64_t startNs, endNs;
+    uint64_t job;        // 0 unless the work is a thread pool job
+    uint64_t queuedNs;   // How long the job waited in the pool's queue
+    glm::ivec2 chunk;    // Chunk or zone coordinates
+    bool hasChunk;
+};
+
+// Records what every thread was doing, for viewing as a timeline in
+// chrome://tracing or Perfetto. Each thread writes into its own ring of
+// events, so recording takes no locks and costs two clock reads when on
+// and one atomic load when off. Dump once recording is off: threads still
+// inside a scope may otherwise overwrite events as they are written out.
+class Tracer {
+public:
+    static void setEnabled(bool enabled);
+    static bool enabled();
+
+    // Nanoseconds since the tracer was first used
+    static uint64_t now();
+    // A new id for a job, to follow it from being queued to being done
+    static uint64_t nextJobId();
+    // Names the calling thread in the timeline; others are "thread <n>"
+    static void setThreadName(const char *name);
+
+    static void record(const TraceEvent &event);
+
+    // Writes every thread's events as Chrome trace-event JSON.
+    // Returns false if the file can't be written.
+    static bool writeJson(const std::string &path);
+};
+
+// Records the span from its construction to its destruction
+class TraceScope {
+private:
+    TraceEvent m_event;
+    bool m_active;
+
+public:
+    explicit TraceScope(const char *name);
+    TraceScope(const char *name, const glm::ivec2 &chunk);
+    // queuedAtNs is the Tracer::now() at which the job was handed to the pool
+    TraceScope(const char *name, uint64_t job, uint64_t queuedAtNs, const glm::ivec2 &chunk);
+    ~TraceScope();
+};
@@ -34,12 +34,14 @@ public:
     QLabel *chunkLabel;
     QLabel *label_11;
     QLabel *zoneLabel;
+    QLabel *label_12;
+    QLabel *renderStatsLabel;
 
     void setupUi(QWidget *PlayerInfo)
     {
         if (PlayerInfo->objectName().isEmpty())
             PlayerInfo->setObjectName(QString::fromUtf8("PlayerInfo"));
-        PlayerInfo->resize(403, 344);
+        PlayerInfo->resize(403, 384);
         line = new QFrame(PlayerInfo);
         line->setObjectName(QString::fromUtf8("line"));
         line->setGeometry(QRect(10, 20, 381, 20));
@@ -102,6 +104,14 @@ public:
         zoneLabel->setObjectName(QString::fromUtf8("zoneLabel"));
         zoneLabel->setGeometry(QRect(120, 260, 271, 31));
         zoneLabel->setFont(font1);
+        label_12 = new QLabel(PlayerInfo);
+        label_12->setObjectName(QString::fromUtf8("label_12"));
+        label_12->setGeometry(QRect(20, 300, 91, 31));
+        label_12->setFont(font1);
+        renderStatsLabel = new QLabel(PlayerInfo);
+        renderStatsLabel->setObjectName(QString::fromUtf8("renderStatsLabel"));
+        renderStatsLabel->setGeometry(QRect(120, 300, 271, 31));
+        renderStatsLabel->setFont(font1);
 
         retranslateUi(PlayerInfo);
 
@@ -124,6 +134,8 @@ public:
         chunkLabel->setText(QCoreApplication::translate("PlayerInfo", "UNK", nullptr));
         label_11->setText(QCoreApplication::translate("PlayerInfo", "Terrain Zone:", nullptr));
         zoneLabel->setText(QCoreApplication::translate("PlayerInfo", "UNK", nullptr));
+        label_12->setText(QCoreApplication::translate("PlayerInfo", "Rendering:", nullptr));
+        renderStatsLabel->setText(QCoreApplication::translate("PlayerInfo", "UNK", nullptr));
     } // retranslateUi
 
 };